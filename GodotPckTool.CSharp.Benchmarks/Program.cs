@@ -0,0 +1,182 @@
+namespace GodotPckTool.CSharp.Benchmarks;
+
+using System.Diagnostics;
+
+/// <summary>
+///   Compares the managed <see cref="PckFile"/> against <see cref="NativePckFile"/>. Generates
+///   test data unless a folder of files to pack is given as the first argument.
+/// </summary>
+public static class Program
+{
+    private const int Repeats = 3;
+    private const int GeneratedFiles = 2000;
+    private const int MaxGeneratedFileSize = 1024 * 1024;
+
+    public static int Main(string[] args)
+    {
+        if (!NativePckFile.IsAvailable())
+        {
+            Console.WriteLine(
+                "ERROR: the gpck native library was not found, build it with -DGODOT_PCK_TOOL_SHARED_LIBRARY=ON " +
+                "and put it next to this program or on the library path");
+            return 1;
+        }
+
+        string workDir = Path.Combine(Path.GetTempPath(), "GodotPckToolBenchmark_" + Guid.NewGuid());
+        Directory.CreateDirectory(workDir);
+
+        try
+        {
+            string sourceDir = args.Length > 0 ? Path.GetFullPath(args[0]) : GenerateFiles(workDir);
+            string managedPck = Path.Combine(workDir, "managed.pck");
+            string nativePck = Path.Combine(workDir, "native.pck");
+
+            Console.WriteLine($"Source folder: {sourceDir}");
+            Console.WriteLine($"Best of {Repeats} runs");
+            Console.WriteLine();
+            Console.WriteLine($"{"Operation",-12} {"Managed",12} {"Native",12}");
+
+            Report("Create", Measure(() => CreateManaged(sourceDir, managedPck)),
+                Measure(() => CreateNative(sourceDir, nativePck)));
+
+            Report("Load", Measure(() =>
+            {
+                using var pck = new PckFile(managedPck);
+                pck.Load();
+            }), Measure(() =>
+            {
+                using var pck = NativePckFile.Open(nativePck);
+            }));
+
+            Report("Read all", Measure(() => ReadAllManaged(managedPck)),
+                Measure(() => ReadAllNative(nativePck)));
+
+            string extractDir = Path.Combine(workDir, "extracted");
+
+            Report("Extract", Measure(() =>
+            {
+                using var pck = new PckFile(managedPck);
+                pck.Load();
+                pck.Extract(extractDir, false);
+            }), Measure(() =>
+            {
+                using var pck = NativePckFile.Open(nativePck);
+                pck.Extract(extractDir);
+            }));
+
+            return 0;
+        }
+        finally
+        {
+            Directory.Delete(workDir, true);
+        }
+    }
+
+    private static string GenerateFiles(string workDir)
+    {
+        string sourceDir = Path.Combine(workDir, "source");
+        var random = new Random(42);
+
+        for (int i = 0; i < GeneratedFiles; ++i)
+        {
+            string folder = Path.Combine(sourceDir, $"folder{i % 20}");
+            Directory.CreateDirectory(folder);
+
+            // Mostly small files with some large ones, like in a typical game
+            int size = random.Next(10) == 0 ? random.Next(MaxGeneratedFileSize) : random.Next(16 * 1024);
+            byte[] data = new byte[size];
+            random.NextBytes(data);
+
+            File.WriteAllBytes(Path.Combine(folder, $"file{i}.bin"), data);
+        }
+
+        return sourceDir;
+    }
+
+    private static void CreateManaged(string sourceDir, string pckPath)
+    {
+        using var pck = new PckFile(pckPath);
+        pck.SetGodotVersion(4, 3, 0);
+        pck.AddFilesFromFilesystem(sourceDir, sourceDir);
+
+        if (!pck.Save())
+            throw new IOException("Saving the managed pck failed");
+    }
+
+    private static void CreateNative(string sourceDir, string pckPath)
+    {
+        using var pck = NativePckFile.Create(pckPath, 4, 3, 0);
+
+        foreach (string file in Directory.EnumerateFiles(sourceDir, "*", SearchOption.AllDirectories))
+        {
+            string pckFilePath = Path.GetRelativePath(sourceDir, file).Replace('\\', '/');
+            pck.AddSingleFile(file, Constants.GodotResPath + pckFilePath);
+        }
+
+        pck.Save();
+    }
+
+    private static long ReadAllManaged(string pckPath)
+    {
+        using var pck = new PckFile(pckPath);
+        pck.Load();
+
+        long total = 0;
+
+        foreach (var file in pck.Contents.Values)
+        {
+            total += file.GetData?.Invoke().Length ?? 0;
+        }
+
+        return total;
+    }
+
+    private static long ReadAllNative(string pckPath)
+    {
+        using var pck = NativePckFile.Open(pckPath);
+
+        // The native API reads into a caller buffer so one buffer can be reused for all files
+        byte[] buffer = new byte[MaxGeneratedFileSize];
+        long total = 0;
+
+        foreach (var file in pck.Entries)
+        {
+            if (file.Size > (ulong)buffer.Length)
+                buffer = new byte[file.Size];
+
+            pck.Read(file.Path, 0, buffer.AsSpan(0, (int)file.Size));
+            total += (long)file.Size;
+        }
+
+        return total;
+    }
+
+    private static TimeSpan Measure(Action action)
+    {
+        var best = TimeSpan.MaxValue;
+
+        for (int i = 0; i < Repeats; ++i)
+        {
+            var stopwatch = Stopwatch.StartNew();
+            action();
+            stopwatch.Stop();
+
+            if (stopwatch.Elapsed < best)
+                best = stopwatch.Elapsed;
+        }
+
+        return best;
+    }
+
+    private static TimeSpan Measure(Func<long> action)
+    {
+        return Measure(() => { action(); });
+    }
+
+    private static void Report(string operation, TimeSpan managed, TimeSpan native)
+    {
+        Console.WriteLine(
+            $"{operation,-12} {managed.TotalMilliseconds,10:F1}ms {native.TotalMilliseconds,10:F1}ms " +
+            $"({managed / native:F2}x)");
+    }
+}
@@ -13,6 +13,8 @@ public static class Constants
     public const uint PckFileRelativeBase = 1 << 1;
     public const uint PckFileSparseBundle = 1 << 2;
 
+    public const int EncryptionKeySize = 32;
+
     public const int MaxSupportedPckVersionLoad = 4;
     public const int MaxSupportedPckVersionSave = 4;
 
@@ -0,0 +1,117 @@
+namespace GodotPckTool;
+
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+
+/// <summary>
+///   Bindings to the C API of the gpck native library (src/capi/GodotPck.h)
+/// </summary>
+internal static unsafe partial class NativeMethods
+{
+    public const string LibraryName = "gpck";
+
+    /// <summary>
+    ///   The API version these bindings are written against, the library may be newer
+    /// </summary>
+    public const uint ApiVersion = 2;
+
+    public enum Result
+    {
+        Ok = 0,
+        Error = 1,
+        NotFound = 2,
+        InvalidArgument = 3,
+    }
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_api_version")]
+    public static partial uint GetApiVersion();
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_open", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial PckHandle Open(string path, byte* key);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_open_memory", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial PckHandle OpenMemory(byte* data, nuint size, string name, byte* key);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_create", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial PckHandle Create(string path, uint major, uint minor, uint patch);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_close")]
+    public static partial void Close(IntPtr pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_last_error")]
+    public static partial IntPtr LastError(PckHandle pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_last_error")]
+    public static partial IntPtr LastGlobalError(IntPtr pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_set_memory_limit")]
+    public static partial Result SetMemoryLimit(PckHandle pck, ulong bytes);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_format_version")]
+    public static partial uint FormatVersion(PckHandle pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_entry_count")]
+    public static partial ulong EntryCount(PckHandle pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_entry_at")]
+    public static partial Result EntryAt(PckHandle pck, ulong index, EntryInfo* info);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_find", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result Find(PckHandle pck, string path, EntryInfo* info);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_read", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result Read(PckHandle pck, string path, ulong start, byte* buffer, nuint length);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_extract", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result Extract(PckHandle pck, string outputDir, uint threads);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_verify")]
+    public static partial Result Verify(PckHandle pck, uint threads, ulong* mismatches);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_add_data", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result AddData(PckHandle pck, string pckPath, ulong size,
+        delegate* unmanaged[Cdecl]<IntPtr, ulong, byte*, nuint, int> read,
+        delegate* unmanaged[Cdecl]<IntPtr, void> release, IntPtr userData);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_add_file", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result AddFile(PckHandle pck, string sourcePath, string pckPath);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_remove", StringMarshalling = StringMarshalling.Utf8)]
+    public static partial Result Remove(PckHandle pck, string pckPath);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_save")]
+    public static partial Result Save(PckHandle pck);
+
+    [LibraryImport(LibraryName, EntryPoint = "gpck_save_memory")]
+    public static partial Result SaveMemory(PckHandle pck,
+        delegate* unmanaged[Cdecl]<IntPtr, byte*, nuint, int> write, IntPtr userData);
+
+    /// <summary>
+    ///   Matches gpck_entry_info
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct EntryInfo
+    {
+        public IntPtr Path;
+        public ulong Offset;
+        public ulong Size;
+        public fixed byte Md5[16];
+        public uint Flags;
+    }
+
+    /// <summary>
+    ///   Owns a gpck_pck and closes it when released
+    /// </summary>
+    public sealed class PckHandle : SafeHandleZeroOrMinusOneIsInvalid
+    {
+        public PckHandle() : base(true)
+        {
+        }
+
+        protected override bool ReleaseHandle()
+        {
+            NativeMethods.Close(handle);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,381 @@
+namespace GodotPckTool;
+
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+/// <summary>
+///   A PCK file handled by the native gpck library. Unlike <see cref="PckFile"/> this supports
+///   encryption, reads file data in ranges instead of whole, and extracts and verifies on
+///   multiple threads. The gpck library needs to be next to the application or otherwise
+///   findable by the runtime.
+/// </summary>
+/// <remarks>
+///   <para>
+///     Instances are not thread safe, but separate instances can be used from different threads.
+///   </para>
+/// </remarks>
+public sealed unsafe class NativePckFile : IDisposable
+{
+    private readonly NativeMethods.PckHandle handle;
+
+    private NativePckFile(NativeMethods.PckHandle handle, string path)
+    {
+        this.handle = handle;
+        Path = path;
+    }
+
+    public string Path { get; }
+
+    public uint FormatVersion => NativeMethods.FormatVersion(handle);
+
+    public ulong EntryCount => NativeMethods.EntryCount(handle);
+
+    /// <summary>
+    ///   The contained files in path order. Their data is read through this object when requested.
+    /// </summary>
+    public IEnumerable<ContainedFile> Entries
+    {
+        get
+        {
+            ulong count = EntryCount;
+
+            for (ulong i = 0; i < count; ++i)
+            {
+                yield return EntryAt(i);
+            }
+        }
+    }
+
+    /// <summary>
+    ///   True if the native library can be loaded and is compatible with these bindings
+    /// </summary>
+    public static bool IsAvailable()
+    {
+        try
+        {
+            return NativeMethods.GetApiVersion() >= NativeMethods.ApiVersion;
+        }
+        catch (DllNotFoundException)
+        {
+            return false;
+        }
+        catch (EntryPointNotFoundException)
+        {
+            return false;
+        }
+    }
+
+    /// <summary>
+    ///   Loads an existing PCK file
+    /// </summary>
+    /// <param name="path">Path of the file</param>
+    /// <param name="encryptionKey">The 32 byte key if the file is encrypted</param>
+    public static NativePckFile Open(string path, byte[]? encryptionKey = null)
+    {
+        if (encryptionKey != null && encryptionKey.Length != Constants.EncryptionKeySize)
+            throw new ArgumentException($"Encryption key must be {Constants.EncryptionKeySize} bytes");
+
+        NativeMethods.PckHandle handle;
+
+        fixed (byte* key = encryptionKey)
+        {
+            handle = NativeMethods.Open(path, key);
+        }
+
+        if (handle.IsInvalid)
+        {
+            handle.Dispose();
+            throw new IOException(Marshal.PtrToStringUTF8(NativeMethods.LastGlobalError(IntPtr.Zero)));
+        }
+
+        return new NativePckFile(handle, path);
+    }
+
+    /// <summary>
+    ///   Loads a PCK file from memory, the data is copied so no files are used
+    /// </summary>
+    /// <param name="data">The PCK file contents</param>
+    /// <param name="name">Used in errors and as the path <see cref="Save()"/> writes to</param>
+    /// <param name="encryptionKey">The 32 byte key if the file is encrypted</param>
+    public static NativePckFile OpenMemory(ReadOnlySpan<byte> data, string name = "memory.pck",
+        byte[]? encryptionKey = null)
+    {
+        if (encryptionKey != null && encryptionKey.Length != Constants.EncryptionKeySize)
+            throw new ArgumentException($"Encryption key must be {Constants.EncryptionKeySize} bytes");
+
+        NativeMethods.PckHandle handle;
+
+        fixed (byte* contents = data)
+        fixed (byte* key = encryptionKey)
+        {
+            handle = NativeMethods.OpenMemory(contents, (nuint)data.Length, name, key);
+        }
+
+        if (handle.IsInvalid)
+        {
+            handle.Dispose();
+            throw new IOException(Marshal.PtrToStringUTF8(NativeMethods.LastGlobalError(IntPtr.Zero)));
+        }
+
+        return new NativePckFile(handle, name);
+    }
+
+    /// <summary>
+    ///   Starts a new empty PCK file that is written to path on <see cref="Save()"/>
+    /// </summary>
+    public static NativePckFile Create(string path, uint major, uint minor, uint patch)
+    {
+        var handle = NativeMethods.Create(path, major, minor, patch);
+
+        if (handle.IsInvalid)
+        {
+            handle.Dispose();
+            throw new IOException(Marshal.PtrToStringUTF8(NativeMethods.LastGlobalError(IntPtr.Zero)));
+        }
+
+        return new NativePckFile(handle, path);
+    }
+
+    /// <summary>
+    ///   Limits the memory used for file data buffers. 0 (the default) reads each file whole.
+    /// </summary>
+    public void SetMemoryLimit(ulong bytes)
+    {
+        Check(NativeMethods.SetMemoryLimit(handle, bytes));
+    }
+
+    public ContainedFile? Find(string path)
+    {
+        NativeMethods.EntryInfo info;
+        var result = NativeMethods.Find(handle, path, &info);
+
+        if (result == NativeMethods.Result.NotFound)
+            return null;
+
+        Check(result);
+        return ToContainedFile(info);
+    }
+
+    /// <summary>
+    ///   Reads part of the data of a contained file into a buffer, filling the whole buffer
+    /// </summary>
+    public void Read(string path, ulong start, Span<byte> buffer)
+    {
+        fixed (byte* data = buffer)
+        {
+            Check(NativeMethods.Read(handle, path, start, data, (nuint)buffer.Length));
+        }
+    }
+
+    public byte[] ReadAll(string path)
+    {
+        var entry = Find(path) ?? throw new FileNotFoundException("File not found in the pck", path);
+
+        var data = new byte[checked((int)entry.Size)];
+        Read(path, 0, data);
+        return data;
+    }
+
+    /// <summary>
+    ///   Extracts all files into a folder
+    /// </summary>
+    /// <param name="outputPrefix">The folder to extract to</param>
+    /// <param name="threads">Number of threads to use, 0 uses all CPU cores</param>
+    public void Extract(string outputPrefix, uint threads = 0)
+    {
+        Check(NativeMethods.Extract(handle, outputPrefix, threads));
+    }
+
+    /// <summary>
+    ///   Checks the data of all files against their MD5 hashes
+    /// </summary>
+    /// <returns>The number of files that didn't match</returns>
+    public ulong Verify(uint threads = 0)
+    {
+        ulong mismatches;
+        Check(NativeMethods.Verify(handle, threads, &mismatches));
+        return mismatches;
+    }
+
+    /// <summary>
+    ///   Adds or replaces a file with the data of a file on disk
+    /// </summary>
+    public void AddSingleFile(string filesystemPath, string pckPath)
+    {
+        Check(NativeMethods.AddFile(handle, filesystemPath, pckPath));
+    }
+
+    /// <summary>
+    ///   Adds or replaces a file with data from a stream. The data is read only while saving so
+    ///   large files are not held in memory.
+    /// </summary>
+    /// <param name="pckPath">Path of the file in the pck</param>
+    /// <param name="source">
+    ///   A seekable stream, which is owned by this object afterwards and disposed once not needed
+    /// </param>
+    public void AddData(string pckPath, Stream source)
+    {
+        if (!source.CanSeek)
+            throw new ArgumentException("Source stream must be seekable", nameof(source));
+
+        var sourceHandle = GCHandle.Alloc(source);
+
+        // The native side calls the release callback even when adding fails
+        Check(NativeMethods.AddData(handle, pckPath, (ulong)source.Length, &ReadStream, &ReleaseStream,
+            GCHandle.ToIntPtr(sourceHandle)));
+    }
+
+    public bool Remove(string pckPath)
+    {
+        var result = NativeMethods.Remove(handle, pckPath);
+
+        if (result == NativeMethods.Result.NotFound)
+            return false;
+
+        Check(result);
+        return true;
+    }
+
+    /// <summary>
+    ///   Writes the PCK file to its path. The file data is then read from the saved file, so this
+    ///   object stays usable.
+    /// </summary>
+    public void Save()
+    {
+        Check(NativeMethods.Save(handle));
+    }
+
+    /// <summary>
+    ///   Writes the PCK file into a stream instead of its path. The whole file is built in memory
+    ///   first, without any temporary files.
+    /// </summary>
+    public void Save(Stream destination)
+    {
+        var destinationHandle = GCHandle.Alloc(destination);
+
+        try
+        {
+            Check(NativeMethods.SaveMemory(handle, &WriteStream, GCHandle.ToIntPtr(destinationHandle)));
+        }
+        finally
+        {
+            destinationHandle.Free();
+        }
+    }
+
+    public void Dispose()
+    {
+        handle.Dispose();
+    }
+
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static int ReadStream(IntPtr userData, ulong offset, byte* buffer, nuint length)
+    {
+        try
+        {
+            var source = (Stream)GCHandle.FromIntPtr(userData).Target!;
+
+            // Saving may read files from multiple threads
+            lock (source)
+            {
+                source.Seek((long)offset, SeekOrigin.Begin);
+
+                while (length > 0)
+                {
+                    int chunk = (int)Math.Min(length, int.MaxValue);
+                    source.ReadExactly(new Span<byte>(buffer, chunk));
+
+                    buffer += chunk;
+                    length -= (nuint)chunk;
+                }
+            }
+
+            return 0;
+        }
+        catch (Exception)
+        {
+            return 1;
+        }
+    }
+
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static int WriteStream(IntPtr userData, byte* data, nuint length)
+    {
+        try
+        {
+            var destination = (Stream)GCHandle.FromIntPtr(userData).Target!;
+
+            while (length > 0)
+            {
+                int chunk = (int)Math.Min(length, int.MaxValue);
+                destination.Write(new ReadOnlySpan<byte>(data, chunk));
+
+                data += chunk;
+                length -= (nuint)chunk;
+            }
+
+            return 0;
+        }
+        catch (Exception)
+        {
+            return 1;
+        }
+    }
+
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static void ReleaseStream(IntPtr userData)
+    {
+        var sourceHandle = GCHandle.FromIntPtr(userData);
+
+        try
+        {
+            ((Stream?)sourceHandle.Target)?.Dispose();
+        }
+        catch (Exception)
+        {
+            // Exceptions can't be thrown back to the native code
+        }
+
+        sourceHandle.Free();
+    }
+
+    private ContainedFile EntryAt(ulong index)
+    {
+        NativeMethods.EntryInfo info;
+        Check(NativeMethods.EntryAt(handle, index, &info));
+        return ToContainedFile(info);
+    }
+
+    private ContainedFile ToContainedFile(NativeMethods.EntryInfo info)
+    {
+        string path = Marshal.PtrToStringUTF8(info.Path) ?? string.Empty;
+
+        var file = new ContainedFile
+        {
+            Path = path,
+            Offset = info.Offset,
+            Size = info.Size,
+            Flags = info.Flags,
+            GetData = () => ReadAll(path),
+        };
+
+        new ReadOnlySpan<byte>(info.Md5, 16).CopyTo(file.Md5);
+        return file;
+    }
+
+    private void Check(NativeMethods.Result result)
+    {
+        if (result == NativeMethods.Result.Ok)
+            return;
+
+        string message = Marshal.PtrToStringUTF8(NativeMethods.LastError(handle)) ?? result.ToString();
+
+        if (result == NativeMethods.Result.InvalidArgument)
+            throw new ArgumentException(message);
+
+        if (result == NativeMethods.Result.NotFound)
+            throw new FileNotFoundException(message);
+
+        throw new IOException(message);
+    }
+}
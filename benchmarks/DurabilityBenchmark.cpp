@@ -0,0 +1,188 @@
+// Measures the cost of the durability modes when saving and extracting pck files. The results
+// depend a lot on the filesystem and the disk, so the benchmark should be run on the disk that
+// is actually used.
+//
+// Usage: durabilitybenchmark [folder to work in (default the temporary folder)]
+#include "pck/PckFile.h"
+#include "pck/PlatformFile.h"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pcktool;
+
+struct Workload {
+    const char* Name;
+    size_t Files;
+    uint64_t MinSize;
+    uint64_t MaxSize;
+};
+
+struct Mode {
+    const char* Name;
+    Durability Value;
+};
+
+//! \brief Contents of the files of a workload, shared by the entries so that the data is
+//! generated only once
+struct Files {
+    std::vector<std::shared_ptr<const std::string>> Data;
+    uint64_t TotalSize = 0;
+};
+
+static Files GenerateFiles(const Workload& workload, std::mt19937_64& random)
+{
+    std::uniform_int_distribution<uint64_t> sizes(workload.MinSize, workload.MaxSize);
+
+    Files files;
+
+    for(size_t i = 0; i < workload.Files; ++i) {
+        std::string data(sizes(random), '\0');
+
+        for(auto& character : data)
+            character = static_cast<char>(random());
+
+        files.TotalSize += data.size();
+        files.Data.push_back(std::make_shared<const std::string>(std::move(data)));
+    }
+
+    return files;
+}
+
+static void AddFiles(PckFile& pck, const Files& files)
+{
+    for(size_t i = 0; i < files.Data.size(); ++i) {
+        const auto& data = files.Data[i];
+
+        PckFile::ContainedFile file;
+        file.Path = "res://folder" + std::to_string(i % 32) + "/file" + std::to_string(i);
+        file.Offset = -1;
+        file.Size = data->size();
+        file.GetData = [data]() { return *data; };
+
+        pck.AddFile(std::move(file));
+    }
+}
+
+//! \brief Writes everything earlier runs left in the page cache to disk, so that it doesn't
+//! slow down the next run
+static void FlushEarlierWrites(const std::string& path)
+{
+    WritableFile file;
+
+    if(file.OpenForAppend(path))
+        file.SyncFilesystem();
+}
+
+//! \returns The best time of a few runs of each mode in seconds. The modes take turns so that
+//! changes in the speed of the disk affect all of them the same. prepare is called before each
+//! run and isn't included in the time.
+template<size_t Count>
+static std::array<double, Count> Measure(const std::array<Mode, Count>& modes,
+    const std::function<void()>& prepare, const std::function<bool(Durability)>& run)
+{
+    std::array<double, Count> best{};
+
+    for(int i = 0; i < 3; ++i) {
+        for(size_t mode = 0; mode < Count; ++mode) {
+            prepare();
+
+            const auto start = std::chrono::steady_clock::now();
+
+            if(!run(modes[mode].Value))
+                throw std::runtime_error("benchmarked operation failed");
+
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            if(i == 0 || elapsed.count() < best[mode])
+                best[mode] = elapsed.count();
+        }
+    }
+
+    return best;
+}
+
+static void PrintResult(const char* operation, const char* mode, double seconds,
+    const Workload& workload, const Files& files)
+{
+    const auto megabytes = static_cast<double>(files.TotalSize) / (1024 * 1024);
+
+    std::cout << "  " << std::left << std::setw(8) << operation << std::setw(8) << mode
+              << std::right << std::fixed << std::setprecision(3) << std::setw(8) << seconds
+              << " s" << std::setprecision(1) << std::setw(10) << megabytes / seconds
+              << " MiB/s" << std::setw(10) << std::setprecision(0)
+              << static_cast<double>(workload.Files) / seconds << " files/s\n";
+}
+
+int main(int argc, char* argv[])
+{
+    const auto base = argc > 1 ? std::filesystem::path(argv[1]) :
+                                 std::filesystem::temp_directory_path();
+    const auto folder = base / "godotpcktool_durability_benchmark";
+
+    const std::array<Workload, 2> workloads = {
+        {{"many small files (0-16 KiB)", 20000, 0, 16 * 1024},
+            {"few large files (16-32 MiB)", 16, 16 * 1024 * 1024, 32 * 1024 * 1024}}};
+
+    const std::array<Mode, 3> modes = {{{"normal", Durability::Normal},
+        {"fast", Durability::Fast}, {"safe", Durability::Safe}}};
+
+    std::filesystem::create_directories(folder);
+
+    const auto pckPath = (folder / "benchmark.pck").string();
+    const auto extractPath = (folder / "extracted").string();
+
+    std::mt19937_64 random(42);
+
+    try {
+        for(const auto& workload : workloads) {
+            const auto files = GenerateFiles(workload, random);
+
+            std::cout << workload.Name << ", " << workload.Files << " files:\n";
+
+            const auto saveSeconds = Measure(
+                modes, [&]() { FlushEarlierWrites(pckPath); },
+                [&](Durability durability) {
+                    PckFile pck(pckPath);
+                    pck.SetGodotVersion(4, 3, 0);
+                    pck.SetDurability(durability);
+                    AddFiles(pck, files);
+                    return pck.Save();
+                });
+
+            for(size_t i = 0; i < modes.size(); ++i)
+                PrintResult("save", modes[i].Name, saveSeconds[i], workload, files);
+
+            const auto extractSeconds = Measure(
+                modes,
+                [&]() {
+                    std::filesystem::remove_all(extractPath);
+                    FlushEarlierWrites(pckPath);
+                },
+                [&](Durability durability) {
+                    PckFile pck(pckPath);
+                    pck.SetDurability(durability);
+                    return pck.Load() && pck.Extract(extractPath, false);
+                });
+
+            for(size_t i = 0; i < modes.size(); ++i)
+                PrintResult("extract", modes[i].Name, extractSeconds[i], workload, files);
+        }
+    } catch(const std::exception& e) {
+        std::cout << "ERROR: " << e.what() << "\n";
+        std::filesystem::remove_all(folder);
+        return 1;
+    }
+
+    std::filesystem::remove_all(folder);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// Measures the single core hashing speed of the MD5Engine implementations and checks that they
+// give the same results as the md5 library
+//
+// Usage: md5benchmark [total size in MiB (default 256)]
+#include "pck/MD5Engine.h"
+
+#include "md5.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pcktool;
+
+struct Workload {
+    const char* Name;
+    uint64_t MinSize;
+    uint64_t MaxSize;
+};
+
+//! \brief Data for one workload, the files are stored back to back in a single buffer
+struct Files {
+    std::string Data;
+    std::vector<uint64_t> Offsets;
+    std::vector<uint64_t> Sizes;
+};
+
+static Files GenerateFiles(
+    const Workload& workload, uint64_t totalSize, std::mt19937_64& random)
+{
+    std::uniform_int_distribution<uint64_t> sizes(workload.MinSize, workload.MaxSize);
+
+    Files files;
+
+    uint64_t size = 0;
+
+    while(size < totalSize) {
+        const auto fileSize = sizes(random);
+        files.Offsets.push_back(size);
+        files.Sizes.push_back(fileSize);
+        size += fileSize;
+    }
+
+    files.Data.resize(size);
+
+    for(auto& character : files.Data)
+        character = static_cast<char>(random());
+
+    return files;
+}
+
+static std::vector<MD5Engine::Job> MakeJobs(
+    const Files& files, std::vector<std::array<uint8_t, 16>>& results)
+{
+    results.assign(files.Sizes.size(), {});
+
+    std::vector<MD5Engine::Job> jobs;
+    jobs.reserve(files.Sizes.size());
+
+    for(size_t i = 0; i < files.Sizes.size(); ++i) {
+        jobs.push_back(
+            {files.Data.data() + files.Offsets[i], files.Sizes[i], results[i].data()});
+    }
+
+    return jobs;
+}
+
+//! \returns The best time of a few runs in seconds
+template<typename Function>
+static double Measure(Function function)
+{
+    double best = 0;
+
+    for(int i = 0; i < 3; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if(i == 0 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+
+    return best;
+}
+
+static void PrintResult(const char* name, double seconds, const Files& files)
+{
+    const auto megabytes = static_cast<double>(files.Data.size()) / (1024 * 1024);
+
+    std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << megabytes / seconds << " MiB/s"
+              << std::setw(12) << std::setprecision(0)
+              << static_cast<double>(files.Sizes.size()) / seconds << " files/s\n";
+}
+
+//! \brief Checks every size up to a few blocks as those have the most padding cases
+static bool CheckSizes(MD5Engine::Implementation implementation)
+{
+    constexpr size_t maxSize = 300;
+
+    std::string data(maxSize, '\0');
+
+    for(size_t i = 0; i < maxSize; ++i)
+        data[i] = static_cast<char>(i * 7 + 3);
+
+    std::vector<std::array<uint8_t, 16>> results(maxSize + 1);
+    std::vector<MD5Engine::Job> jobs;
+
+    for(size_t size = 0; size <= maxSize; ++size)
+        jobs.push_back({data.data() + (maxSize - size), size, results[size].data()});
+
+    MD5Engine(implementation).Hash(jobs.data(), jobs.size());
+
+    for(size_t size = 0; size <= maxSize; ++size) {
+        std::array<uint8_t, 16> expected;
+        md5::md5_t(
+            data.data() + (maxSize - size), static_cast<unsigned>(size), expected.data());
+
+        if(results[size] != expected) {
+            std::cout << "ERROR: " << MD5Engine::GetName(implementation)
+                      << " result differs from the md5 library for size " << size << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t totalSize = 256 * 1024 * 1024;
+
+    if(argc > 1)
+        totalSize = std::stoull(argv[1]) * 1024 * 1024;
+
+    const std::array<MD5Engine::Implementation, 4> implementations = {
+        MD5Engine::Implementation::Scalar, MD5Engine::Implementation::SSE2,
+        MD5Engine::Implementation::AVX2, MD5Engine::Implementation::AVX512};
+
+    const std::array<Workload, 4> workloads = {{{"tiny files (0-1 KiB)", 0, 1024},
+        {"small files (1-16 KiB)", 1024, 16 * 1024},
+        {"medium files (16-256 KiB)", 16 * 1024, 256 * 1024},
+        {"mixed sizes (0-4 MiB)", 0, 4 * 1024 * 1024}}};
+
+    std::cout << "Best implementation on this CPU: "
+              << MD5Engine::GetName(MD5Engine::GetBestImplementation()) << "\n";
+
+    bool success = true;
+
+    for(const auto implementation : implementations) {
+        if(MD5Engine::IsSupported(implementation) && !CheckSizes(implementation))
+            success = false;
+    }
+
+    std::mt19937_64 random(42);
+
+    for(const auto& workload : workloads) {
+        const auto files = GenerateFiles(workload, totalSize, random);
+
+        std::cout << workload.Name << ", " << files.Sizes.size() << " files:\n";
+
+        std::vector<std::array<uint8_t, 16>> expected(files.Sizes.size());
+
+        const auto librarySeconds = Measure([&]() {
+            for(size_t i = 0; i < files.Sizes.size(); ++i) {
+                md5::md5_t(files.Data.data() + files.Offsets[i],
+                    static_cast<unsigned>(files.Sizes[i]), expected[i].data());
+            }
+        });
+
+        PrintResult("library", librarySeconds, files);
+
+        for(const auto implementation : implementations) {
+            if(!MD5Engine::IsSupported(implementation))
+                continue;
+
+            const MD5Engine engine(implementation);
+
+            std::vector<std::array<uint8_t, 16>> results;
+            const auto jobs = MakeJobs(files, results);
+
+            const auto seconds = Measure([&]() { engine.Hash(jobs.data(), jobs.size()); });
+
+            PrintResult(MD5Engine::GetName(implementation), seconds, files);
+
+            if(results != expected) {
+                std::cout << "ERROR: " << MD5Engine::GetName(implementation)
+                          << " results differ from the md5 library\n";
+                success = false;
+            }
+        }
+    }
+
+    if(!success)
+        return 1;
+
+    std::cout << "All results match the md5 library\n";
+    return 0;
+}
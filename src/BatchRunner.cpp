@@ -0,0 +1,334 @@
+// ------------------------------------ //
+#include "BatchRunner.h"
+
+#include "pck/BufferPool.h"
+#include "pck/PckFile.h"
+#include "pck/WorkerPool.h"
+
+#include "md5.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+using namespace pcktool;
+
+namespace {
+
+//! \brief Sends everything printed to std::cout to std::cerr while alive
+//!
+//! Keeps the messages from loading packs from mixing with the JSON output
+class StdoutToStderr {
+public:
+    StdoutToStderr() : Original(std::cout.rdbuf(std::cerr.rdbuf())) {}
+
+    ~StdoutToStderr()
+    {
+        std::cout.rdbuf(Original);
+    }
+
+    StdoutToStderr(const StdoutToStderr& other) = delete;
+    StdoutToStderr& operator=(const StdoutToStderr& other) = delete;
+
+private:
+    std::streambuf* Original;
+};
+
+std::string HashToString(const std::array<uint8_t, 16>& hash)
+{
+    char buffer[MD5_STRING_SIZE];
+
+    static_assert(sizeof(hash) == MD5_SIZE);
+    md5::sig_to_string(hash.data(), buffer, MD5_STRING_SIZE);
+
+    return std::string(buffer, std::strlen(buffer));
+}
+
+} // namespace
+
+// ------------------------------------ //
+BatchRunner::BatchRunner(const PckTool::Options& options, std::vector<std::string> inputs) :
+    Opts(options), Inputs(std::move(inputs))
+{}
+// ------------------------------------ //
+int BatchRunner::Run()
+{
+    const auto& operation = Opts.BatchOperation;
+
+    if(operation != "list" && operation != "verify" && operation != "extract" &&
+        operation != "stats") {
+        std::cout << "ERROR: unknown batch operation: " << operation
+                  << " (expected list, verify, extract or stats)\n";
+        return 1;
+    }
+
+    if(operation == "extract" && Opts.Output.empty()) {
+        std::cout << "ERROR: batch extract requires an output folder\n";
+        return 1;
+    }
+
+    std::vector<std::string> packs;
+
+    if(!ResolveInputs(Inputs, packs))
+        return 1;
+
+    if(packs.empty()) {
+        std::cout << "ERROR: no pck files to process\n";
+        return 1;
+    }
+
+    // Each pck is extracted to a folder named after it, so packs with the same name would be
+    // extracted over each other (the names are compared ignoring case for filesystems that do
+    // that)
+    if(operation == "extract") {
+        std::unordered_map<std::string, const std::string*> targets;
+
+        for(const auto& pack : packs) {
+            auto name = std::filesystem::path(pack).stem().string();
+            std::transform(name.begin(), name.end(), name.begin(),
+                [](unsigned char character) { return std::tolower(character); });
+
+            const auto [existing, added] = targets.emplace(name, &pack);
+
+            if(!added) {
+                std::cout << "ERROR: packs would be extracted to the same folder: "
+                          << *existing->second << " and " << pack << "\n";
+                return 1;
+            }
+        }
+    }
+
+    std::vector<json> results(packs.size());
+
+    {
+        StdoutToStderr redirect;
+
+        WorkerPool pool(Opts.Threads);
+
+        // All packs share the memory budget
+        std::unique_ptr<BufferPool> buffers;
+
+        if(Opts.MaxMemory != 0)
+            buffers = std::make_unique<BufferPool>(Opts.MaxMemory);
+
+        std::cout << "Processing " << packs.size() << " packs with " << pool.GetThreadCount()
+                  << " threads\n";
+
+        WorkerPool::TaskGroup group(pool);
+
+        for(size_t i = 0; i < packs.size(); ++i) {
+            group.Run([this, &pool, &buffers, &results, &packs, i]() {
+                try {
+                    results[i] = ProcessPack(packs[i], pool, buffers.get());
+                } catch(const std::exception& e) {
+                    results[i] = {{"pack", packs[i]}, {"ok", false}, {"error", e.what()}};
+                }
+            });
+        }
+
+        group.Wait();
+    }
+
+    json summary = {{"packs", packs.size()}, {"failed", 0}, {"files", 0}, {"dataSize", 0}};
+
+    if(operation == "verify")
+        summary["mismatched"] = 0;
+
+    for(const auto& result : results) {
+        if(!result.value("ok", false))
+            summary["failed"] = summary["failed"].get<size_t>() + 1;
+
+        summary["files"] = summary["files"].get<size_t>() + result.value("files", size_t(0));
+        summary["dataSize"] =
+            summary["dataSize"].get<uint64_t>() + result.value("dataSize", uint64_t(0));
+
+        if(operation == "verify" && result.contains("mismatched")) {
+            summary["mismatched"] =
+                summary["mismatched"].get<size_t>() + result["mismatched"].size();
+        }
+    }
+
+    const json output = {{"operation", operation}, {"packs", results}, {"summary", summary}};
+
+    std::cout << output.dump(2) << "\n";
+
+    return summary["failed"].get<size_t>() == 0 ? 0 : 2;
+}
+// ------------------------------------ //
+json BatchRunner::ProcessPack(
+    const std::string& pack, WorkerPool& pool, BufferPool* buffers) const
+{
+    json result = {{"pack", pack}};
+
+    PckFile pck(pack);
+
+    pck.SetIncludeFilter(
+        std::bind(&FileFilter::Include, Opts.Filter, std::placeholders::_1),
+        Opts.Filter.GetPrefilter());
+    pck.SetUseSidecarIndex(Opts.SidecarIndex);
+    pck.SetDurability(Opts.DurabilityMode);
+    pck.SetWorkerPool(&pool);
+    pck.SetBufferPool(buffers);
+
+    if(Opts.Key)
+        pck.SetEncryptionKey(*Opts.Key);
+
+    if(!pck.Load()) {
+        result["ok"] = false;
+        result["error"] = "couldn't load pck file";
+        return result;
+    }
+
+    uint64_t dataSize = 0;
+
+    for(const auto& [_, entry] : pck.GetContents())
+        dataSize += entry.Size;
+
+    result["formatVersion"] = pck.GetFormatVersion();
+    result["godotVersion"] = pck.GetGodotVersion();
+    result["files"] = pck.GetContents().size();
+    result["dataSize"] = dataSize;
+    result["ok"] = true;
+
+    const auto& operation = Opts.BatchOperation;
+
+    if(operation == "stats") {
+        result["pckSize"] = std::filesystem::file_size(pack);
+    } else if(operation == "list") {
+        json entries = json::array();
+
+        for(const auto& [path, entry] : pck.GetContents()) {
+            entries.push_back({{"path", path}, {"offset", entry.Offset}, {"size", entry.Size},
+                {"md5", HashToString(entry.MD5)}, {"flags", entry.Flags}});
+        }
+
+        result["entries"] = std::move(entries);
+    } else if(operation == "verify") {
+        const auto verify = pck.Verify(false);
+
+        result["verified"] = verify.Verified;
+        result["unhashed"] = verify.Unhashed;
+        result["mismatched"] = verify.Mismatched;
+
+        if(!verify.Mismatched.empty())
+            result["ok"] = false;
+    } else if(operation == "extract") {
+        const auto target =
+            (std::filesystem::path(Opts.Output) / std::filesystem::path(pack).stem()).string();
+
+        result["output"] = target;
+
+        if(!pck.Extract(target, false)) {
+            result["ok"] = false;
+            result["error"] = "extraction failed";
+        }
+    }
+
+    return result;
+}
+// ------------------------------------ //
+bool BatchRunner::ResolveInputs(
+    const std::vector<std::string>& inputs, std::vector<std::string>& resolved)
+{
+    for(const auto& input : inputs) {
+        if(!input.empty() && input.front() == '@') {
+            // File containing a list of packs, one per line
+            std::ifstream reader(input.substr(1));
+
+            if(!reader.good()) {
+                std::cout << "ERROR: can't read pck list file: " << input.substr(1) << "\n";
+                return false;
+            }
+
+            std::vector<std::string> listed;
+            std::string line;
+
+            while(std::getline(reader, line)) {
+                while(!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                    line.pop_back();
+
+                if(!line.empty())
+                    listed.push_back(line);
+            }
+
+            if(!ResolveInputs(listed, resolved))
+                return false;
+
+            continue;
+        }
+
+        if(input.find_first_of("*?") == std::string::npos) {
+            resolved.push_back(input);
+            continue;
+        }
+
+        const auto path = std::filesystem::path(input);
+        const auto folder = path.has_parent_path() ? path.parent_path() : ".";
+        const auto pattern = path.filename().string();
+
+        if(folder.string().find_first_of("*?") != std::string::npos) {
+            std::cout << "ERROR: wildcards are only supported in the file name: " << input
+                      << "\n";
+            return false;
+        }
+
+        std::vector<std::string> matches;
+
+        try {
+            for(const auto& entry : std::filesystem::directory_iterator(folder)) {
+                if(!entry.is_directory() &&
+                    MatchesWildcard(pattern, entry.path().filename().string())) {
+                    matches.push_back(
+                        path.has_parent_path() ? entry.path().string() :
+                                                 entry.path().filename().string());
+                }
+            }
+        } catch(const std::filesystem::filesystem_error& e) {
+            std::cout << "ERROR: can't list folder for pattern " << input << ": " << e.what()
+                      << "\n";
+            return false;
+        }
+
+        std::sort(matches.begin(), matches.end());
+        resolved.insert(resolved.end(), matches.begin(), matches.end());
+    }
+
+    return true;
+}
+
+bool BatchRunner::MatchesWildcard(const std::string& pattern, const std::string& text)
+{
+    size_t patternPos = 0;
+    size_t textPos = 0;
+
+    // Position to backtrack to after the last star
+    size_t starPos = std::string::npos;
+    size_t starMatch = 0;
+
+    while(textPos < text.size()) {
+        if(patternPos < pattern.size() &&
+            (pattern[patternPos] == '?' || pattern[patternPos] == text[textPos])) {
+            ++patternPos;
+            ++textPos;
+        } else if(patternPos < pattern.size() && pattern[patternPos] == '*') {
+            starPos = patternPos++;
+            starMatch = textPos;
+        } else if(starPos != std::string::npos) {
+            patternPos = starPos + 1;
+            textPos = ++starMatch;
+        } else {
+            return false;
+        }
+    }
+
+    while(patternPos < pattern.size() && pattern[patternPos] == '*')
+        ++patternPos;
+
+    return patternPos == pattern.size();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckTool.h"
+
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+class BufferPool;
+class WorkerPool;
+
+//! \brief Runs an operation on many pck files at once
+//!
+//! All the packs share one worker pool, both the packs and the files inside them are
+//! processed in parallel. The results are printed as a single JSON document.
+class BatchRunner {
+public:
+    BatchRunner(const PckTool::Options& options, std::vector<std::string> inputs);
+
+    //! \returns The exit code to return
+    int Run();
+
+    //! \brief Expands wildcards (* and ?) in the file name part and @file lists
+    static bool ResolveInputs(
+        const std::vector<std::string>& inputs, std::vector<std::string>& resolved);
+
+    static bool MatchesWildcard(const std::string& pattern, const std::string& text);
+
+private:
+    json ProcessPack(const std::string& pack, WorkerPool& pool, BufferPool* buffers) const;
+
+private:
+    const PckTool::Options& Opts;
+
+    std::vector<std::string> Inputs;
+};
+
+} // namespace pcktool
@@ -0,0 +1,290 @@
+// ------------------------------------ //
+#include "CommandReader.h"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+using namespace pcktool;
+
+namespace {
+
+using json = nlohmann::json;
+
+//! \brief SAX handler that collects file commands without building a JSON document
+class CommandHandler : public nlohmann::json_sax<json> {
+public:
+    //! \param objectDepth Nesting depth the command objects are at
+    CommandHandler(int objectDepth, CommandReader::Callback& callback, size_t& readCount) :
+        ObjectDepth(objectDepth), OnCommand(callback), ReadCount(readCount)
+    {}
+
+    bool null() override
+    {
+        return Scalar("null");
+    }
+
+    bool boolean(bool) override
+    {
+        return Scalar("a boolean");
+    }
+
+    bool number_integer(number_integer_t) override
+    {
+        return Scalar("a number");
+    }
+
+    bool number_unsigned(number_unsigned_t) override
+    {
+        return Scalar("a number");
+    }
+
+    bool number_float(number_float_t, const string_t&) override
+    {
+        return Scalar("a number");
+    }
+
+    bool string(string_t& value) override
+    {
+        if(Depth != ObjectDepth)
+            return Scalar("a string");
+
+        if(CurrentKey == Key::File) {
+            File = std::move(value);
+            HasFile = true;
+        } else if(CurrentKey == Key::Target) {
+            Target = std::move(value);
+            HasTarget = true;
+        }
+
+        return true;
+    }
+
+    bool binary(binary_t&) override
+    {
+        return Scalar("binary data");
+    }
+
+    bool start_object(std::size_t) override
+    {
+        ++Depth;
+
+        if(Depth < ObjectDepth)
+            return Fail("expected a JSON array of objects");
+
+        if(Depth == ObjectDepth) {
+            HasFile = false;
+            HasTarget = false;
+            CurrentKey = Key::Other;
+        } else if(Depth == ObjectDepth + 1 && CurrentKey != Key::Other) {
+            return Fail("file and target must be strings");
+        }
+
+        return true;
+    }
+
+    bool key(string_t& value) override
+    {
+        if(Depth == ObjectDepth) {
+            if(value == "file") {
+                CurrentKey = Key::File;
+            } else if(value == "target") {
+                CurrentKey = Key::Target;
+            } else {
+                CurrentKey = Key::Other;
+            }
+        }
+
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if(Depth == ObjectDepth) {
+            if(!HasFile || !HasTarget)
+                return Fail("object is missing the file or target property");
+
+            ++ReadCount;
+
+            if(!OnCommand(File, Target)) {
+                Stopped = true;
+                return false;
+            }
+        }
+
+        --Depth;
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        ++Depth;
+
+        if(Depth == ObjectDepth)
+            return Fail("expected an object");
+
+        if(Depth == ObjectDepth + 1 && CurrentKey != Key::Other)
+            return Fail("file and target must be strings");
+
+        return true;
+    }
+
+    bool end_array() override
+    {
+        --Depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+        const nlohmann::detail::exception& exception) override
+    {
+        return Fail(exception.what());
+    }
+
+    [[nodiscard]] const std::string& GetError() const
+    {
+        return Error;
+    }
+
+    [[nodiscard]] bool WasStopped() const
+    {
+        return Stopped;
+    }
+
+private:
+    enum class Key { File, Target, Other };
+
+    bool Scalar(const char* type)
+    {
+        // Other properties in the command objects are ignored
+        if(Depth > ObjectDepth || (Depth == ObjectDepth && CurrentKey == Key::Other))
+            return true;
+
+        if(Depth == ObjectDepth)
+            return Fail("file and target must be strings");
+
+        return Fail(std::string("unexpected ") + type);
+    }
+
+    bool Fail(std::string message)
+    {
+        if(Error.empty())
+            Error = std::move(message);
+
+        return false;
+    }
+
+private:
+    const int ObjectDepth;
+    CommandReader::Callback& OnCommand;
+    size_t& ReadCount;
+
+    int Depth = 0;
+    Key CurrentKey = Key::Other;
+
+    // Reused between the commands
+    std::string File;
+    std::string Target;
+    bool HasFile = false;
+    bool HasTarget = false;
+
+    std::string Error;
+    bool Stopped = false;
+};
+
+} // namespace
+
+// ------------------------------------ //
+CommandReader::CommandReader(Callback callback) : OnCommand(std::move(callback)) {}
+// ------------------------------------ //
+bool CommandReader::ReadSource(const std::string& source)
+{
+    if(source == "-") {
+        std::cout << "Reading JSON file commands from STDIN until EOF...\n";
+
+        const auto before = ReadCount;
+        const bool result = Read(std::cin);
+
+        std::cout << "Finished reading STDIN (commands: " << ReadCount - before << ").\n";
+        return result;
+    }
+
+    std::cout << "Reading JSON commands from file: " << source << "\n";
+
+    // A big read buffer as command files can be very large
+    const auto buffer = std::make_unique<char[]>(1024 * 1024);
+
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.get(), 1024 * 1024);
+    file.open(source, std::ios::in | std::ios::binary);
+
+    if(!file.good()) {
+        std::cout << "ERROR: failed to open the command file: " << source << "\n";
+        return false;
+    }
+
+    return Read(file);
+}
+
+bool CommandReader::Read(std::istream& input)
+{
+    input >> std::ws;
+
+    const auto first = input.peek();
+
+    if(first == std::char_traits<char>::eof()) {
+        std::cout << "ERROR: no JSON commands in input\n";
+        return false;
+    }
+
+    // A single array or one object per line
+    if(first == '[')
+        return ReadArray(input);
+
+    return ReadLines(input);
+}
+// ------------------------------------ //
+bool CommandReader::ReadArray(std::istream& input)
+{
+    CommandHandler handler(2, OnCommand, ReadCount);
+
+    if(json::sax_parse(input, &handler))
+        return true;
+
+    if(handler.WasStopped())
+        return false;
+
+    std::cout << "ERROR: invalid JSON command (after " << ReadCount
+              << " commands): " << handler.GetError() << "\n";
+    return false;
+}
+
+bool CommandReader::ReadLines(std::istream& input)
+{
+    CommandHandler handler(1, OnCommand, ReadCount);
+
+    std::string line;
+    size_t lineNumber = 0;
+
+    while(std::getline(input, line)) {
+        ++lineNumber;
+
+        if(line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        if(json::sax_parse(line, &handler))
+            continue;
+
+        if(handler.WasStopped())
+            return false;
+
+        std::cout << "ERROR: invalid JSON command on line " << lineNumber << ": "
+                  << handler.GetError() << "\n";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Define.h"
+
+#include <functional>
+#include <istream>
+#include <string>
+
+namespace pcktool {
+
+//! \brief Streaming reader for JSON file commands
+//!
+//! Accepts either a single JSON array of {"file": ..., "target": ...} objects or NDJSON with
+//! one such object per line. The commands are passed to a callback as they are parsed so the
+//! whole input never needs to be in memory.
+class CommandReader {
+public:
+    //! \brief Receives one command, the strings can be moved from. Return false to stop.
+    using Callback = std::function<bool(std::string& file, std::string& target)>;
+
+public:
+    explicit CommandReader(Callback callback);
+
+    //! \brief Reads all commands from a stream
+    //! \returns False on a parse error (which has been printed already)
+    bool Read(std::istream& input);
+
+    //! \brief Reads commands from a file, or from stdin if the path is "-"
+    bool ReadSource(const std::string& source);
+
+    [[nodiscard]] size_t GetReadCount() const
+    {
+        return ReadCount;
+    }
+
+private:
+    bool ReadArray(std::istream& input);
+    bool ReadLines(std::istream& input);
+
+private:
+    Callback OnCommand;
+
+    size_t ReadCount = 0;
+};
+
+} // namespace pcktool
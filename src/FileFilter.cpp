@@ -1,7 +1,64 @@
 // ------------------------------------ //
 #include "FileFilter.h"
 
+#include <cctype>
+#include <cstring>
+
 using namespace pcktool;
+
+//! \brief Finds text that every match of an ECMAScript regex contains, for example
+//! "^res://localization/" must start with "res://localization/"
+//!
+//! This only understands a plain start of the pattern and gives up on anything more complex,
+//! as returning text that isn't required would exclude files that should be included.
+static std::optional<PckFile::EntryPrefilter::PathLiteral> RequiredLiteral(
+    const std::string& pattern)
+{
+    // Alternatives could match without the literal
+    if(pattern.find('|') != std::string::npos)
+        return std::nullopt;
+
+    PckFile::EntryPrefilter::PathLiteral literal;
+    size_t position = 0;
+
+    if(!pattern.empty() && pattern[0] == '^') {
+        literal.Anchored = true;
+        ++position;
+    }
+
+    while(position < pattern.size()) {
+        char character = pattern[position];
+        size_t next = position + 1;
+
+        if(character == '\\') {
+            // Only escaped punctuation is a literal character, things like \d are classes
+            if(next >= pattern.size() ||
+                !std::ispunct(static_cast<unsigned char>(pattern[next])))
+                break;
+
+            character = pattern[next];
+            ++next;
+        } else if(std::strchr(".[](){}*+?^$", character) != nullptr) {
+            break;
+        }
+
+        // A character that can be left out ends the literal before it
+        if(next < pattern.size() && std::strchr("*?{", pattern[next]) != nullptr)
+            break;
+
+        literal.Text.push_back(character);
+        position = next;
+
+        // A repeated character is still required once
+        if(next < pattern.size() && pattern[next] == '+')
+            break;
+    }
+
+    if(literal.Text.empty())
+        return std::nullopt;
+
+    return literal;
+}
 // ------------------------------------ //
 bool FileFilter::Include(const PckFile::ContainedFile& file) const
 {
@@ -44,3 +101,29 @@ bool FileFilter::Include(const PckFile::ContainedFile& file) const
     return true;
 }
 // ------------------------------------ //
+PckFile::EntryPrefilter FileFilter::GetPrefilter() const
+{
+    PckFile::EntryPrefilter prefilter;
+
+    // Override patterns include files regardless of the other checks
+    if(!OverridePatterns.empty())
+        return prefilter;
+
+    prefilter.MinSize = MinSizeLimit;
+    prefilter.MaxSize = MaxSizeLimit;
+
+    // A path only needs to match one include pattern, so all of them need a literal
+    for(const auto& text : IncludeTexts) {
+        auto literal = RequiredLiteral(text);
+
+        if(!literal) {
+            prefilter.PathLiterals.clear();
+            break;
+        }
+
+        prefilter.PathLiterals.push_back(std::move(*literal));
+    }
+
+    return prefilter;
+}
+// ------------------------------------ //
@@ -5,8 +5,11 @@
 #include "pck/PckFile.h"
 
 #include <limits>
+#include <optional>
 #include <regex>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace pcktool {
 
@@ -16,6 +19,17 @@ public:
     //! \returns true if filter doesn't exclude a file
     [[nodiscard]] bool Include(const PckFile::ContainedFile& file) const;
 
+    //! \brief Cheap checks that all included files pass, for rejecting most entries while
+    //! loading a pck without running the full filter on them
+    [[nodiscard]] PckFile::EntryPrefilter GetPrefilter() const;
+
+    //! \returns true if no filtering options are set, which means all files are included
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return MinSizeLimit == 0 && MaxSizeLimit == std::numeric_limits<uint64_t>::max() &&
+               IncludePatterns.empty() && ExcludePatterns.empty() && OverridePatterns.empty();
+    }
+
     void SetSizeMinLimit(uint64_t size)
     {
         MinSizeLimit = size;
@@ -26,9 +40,13 @@ public:
         MaxSizeLimit = size;
     }
 
-    void SetIncludeRegexes(const std::vector<std::regex>& filters)
+    //! \param texts The source of the filters, used to find text that matching paths must
+    //! contain for GetPrefilter
+    void SetIncludeRegexes(
+        const std::vector<std::regex>& filters, const std::vector<std::string>& texts)
     {
         IncludePatterns = filters;
+        IncludeTexts = texts;
     }
 
     void SetExcludeRegexes(const std::vector<std::regex>& filters)
@@ -51,6 +69,7 @@ private:
     //! If non-empty any passed in files must pass regex_search in at least one regex
     //! specified in here
     std::vector<std::regex> IncludePatterns;
+    std::vector<std::string> IncludeTexts;
 
     //! If non-empty then any files that pass the IncludePatterns filter (or if it is empty
     //! any file being checked) must not regex_search find a match in any regexes in this
@@ -1,15 +1,45 @@
 // ------------------------------------ //
 #include "PckTool.h"
 
+#include "BatchRunner.h"
+#include "CommandReader.h"
+#include "pck/BufferPool.h"
+#include "pck/DirectoryWatcher.h"
+#include "pck/ExtractJournal.h"
+#include "pck/PckAnalyzer.h"
+#include "pck/PckDelta.h"
 #include "pck/PckFile.h"
+#include "pck/OutputBuffer.h"
+#include "pck/PckIndex.h"
+#include "pck/PckManifest.h"
+#include "pck/PckOverlay.h"
+#include "pck/PckSync.h"
+#include "pck/WorkerPool.h"
 
+#include "md5.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <unordered_map>
 #include <utility>
 
 using namespace pcktool;
+
+//! The watch action applies changes once no more have arrived for the quiet time, or the max
+//! wait has passed since the first one
+constexpr auto WATCH_QUIET_TIME = std::chrono::milliseconds(200);
+constexpr auto WATCH_MAX_WAIT = std::chrono::seconds(2);
 // ------------------------------------ //
 PckTool::PckTool(Options options) : Opts(std::move(options)) {}
+
+PckTool::~PckTool() = default;
 // ------------------------------------ //
 int PckTool::Run()
 {
@@ -17,11 +47,25 @@ int PckTool::Run()
         return 1;
 
     if(Opts.Action == "list" || Opts.Action == "l") {
+        if(Opts.ListFormat != "text" && Opts.ListFormat != "ndjson" &&
+            Opts.ListFormat != "csv") {
+            std::cout << "ERROR: unknown list format: " << Opts.ListFormat
+                      << " (expected text, ndjson or csv)\n";
+            return 1;
+        }
+
         auto pck = LoadPck();
 
         if(!pck)
             return 2;
 
+        // Machine readable formats only output the file records
+        if(Opts.ListFormat != "text") {
+            pck->WriteFileList(
+                std::cout, Opts.ListFormat == "csv" ? ListFormat::CSV : ListFormat::NDJSON);
+            return 0;
+        }
+
         std::cout << "Pck version: " << pck->GetFormatVersion()
                   << ", Godot: " << pck->GetGodotVersion() << "\n";
         std::cout << "Contents of '" << Opts.Pack << "':\n";
@@ -47,6 +91,9 @@ int PckTool::Run()
             pck->ChangePath(Files.front().InputFile);
         }
 
+        if(!ApplySaveOptions(*pck))
+            return 1;
+
         std::cout << "Repacking to: " << pck->GetPath() << "\n";
 
         if(!pck->Save()) {
@@ -54,6 +101,8 @@ int PckTool::Run()
             return 2;
         }
 
+        PrintPaddingReport(*pck);
+
         std::cout << "Repack complete\n";
         return 0;
     } else if(Opts.Action == "extract" || Opts.Action == "e") {
@@ -64,16 +113,36 @@ int PckTool::Run()
 
         std::cout << "Extracting to: " << Opts.Output << "\n";
 
-        if(!pck->Extract(Opts.Output, !Opts.ReducedVerbosity)) {
+        std::unique_ptr<ExtractJournal> journal;
+
+        if(Opts.Resume) {
+            journal = std::make_unique<ExtractJournal>(
+                ExtractJournal::PathFor(Opts.Output), Opts.Output);
+
+            if(!journal->Open())
+                return 2;
+
+            std::cout << "Using extract journal: " << journal->GetPath() << "\n";
+        }
+
+        if(!pck->Extract(Opts.Output, PrintEachFile(), journal.get())) {
             std::cout << "ERROR: extraction failed\n";
+
+            if(journal)
+                std::cout << "Run the extraction again with --resume to continue it\n";
+
             return 2;
         }
 
+        // Everything is done so the next extraction starts from scratch
+        if(journal)
+            journal->Remove();
+
         std::cout << "Extraction completed\n";
 
         return 0;
     } else if(Opts.Action == "add" || Opts.Action == "a") {
-        if(Files.empty()) {
+        if(Files.empty() && Opts.CommandFiles.empty()) {
             std::cout << "ERROR: no files specified\n";
             return 1;
         }
@@ -93,7 +162,7 @@ int PckTool::Run()
         } else {
             pck = std::make_unique<PckFile>(Opts.Pack);
 
-            SetIncludeFilter(*pck);
+            ConfigurePck(*pck);
 
             pck->SetGodotVersion(Opts.GodotMajor, Opts.GodotMinor, Opts.GodotPatch);
         }
@@ -116,13 +185,144 @@ int PckTool::Run()
             }
         }
 
+        // The commands are added as they are parsed to not need the whole input in memory
+        CommandReader commands([&pck, this](std::string& file, std::string& target) {
+            auto pckPath = pck->PreparePckPath(std::move(target), "");
+            pck->AddSingleFile(std::move(file), std::move(pckPath), !Opts.ReducedVerbosity);
+            return true;
+        });
+
+        for(const auto& source : Opts.CommandFiles) {
+            if(!commands.ReadSource(source))
+                return 1;
+        }
+
+        if(!ApplySaveOptions(*pck))
+            return 1;
+
         if(!pck->Save()) {
             std::cout << "Failed to save pck\n";
             return 2;
         }
 
+        PrintPaddingReport(*pck);
+
         std::cout << "Writing / updating pck finished\n";
         return 0;
+    } else if(Opts.Action == "sync") {
+        return SyncFiles();
+    } else if(Opts.Action == "watch") {
+        return WatchFiles();
+    } else if(Opts.Action == "overlay") {
+        return RunOverlay();
+    } else if(Opts.Action == "remove") {
+        return RemoveEntries();
+    } else if(Opts.Action == "delta") {
+        return CreateDelta();
+    } else if(Opts.Action == "apply-delta") {
+        return ApplyDelta();
+    } else if(Opts.Action == "compact") {
+        if(!RequireTargetFileExists())
+            return 2;
+
+        // Compacting works on the whole pck, a filtered load would drop the other files when
+        // the pck needs to be repacked
+        auto pck = LoadUnfilteredPck(Opts.Pack);
+
+        if(!pck)
+            return 2;
+
+        const auto oldSize = std::filesystem::file_size(Opts.Pack);
+
+        if(!pck->CanUpdateInPlace()) {
+            // Older formats don't have a movable directory, so they can only be rewritten
+            std::cout << "Pck format doesn't support compacting in place, repacking instead\n";
+
+            if(!pck->Save()) {
+                std::cout << "Failed to repack\n";
+                return 2;
+            }
+
+            const auto newSize = std::filesystem::file_size(Opts.Pack);
+            std::cout << "Reclaimed " << (oldSize > newSize ? oldSize - newSize : 0)
+                      << " bytes\n";
+            return 0;
+        }
+
+        uint64_t reclaimed = 0;
+
+        if(!pck->Compact(reclaimed)) {
+            std::cout << "ERROR: compacting failed\n";
+            return 2;
+        }
+
+        std::cout << "Reclaimed " << reclaimed << " bytes, pck size is now "
+                  << (oldSize - reclaimed) << " bytes\n";
+        return 0;
+    } else if(Opts.Action == "verify") {
+        auto pck = LoadPck();
+
+        if(!pck)
+            return 2;
+
+        std::cout << "Verifying contents of '" << Opts.Pack << "'\n";
+
+        const auto result = pck->Verify(PrintEachFile());
+
+        for(const auto& path : result.Mismatched)
+            std::cout << "ERROR: hash mismatch: " << path << "\n";
+
+        std::cout << "Verified " << result.Verified << " files, " << result.Mismatched.size()
+                  << " mismatches, " << result.Unhashed << " files without a hash\n";
+
+        return result.Mismatched.empty() ? 0 : 2;
+    } else if(Opts.Action == "stats") {
+        auto pck = LoadPck();
+
+        if(!pck)
+            return 2;
+
+        uint64_t dataSize = 0;
+
+        for(const auto& [_, entry] : pck->GetContents())
+            dataSize += entry.Size;
+
+        std::cout << "Pck version: " << pck->GetFormatVersion()
+                  << ", Godot: " << pck->GetGodotVersion() << "\n";
+        std::cout << "Files: " << pck->GetContents().size() << "\n";
+        std::cout << "File data size: " << dataSize << "\n";
+        std::cout << "Pck size: " << std::filesystem::file_size(Opts.Pack) << "\n";
+        return 0;
+    } else if(Opts.Action == "analyze") {
+        return AnalyzePck();
+    } else if(Opts.Action == "manifest") {
+        return WriteManifest();
+    } else if(Opts.Action == "batch") {
+        std::vector<std::string> inputs;
+        inputs.push_back(Opts.Pack);
+
+        for(const auto& entry : Files)
+            inputs.push_back(entry.InputFile);
+
+        return BatchRunner(Opts, std::move(inputs)).Run();
+    } else if(Opts.Action == "index") {
+        auto pck = LoadPck();
+
+        if(!pck)
+            return 2;
+
+        const auto indexPath = PckIndex::IndexPathFor(pck->GetPath());
+
+        if(!PckIndex::Write(*pck, indexPath)) {
+            std::cout << "ERROR: failed to write index\n";
+            return 2;
+        }
+
+        std::cout << "Wrote index for " << pck->GetContents().size()
+                  << " entries to: " << indexPath << "\n";
+        return 0;
+    } else if(Opts.Action == "lookup") {
+        return LookupEntries();
     }
 
     std::cout << "ERROR: unknown action: " << Opts.Action << "\n";
@@ -151,7 +351,7 @@ std::unique_ptr<PckFile> PckTool::LoadPck()
 
     auto pck = std::make_unique<PckFile>(Opts.Pack);
 
-    SetIncludeFilter(*pck);
+    ConfigurePck(*pck);
 
     if(!pck->Load()) {
         std::cout << "ERROR: couldn't load pck file: " << pck->GetPath() << "\n";
@@ -160,32 +360,1138 @@ std::unique_ptr<PckFile> PckTool::LoadPck()
 
     return pck;
 }
+
+std::unique_ptr<PckFile> PckTool::LoadUnfilteredPck(const std::string& path)
+{
+    auto pck = std::make_unique<PckFile>(path);
+
+    ConfigurePck(*pck);
+    pck->SetIncludeFilter(nullptr);
+
+    if(!pck->Load()) {
+        std::cout << "ERROR: couldn't load pck file: " << path << "\n";
+        return nullptr;
+    }
+
+    return pck;
+}
 // ------------------------------------ //
 void PckTool::SetIncludeFilter(PckFile& pck)
 {
-    pck.SetIncludeFilter(std::bind(&FileFilter::Include, Opts.Filter, std::placeholders::_1));
+    pck.SetIncludeFilter(
+        std::bind(&FileFilter::Include, Opts.Filter, std::placeholders::_1),
+        Opts.Filter.GetPrefilter());
+}
+
+void PckTool::ConfigurePck(PckFile& pck)
+{
+    SetIncludeFilter(pck);
+
+    pck.SetUseSidecarIndex(Opts.SidecarIndex);
+    pck.SetDurability(Opts.DurabilityMode);
+    pck.SetWorkerPool(&GetWorkerPool());
+    pck.SetBufferPool(GetBufferPool());
+    pck.SetProgressReporter(GetProgressReporter());
+
+    if(Opts.Key)
+        pck.SetEncryptionKey(*Opts.Key);
+}
+
+WorkerPool& PckTool::GetWorkerPool()
+{
+    if(!Pool)
+        Pool = std::make_unique<WorkerPool>(Opts.Threads);
+
+    return *Pool;
+}
+
+BufferPool* PckTool::GetBufferPool()
+{
+    if(Opts.MaxMemory == 0)
+        return nullptr;
+
+    if(!Buffers)
+        Buffers = std::make_unique<BufferPool>(Opts.MaxMemory);
+
+    return Buffers.get();
+}
+
+ProgressReporter* PckTool::GetProgressReporter()
+{
+    if(!Opts.Progress)
+        return nullptr;
+
+    if(!Progress)
+        Progress = std::make_unique<ProgressReporter>(*Opts.Progress, std::cerr);
+
+    return Progress.get();
 }
 // ------------------------------------ //
-bool PckTool::BuildFileList()
+bool PckTool::ApplySaveOptions(PckFile& pck)
 {
-    // Copy standard files
-    for(const auto& entry : Opts.Files)
-        Files.push_back({entry});
+    if(!Opts.Alignment.Empty())
+        pck.SetAlignmentPolicy(std::make_shared<AlignmentPolicy>(Opts.Alignment));
 
-    // Handle json commands
-    if(Opts.FileCommands.is_array()) {
-        for(const auto& entry : Opts.FileCommands) {
-            try {
-                Files.push_back(
-                    {entry["file"].get<std::string>(), entry["target"].get<std::string>()});
-            } catch(const std::exception& e) {
-                std::cout << "ERROR: unexpected JSON object format in array: " << e.what()
-                          << "\n";
-                std::cout << "Incorrect object:\n";
-                std::cout << entry << "\n";
-                return false;
+    if(Opts.EncryptDirectory)
+        pck.SetEncryptDirectory(true);
+
+    if(!Opts.EncryptFiles.empty()) {
+        const auto matched = pck.SetEncryptedFiles([this](const PckFile::ContainedFile& file) {
+            for(const auto& regex : Opts.EncryptFiles) {
+                if(std::regex_search(file.Path, regex))
+                    return true;
             }
+
+            return false;
+        });
+
+        std::cout << "Files to encrypt: " << matched << "\n";
+    }
+
+    if(Opts.LayoutProfile.empty())
+        return true;
+
+    std::ifstream reader(Opts.LayoutProfile);
+
+    if(!reader.good()) {
+        std::cout << "ERROR: can't read layout profile: " << Opts.LayoutProfile << "\n";
+        return false;
+    }
+
+    std::vector<std::string> order;
+    std::string line;
+
+    while(std::getline(reader, line)) {
+        // Allow Windows line endings and surrounding whitespace
+        while(!line.empty() && std::isspace(static_cast<unsigned char>(line.back())))
+            line.pop_back();
+
+        size_t start = 0;
+        while(start < line.size() && std::isspace(static_cast<unsigned char>(line[start])))
+            ++start;
+
+        if(start >= line.size() || line[start] == '#')
+            continue;
+
+        line.erase(0, start);
+
+        // Allow writing the paths without the res:// prefix
+        if(pck.GetContents().count(line) == 0 && line.find(GODOT_RES_PATH) != 0 &&
+            pck.GetContents().count(GODOT_RES_PATH + line) > 0) {
+            order.push_back(GODOT_RES_PATH + line);
+        } else {
+            order.push_back(line);
+        }
+    }
+
+    const auto total = order.size();
+    const auto matched = pck.SetLayoutOrder(std::move(order));
+
+    std::cout << "Layout profile matched " << matched << " of " << total
+              << " paths, those files are placed first in the data\n";
+
+    return true;
+}
+void PckTool::PrintPaddingReport(const PckFile& pck) const
+{
+    // Only interesting when custom alignment is used
+    if(Opts.Alignment.Empty())
+        return;
+
+    const auto& report = pck.GetLastPaddingReport();
+    const auto& rules = Opts.Alignment.GetRules();
+
+    const auto total = report.GetTotalPadding();
+
+    std::cout << "Alignment padding: " << total << " bytes ("
+              << (report.DataSize > 0 ? 100.0 * total / report.DataSize : 0.0)
+              << "% of file data size " << report.DataSize << ")\n";
+
+    for(size_t i = 0; i < rules.size() && i < report.RulePadding.size(); ++i) {
+        std::cout << "  rule " << AlignmentPolicy::DescribeRule(rules[i]) << ": "
+                  << report.RuleFiles[i] << " files, " << report.RulePadding[i]
+                  << " bytes of padding\n";
+    }
+
+    std::cout << "  default alignment: " << report.DefaultFiles << " files, "
+              << report.DefaultPadding << " bytes of padding\n";
+    std::cout << "  after directory: " << report.DirectoryPadding << " bytes of padding\n";
+}
+// ------------------------------------ //
+int PckTool::SyncFiles()
+{
+    if(Files.empty()) {
+        std::cout << "ERROR: no files specified\n";
+        return 1;
+    }
+
+    bool existed = false;
+    const auto pck = OpenSyncTarget(existed);
+
+    if(!pck)
+        return 2;
+
+    PckSync sync(*pck, PckSync::CachePathFor(Opts.Pack));
+    sync.SetWorkerPool(&GetWorkerPool());
+
+    if(!AddSyncSources(*pck, sync))
+        return 3;
+
+    if(Opts.RemoveMissing)
+        sync.RemoveMissing(!Opts.ReducedVerbosity);
+
+    if(!ApplySaveOptions(*pck))
+        return 1;
+
+    // Removed entries would stay in the file as unused data, so those cases are saved whole to
+    // not grow the pck
+    if(!WriteSyncChanges(*pck, sync, existed, false))
+        return 2;
+
+    if(!sync.SaveCache())
+        return 2;
+
+    const auto& stats = sync.GetStats();
+
+    std::cout << "Sync finished: " << stats.Unchanged << " unchanged, " << stats.Added
+              << " added, " << stats.Changed << " changed, " << stats.Removed
+              << " removed, " << stats.Hashed << " files hashed\n";
+    return 0;
+}
+
+std::unique_ptr<PckFile> PckTool::OpenSyncTarget(bool& existed)
+{
+    existed = TargetExists();
+
+    std::unique_ptr<PckFile> pck;
+
+    if(existed) {
+        pck = LoadPck();
+
+        if(!pck) {
+            std::cout << "ERROR: couldn't load existing target pck. Please change the "
+                         "target or delete the existing file.\n";
+            return nullptr;
+        }
+    } else {
+        pck = std::make_unique<PckFile>(Opts.Pack);
+
+        ConfigurePck(*pck);
+
+        pck->SetGodotVersion(Opts.GodotMajor, Opts.GodotMinor, Opts.GodotPatch);
+    }
+
+    pck->SetNoResPrefix(Opts.NoResPrefix);
+    return pck;
+}
+
+bool PckTool::AddSyncSources(PckFile& pck, PckSync& sync)
+{
+    for(const auto& entry : Files) {
+        const bool success = entry.Target.empty() ?
+                                 sync.AddSource(entry.InputFile, Opts.RemovePrefix,
+                                     !Opts.ReducedVerbosity) :
+                                 sync.AddSourceFile(entry.InputFile,
+                                     pck.PreparePckPath(entry.Target, ""),
+                                     !Opts.ReducedVerbosity);
+
+        if(!success) {
+            std::cout << "ERROR: failed to process file to sync: " << entry.InputFile << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PckTool::WriteSyncChanges(
+    PckFile& pck, const PckSync& sync, bool existed, bool appendRemovals)
+{
+    if(existed && !sync.HasChanges() && !pck.HasUnwrittenData()) {
+        std::cout << "Pck is up to date\n";
+    } else if(existed && (appendRemovals || sync.GetStats().Removed == 0) &&
+              pck.CanUpdateInPlace()) {
+        std::cout << "Appending changes to: " << pck.GetPath() << "\n";
+
+        if(!pck.UpdateInPlace()) {
+            std::cout << "Failed to update pck\n";
+            return false;
+        }
+    } else {
+        if(!pck.Save()) {
+            std::cout << "Failed to save pck\n";
+            return false;
+        }
+
+        PrintPaddingReport(pck);
+    }
+
+    return true;
+}
+
+int PckTool::WatchFiles()
+{
+    if(!DirectoryWatcher::IsSupported()) {
+        std::cout << "ERROR: the watch action is only supported on Linux\n";
+        return 1;
+    }
+
+    if(Files.empty()) {
+        std::cout << "ERROR: no files specified\n";
+        return 1;
+    }
+
+    bool existed = false;
+    const auto pck = OpenSyncTarget(existed);
+
+    if(!pck)
+        return 2;
+
+    if(!ApplySaveOptions(*pck))
+        return 1;
+
+    // Source files that are listed directly, watched through their parent directories
+    std::unordered_map<std::string, std::pair<std::string, std::string>> watchedFiles;
+
+    // Watched directory trees without a trailing separator, so that the paths of changes
+    // start with them
+    std::vector<std::string> roots;
+
+    DirectoryWatcher watcher;
+
+    for(const auto& entry : Files) {
+        const std::filesystem::path path(entry.InputFile);
+
+        if(entry.Target.empty() && std::filesystem::is_directory(path)) {
+            auto root = entry.InputFile;
+
+            while(root.size() > 1 && (root.back() == '/' || root.back() == '\\'))
+                root.pop_back();
+
+            if(!watcher.AddTree(root))
+                return 2;
+
+            roots.push_back(std::move(root));
+            continue;
         }
+
+        const auto pckPath = entry.Target.empty() ?
+                                 pck->PreparePckPath(entry.InputFile, Opts.RemovePrefix) :
+                                 pck->PreparePckPath(entry.Target, "");
+
+        watchedFiles[path.lexically_normal().string()] = {entry.InputFile, pckPath};
+
+        if(!watcher.AddDirectory(
+               path.has_parent_path() ? path.parent_path().string() : std::string(".")))
+            return 2;
+    }
+
+    const auto isUnder = [](const std::string& path, const std::string& directory) {
+        return path.size() > directory.size() &&
+               path.compare(0, directory.size(), directory) == 0 &&
+               (path[directory.size()] == '/' || path[directory.size()] == '\\');
+    };
+
+    const auto isUnderRoot = [&](const std::string& path) {
+        return std::any_of(roots.begin(), roots.end(),
+            [&](const std::string& root) { return isUnder(path, root); });
+    };
+
+    const bool print = !Opts.ReducedVerbosity;
+    auto sync = std::make_unique<PckSync>(*pck, PckSync::CachePathFor(Opts.Pack));
+    sync->SetWorkerPool(&GetWorkerPool());
+
+    // Everything is checked at the start and when the OS dropped events
+    const auto fullSync = [&]() {
+        if(!AddSyncSources(*pck, *sync))
+            return false;
+
+        if(Opts.RemoveMissing)
+            sync->RemoveMissing(print);
+
+        return true;
+    };
+
+    if(!fullSync())
+        return 3;
+
+    std::vector<DirectoryWatcher::Change> changes;
+    bool rescan = false;
+
+    for(bool first = true;; first = false) {
+        if(!first) {
+            // Output is seen before the next changes even when it isn't going to a terminal
+            std::cout.flush();
+
+            if(!watcher.WaitForChanges(changes, rescan, WATCH_QUIET_TIME, WATCH_MAX_WAIT))
+                return 2;
+
+            const auto start = std::chrono::steady_clock::now();
+
+            if(rescan) {
+                std::cout << "Changes were missed, checking all files again\n";
+
+                if(!sync->SaveCache())
+                    return 2;
+
+                sync = std::make_unique<PckSync>(*pck, PckSync::CachePathFor(Opts.Pack));
+                sync->SetWorkerPool(&GetWorkerPool());
+
+                if(!fullSync())
+                    std::cout << "ERROR: syncing files failed, waiting for more changes\n";
+            } else {
+                std::vector<std::string> changedFiles;
+                std::vector<std::string> addedDirectories;
+                std::vector<std::string> removed;
+
+                for(const auto& change : changes) {
+                    const auto normalized =
+                        std::filesystem::path(change.Path).lexically_normal().string();
+
+                    if(sync->IsOwnFile(change.Path))
+                        continue;
+
+                    // What is on disk now matters, not which kinds of events were seen
+                    std::error_code error;
+                    const auto status = std::filesystem::status(change.Path, error);
+
+                    const auto file = watchedFiles.find(normalized);
+
+                    if(file != watchedFiles.end()) {
+                        const auto& [sourcePath, pckPath] = file->second;
+
+                        if(std::filesystem::is_regular_file(status)) {
+                            sync->AddSourceFile(sourcePath, pckPath, print);
+                        } else if(Opts.RemoveMissing) {
+                            removed.push_back(pckPath);
+                        }
+
+                        continue;
+                    }
+
+                    if(!isUnderRoot(change.Path))
+                        continue;
+
+                    if(std::filesystem::is_regular_file(status)) {
+                        changedFiles.push_back(change.Path);
+                    } else if(std::filesystem::is_directory(status)) {
+                        addedDirectories.push_back(change.Path);
+                    }
+
+                    if(!Opts.RemoveMissing)
+                        continue;
+
+                    const auto pckPath = pck->PreparePckPath(change.Path, Opts.RemovePrefix);
+
+                    if(!change.Directory) {
+                        if(!std::filesystem::exists(status))
+                            removed.push_back(pckPath);
+
+                        continue;
+                    }
+
+                    // The directory may have been removed or replaced, so its entries are
+                    // checked one by one
+                    const auto prefix = pckPath + "/";
+
+                    for(const auto& [path, _] : pck->GetContents()) {
+                        if(path.rfind(prefix, 0) == 0 &&
+                            !std::filesystem::exists(
+                                change.Path + "/" + path.substr(prefix.size()), error))
+                            removed.push_back(path);
+                    }
+                }
+
+                // A directory is added with everything in it, so the events of the files and
+                // directories inside it in the same batch must not add them a second time
+                const auto inAddedDirectory = [&](const std::string& path) {
+                    return std::any_of(addedDirectories.begin(), addedDirectories.end(),
+                        [&](const std::string& directory) { return isUnder(path, directory); });
+                };
+
+                changedFiles.erase(std::remove_if(changedFiles.begin(), changedFiles.end(),
+                                       inAddedDirectory),
+                    changedFiles.end());
+
+                std::sort(addedDirectories.begin(), addedDirectories.end());
+                addedDirectories.erase(
+                    std::unique(addedDirectories.begin(), addedDirectories.end()),
+                    addedDirectories.end());
+
+                for(const auto& directory : addedDirectories) {
+                    if(!inAddedDirectory(directory))
+                        sync->AddSource(directory, Opts.RemovePrefix, print);
+                }
+
+                // A file can be seen both by itself and through its removed directory
+                std::sort(removed.begin(), removed.end());
+                removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+                // Files that failed are left as they were, a later change retries them
+                if(!sync->AddSourceFiles(changedFiles, Opts.RemovePrefix, print))
+                    std::cout << "ERROR: syncing changed files failed\n";
+
+                sync->RemoveSources(removed, print);
+            }
+
+            if(!sync->HasChanges() && !pck->HasUnwrittenData())
+                continue;
+
+            const std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            const auto& stats = sync->GetStats();
+
+            std::cout << "Found " << stats.Added << " added, " << stats.Changed
+                      << " changed and " << stats.Removed << " removed files in "
+                      << static_cast<int>(elapsed.count()) << " ms\n";
+        }
+
+        if(!WriteSyncChanges(*pck, *sync, existed, true))
+            return 2;
+
+        // A saved pck is read again so that the data of its entries comes from the new file
+        if(!pck->CanUpdateInPlace() && !pck->Load()) {
+            std::cout << "ERROR: loading the saved pck failed\n";
+            return 2;
+        }
+
+        existed = true;
+
+        if(!sync->SaveCache())
+            return 2;
+
+        if(first) {
+            const auto& stats = sync->GetStats();
+
+            std::cout << "Sync finished: " << stats.Unchanged << " unchanged, " << stats.Added
+                      << " added, " << stats.Changed << " changed, " << stats.Removed
+                      << " removed, " << stats.Hashed << " files hashed\n";
+            std::cout << "Watching " << watcher.GetWatchCount()
+                      << " directories for changes, stop with Ctrl+C\n";
+        }
+
+        sync->ResetStats();
+    }
+}
+// ------------------------------------ //
+int PckTool::RemoveEntries()
+{
+    if(Files.empty() && Opts.Filter.IsEmpty()) {
+        std::cout << "ERROR: no files or filters specified for what to remove\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    // The filter picks the files to remove, so everything needs to be loaded
+    auto pck = std::make_unique<PckFile>(Opts.Pack);
+
+    ConfigurePck(*pck);
+    pck->SetIncludeFilter(nullptr);
+
+    if(!pck->Load()) {
+        std::cout << "ERROR: couldn't load pck file: " << pck->GetPath() << "\n";
+        return 2;
+    }
+
+    std::vector<std::string> remove;
+
+    if(!Opts.Filter.IsEmpty()) {
+        for(const auto& [path, entry] : pck->GetContents()) {
+            if(Opts.Filter.Include(entry))
+                remove.push_back(path);
+        }
+    }
+
+    for(const auto& entry : Files) {
+        const auto& contents = pck->GetContents();
+
+        // Allow writing the paths without the res:// prefix
+        if(contents.count(entry.InputFile) > 0) {
+            remove.push_back(entry.InputFile);
+        } else if(contents.count(GODOT_RES_PATH + entry.InputFile) > 0) {
+            remove.push_back(GODOT_RES_PATH + entry.InputFile);
+        } else {
+            std::cout << "WARNING: pck doesn't contain: " << entry.InputFile << "\n";
+        }
+    }
+
+    uint64_t unused = 0;
+    size_t removed = 0;
+
+    for(const auto& path : remove) {
+        const auto& contents = pck->GetContents();
+        const auto found = contents.find(path);
+
+        // Filters and paths can match the same entry
+        if(found == contents.end())
+            continue;
+
+        unused += found->second.GetStoredSize();
+
+        if(!Opts.ReducedVerbosity)
+            std::cout << "Removed: " << path << "\n";
+
+        pck->RemoveFile(path);
+        ++removed;
+    }
+
+    if(removed == 0) {
+        std::cout << "No files matched, pck is unchanged\n";
+        return 0;
+    }
+
+    if(pck->CanUpdateInPlace()) {
+        // Only a new directory needs to be written
+        if(!pck->UpdateInPlace()) {
+            std::cout << "Failed to update pck\n";
+            return 2;
+        }
+
+        std::cout << "Removed " << removed << " files, their " << unused
+                  << " bytes of data can be reclaimed with the compact action\n";
+    } else {
+        if(!pck->Save()) {
+            std::cout << "Failed to save pck\n";
+            return 2;
+        }
+
+        std::cout << "Removed " << removed << " files\n";
+    }
+
+    return 0;
+}
+// ------------------------------------ //
+int PckTool::AnalyzePck()
+{
+    if(Opts.ListFormat != "text" && Opts.ListFormat != "json") {
+        std::cout << "ERROR: unknown analyze format: " << Opts.ListFormat
+                  << " (expected text or json)\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    // Filtered out files would look like unused space
+    const auto pck = LoadUnfilteredPck(Opts.Pack);
+
+    if(!pck)
+        return 2;
+
+    PckAnalyzer::Report report;
+
+    if(!PckAnalyzer::Analyze(*pck, Opts.HashContents, report))
+        return 2;
+
+    const auto& limits = PckAnalyzer::SIZE_CLASS_LIMITS;
+
+    if(Opts.ListFormat == "json") {
+        char hash[MD5_STRING_SIZE];
+
+        json duplicates = json::array();
+
+        for(const auto& group : report.Duplicates) {
+            md5::sig_to_string(group.MD5.data(), hash, MD5_STRING_SIZE);
+
+            duplicates.push_back({{"size", group.Size}, {"md5", hash},
+                {"copies", group.Copies}, {"paths", group.Paths}});
+        }
+
+        json overlaps = json::array();
+
+        for(const auto& overlap : report.Overlaps) {
+            overlaps.push_back({{"first", overlap.First}, {"second", overlap.Second},
+                {"offset", overlap.Offset}});
+        }
+
+        json extensions = json::object();
+
+        for(const auto& [extension, stats] : report.Extensions) {
+            extensions[extension] = {{"files", stats.Files}, {"size", stats.Size},
+                {"largest", stats.Largest}, {"sizeClasses", stats.SizeClasses}};
+        }
+
+        const json output = {{"pack", Opts.Pack}, {"formatVersion", pck->GetFormatVersion()},
+            {"godotVersion", pck->GetGodotVersion()}, {"pckSize", report.PckSize},
+            {"files", report.Files}, {"dataSize", report.DataSize},
+            {"headerSize", report.HeaderSize},
+            {"directory",
+                {{"size", report.DirectorySize}, {"pathSize", report.PathSize},
+                    {"pathPadding", report.PathPadding}}},
+            {"alignmentPadding",
+                {{"size", report.AlignmentPadding}, {"gaps", report.AlignmentGaps}}},
+            {"unusedSpace", {{"size", report.UnusedSpace}, {"gaps", report.UnusedGaps}}},
+            {"trailingSize", report.TrailingSize}, {"sharedFiles", report.SharedFiles},
+            {"overlaps", overlaps}, {"outOfBounds", report.OutOfBounds},
+            {"duplicates",
+                {{"hashedContents", report.HashedContents}, {"unhashed", report.Unhashed},
+                    {"duplicateSize", report.DuplicateSize}, {"groups", duplicates}}},
+            {"sizeClassLimits", limits}, {"extensions", extensions}};
+
+        std::cout << output.dump(2) << "\n";
+        return 0;
+    }
+
+    const auto percent = [&](uint64_t size) {
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(1)
+               << (report.PckSize > 0 ? 100.0 * size / report.PckSize : 0.0) << "%";
+        return stream.str();
+    };
+
+    std::cout << "Analysis of '" << Opts.Pack << "'\n";
+    std::cout << "Pck version: " << pck->GetFormatVersion()
+              << ", Godot: " << pck->GetGodotVersion() << "\n";
+    std::cout << "Pck size: " << report.PckSize << ", files: " << report.Files << "\n";
+    std::cout << "File data: " << report.DataSize << " bytes (" << percent(report.DataSize)
+              << ")\n";
+    std::cout << "Header: " << report.HeaderSize << " bytes\n";
+    std::cout << "Directory: " << report.DirectorySize << " bytes (" << report.PathSize
+              << " bytes of paths, " << report.PathPadding << " bytes of path padding)\n";
+    std::cout << "Alignment padding: " << report.AlignmentPadding << " bytes ("
+              << percent(report.AlignmentPadding) << ") in " << report.AlignmentGaps
+              << " gaps\n";
+    std::cout << "Unused space: " << report.UnusedSpace << " bytes ("
+              << percent(report.UnusedSpace) << ") in " << report.UnusedGaps << " gaps\n";
+
+    if(report.TrailingSize > 0)
+        std::cout << "Trailing data: " << report.TrailingSize << " bytes\n";
+
+    if(report.SharedFiles > 0)
+        std::cout << "Files sharing data with another file: " << report.SharedFiles << "\n";
+
+    for(const auto& overlap : report.Overlaps) {
+        std::cout << "WARNING: " << overlap.Second << " overlaps " << overlap.First
+                  << " at offset " << overlap.Offset << "\n";
+    }
+
+    for(const auto& path : report.OutOfBounds)
+        std::cout << "WARNING: data is past the end of the pck: " << path << "\n";
+
+    std::cout << "Duplicate contents ("
+              << (report.HashedContents ? "hashed data" : "directory hashes")
+              << "): " << report.Duplicates.size() << " groups, " << report.DuplicateSize
+              << " bytes (" << percent(report.DuplicateSize) << ") stored more than once\n";
+
+    if(report.Unhashed > 0)
+        std::cout << "  " << report.Unhashed << " files without a hash were not checked\n";
+
+    // Only the biggest ones unless everything is wanted
+    const size_t shownDuplicates = Opts.ReducedVerbosity ? 10 : report.Duplicates.size();
+
+    for(size_t i = 0; i < report.Duplicates.size() && i < shownDuplicates; ++i) {
+        const auto& group = report.Duplicates[i];
+
+        std::cout << "  " << group.Copies << " copies of " << group.Size << " bytes:";
+
+        for(const auto& path : group.Paths)
+            std::cout << " " << path;
+
+        std::cout << "\n";
+    }
+
+    if(report.Duplicates.size() > shownDuplicates) {
+        std::cout << "  and " << (report.Duplicates.size() - shownDuplicates)
+                  << " more groups\n";
+    }
+
+    std::cout << "Files by extension (counts of sizes under";
+
+    for(const auto limit : limits)
+        std::cout << " " << limit;
+
+    std::cout << " bytes and the rest):\n";
+
+    for(const auto& [extension, stats] : report.Extensions) {
+        std::cout << "  " << (extension.empty() ? "(none)" : extension) << ": " << stats.Files
+                  << " files, " << stats.Size << " bytes, largest " << stats.Largest
+                  << ", sizes";
+
+        for(const auto count : stats.SizeClasses)
+            std::cout << " " << count;
+
+        std::cout << "\n";
+    }
+
+    if(report.UnusedSpace > 0)
+        std::cout << "The compact action would reclaim " << report.UnusedSpace << " bytes\n";
+
+    if(report.DuplicateSize > 0) {
+        std::cout << "Storing duplicate contents once would save " << report.DuplicateSize
+                  << " bytes\n";
+    }
+
+    return 0;
+}
+// ------------------------------------ //
+int PckTool::WriteManifest()
+{
+    // The default text format means the binary manifest here
+    if(Opts.ListFormat != "text" && Opts.ListFormat != "binary" && Opts.ListFormat != "json") {
+        std::cout << "ERROR: unknown manifest format: " << Opts.ListFormat
+                  << " (expected binary or json)\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    auto pck = LoadPck();
+
+    if(!pck)
+        return 2;
+
+    PckManifest manifest;
+
+    if(!manifest.Build(*pck, Opts.CoalesceLimit))
+        return 2;
+
+    auto output = Opts.Output;
+
+    if(output.empty()) {
+        output = PckManifest::ManifestPathFor(pck->GetPath());
+
+        if(Opts.ListFormat == "json")
+            output += ".json";
+    }
+
+    if(Opts.ListFormat == "json") {
+        char hash[MD5_STRING_SIZE];
+
+        json files = json::array();
+
+        for(const auto& entry : manifest.GetEntries()) {
+            md5::sig_to_string(entry.MD5.data(), hash, MD5_STRING_SIZE);
+
+            // As text as 64-bit numbers don't fit in JSON numbers everywhere
+            std::ostringstream pathHash;
+            pathHash << std::hex << std::setw(16) << std::setfill('0') << entry.PathHash;
+
+            files.push_back({{"path", entry.Path}, {"pathHash", pathHash.str()},
+                {"offset", entry.Offset}, {"length", entry.Length}, {"size", entry.Size},
+                {"md5", hash}, {"flags", entry.Flags}, {"group", entry.Group}});
+        }
+
+        json groups = json::array();
+
+        for(const auto& group : manifest.GetGroups()) {
+            groups.push_back({{"offset", group.Offset}, {"length", group.Length},
+                {"files", group.Entries}});
+        }
+
+        const json document = {{"pckSize", manifest.GetPckSize()}, {"files", std::move(files)},
+            {"groups", std::move(groups)}};
+
+        std::ofstream writer(output, std::ios::trunc | std::ios::out);
+
+        writer << document.dump(2) << "\n";
+
+        if(!writer.good()) {
+            std::cout << "ERROR: writing manifest file failed: " << output << "\n";
+            return 2;
+        }
+    } else if(!manifest.Write(output)) {
+        return 2;
+    }
+
+    std::cout << "Wrote manifest of " << manifest.GetEntries().size() << " files in "
+              << manifest.GetGroups().size() << " ranges (" << manifest.GetFetchedSize()
+              << " bytes) to: " << output << "\n";
+    return 0;
+}
+// ------------------------------------ //
+int PckTool::CreateDelta()
+{
+    if(Files.size() != 1 || Opts.Output.empty()) {
+        std::cout << "ERROR: the delta action needs the older pck as the only file and the "
+                     "delta file to write as the output\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    // Entries excluded by the filters would just be chunked, so filters are not used
+    const auto base = LoadUnfilteredPck(Files.front().InputFile);
+    const auto target = LoadUnfilteredPck(Opts.Pack);
+
+    if(!base || !target)
+        return 2;
+
+    std::cout << "Writing delta from " << base->GetPath() << " to " << target->GetPath()
+              << "\n";
+
+    PckDelta::Stats stats;
+
+    if(!PckDelta::Create(*base, *target, Opts.Output, &GetWorkerPool(), stats)) {
+        std::cout << "ERROR: writing delta failed\n";
+        return 2;
+    }
+
+    std::cout << "Wrote delta: " << Opts.Output << " with " << stats.LiteralSize
+              << " bytes of new data, " << stats.CopiedSize << " of " << stats.OutputSize
+              << " bytes are copied from the older pck\n";
+
+    if(!Opts.ReducedVerbosity) {
+        std::cout << stats.UnchangedEntries << " unchanged files, " << stats.MatchedChunks
+                  << " of " << stats.Chunks << " chunks of the rest found in the older pck\n";
+    }
+
+    return 0;
+}
+
+int PckTool::ApplyDelta()
+{
+    if(Files.size() != 1) {
+        std::cout << "ERROR: the apply-delta action needs the delta file as the only file\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    // Without an output the pck is replaced with the new build
+    const auto& output = Opts.Output.empty() ? Opts.Pack : Opts.Output;
+
+    std::cout << "Applying delta " << Files.front().InputFile << " to " << Opts.Pack << "\n";
+
+    if(!PckDelta::Apply(Opts.Pack, Files.front().InputFile, output, Opts.DurabilityMode)) {
+        std::cout << "ERROR: applying delta failed\n";
+        return 2;
+    }
+
+    std::cout << "Wrote: " << output << "\n";
+    return 0;
+}
+// ------------------------------------ //
+int PckTool::RunOverlay()
+{
+    const auto& operation = Opts.OverlayOperation;
+
+    if(operation != "list" && operation != "lookup" && operation != "extract" &&
+        operation != "verify") {
+        std::cout << "ERROR: unknown overlay operation: " << operation
+                  << " (expected list, lookup, extract or verify)\n";
+        return 1;
+    }
+
+    if(operation == "lookup" && Opts.LookupPaths.empty()) {
+        std::cout << "ERROR: no paths to look up specified (use --lookup-path)\n";
+        return 1;
+    }
+
+    // The base pck first, then the ones overriding it in order
+    std::vector<std::string> packs{Opts.Pack};
+
+    for(const auto& entry : Files)
+        packs.push_back(entry.InputFile);
+
+    for(const auto& pack : packs) {
+        if(!std::filesystem::exists(pack)) {
+            std::cout << "ERROR: specified pck file doesn't exist: " << pack << "\n";
+            return 2;
+        }
+    }
+
+    // The filters apply to the resolved files, filtering the packs would bring back files
+    // whose override or deletion marker is filtered out
+    PckOverlay overlay([this](PckFile& pck) {
+        ConfigurePck(pck);
+        pck.SetIncludeFilter(nullptr);
+    });
+    overlay.SetWorkerPool(&GetWorkerPool());
+    overlay.SetIncludeFilter(
+        std::bind(&FileFilter::Include, Opts.Filter, std::placeholders::_1));
+
+    if(!overlay.Load(packs))
+        return 2;
+
+    if(operation == "extract") {
+        std::cout << "Extracting " << overlay.GetEntries().size() << " files from "
+                  << packs.size() << " packs to: " << Opts.Output << "\n";
+
+        if(!overlay.Extract(Opts.Output, PrintEachFile())) {
+            std::cout << "ERROR: extraction failed\n";
+            return 2;
+        }
+
+        std::cout << "Extraction completed\n";
+        return 0;
+    }
+
+    if(operation == "verify") {
+        const auto result = overlay.Verify(PrintEachFile());
+
+        for(const auto& path : result.Mismatched)
+            std::cout << "ERROR: hash mismatch: " << path << "\n";
+
+        std::cout << "Verified " << result.Verified << " files, " << result.Mismatched.size()
+                  << " mismatches, " << result.Unhashed << " files without a hash\n";
+
+        return result.Mismatched.empty() ? 0 : 2;
+    }
+
+    OutputBuffer output(std::cout);
+
+    const auto printEntry = [&](const std::string& path, const PckOverlay::Entry& entry) {
+        output.Append(path);
+        output.Append(" size: ");
+        output.AppendNumber(entry.File->Size);
+        output.Append(" md5: ");
+        output.AppendHex(entry.File->MD5.data(), entry.File->MD5.size());
+        output.Append(" from: ");
+        output.Append(overlay.GetLayer(entry.Layer).GetPath());
+
+        if(entry.Overrides > 0) {
+            output.Append(" (overrides ");
+            output.AppendNumber(entry.Overrides);
+            output.Append(")");
+        }
+
+        output.Append('\n');
+        output.EndRecord();
+    };
+
+    if(operation == "lookup") {
+        bool allFound = true;
+
+        for(const auto& path : Opts.LookupPaths) {
+            auto resolved = path;
+            const auto* entry = overlay.Find(resolved);
+
+            // Paths can be given without the res:// prefix
+            if(entry == nullptr && path.find(GODOT_RES_PATH) != 0) {
+                resolved = GODOT_RES_PATH + path;
+                entry = overlay.Find(resolved);
+            }
+
+            if(entry != nullptr) {
+                printEntry(resolved, *entry);
+            } else {
+                output.Append(path);
+                output.Append(" not found\n");
+                allFound = false;
+            }
+        }
+
+        output.Flush();
+        return allFound ? 0 : 2;
+    }
+
+    for(const auto& [path, entry] : overlay.GetEntries())
+        printEntry(path, entry);
+
+    output.Flush();
+
+    std::cout << "Files: " << overlay.GetEntries().size() << " from " << packs.size()
+              << " packs";
+
+    if(overlay.GetDeletedCount() > 0)
+        std::cout << ", " << overlay.GetDeletedCount() << " removed by later packs";
+
+    std::cout << "\n";
+    return 0;
+}
+// ------------------------------------ //
+int PckTool::LookupEntries()
+{
+    if(Files.empty()) {
+        std::cout << "ERROR: no paths to look up specified\n";
+        return 1;
+    }
+
+    if(!RequireTargetFileExists())
+        return 2;
+
+    char signatureTempBuffer[MD5_STRING_SIZE];
+
+    const auto printEntry = [&](const std::string& path, uint64_t offset, uint64_t size,
+                                const std::array<uint8_t, 16>& hash) {
+        static_assert(sizeof(hash) == MD5_SIZE);
+        md5::sig_to_string(hash.data(), signatureTempBuffer, MD5_STRING_SIZE);
+
+        std::cout << path << " offset: " << offset << " size: " << size << " md5: "
+                  << std::string_view(signatureTempBuffer, std::strlen(signatureTempBuffer))
+                  << "\n";
+    };
+
+    // Paths can be given without the res:// prefix
+    const auto candidates = [](const std::string& path) {
+        std::vector<std::string> result{path};
+
+        if(path.find(GODOT_RES_PATH) != 0)
+            result.push_back(GODOT_RES_PATH + path);
+
+        return result;
+    };
+
+    bool allFound = true;
+
+    // Only the size and modification time are checked, which is enough for read only queries
+    PckIndex index;
+
+    if(index.Open(PckIndex::IndexPathFor(Opts.Pack), Opts.Pack, false)) {
+        for(const auto& entry : Files) {
+            bool found = false;
+
+            for(const auto& path : candidates(entry.InputFile)) {
+                if(const auto result = index.Find(path); result) {
+                    printEntry(path, result->Offset, result->Size, result->MD5);
+                    found = true;
+                    break;
+                }
+            }
+
+            if(!found) {
+                std::cout << entry.InputFile << " not found\n";
+                allFound = false;
+            }
+        }
+
+        return allFound ? 0 : 2;
+    }
+
+    if(!Opts.ReducedVerbosity)
+        std::cout << "No up to date index, loading the full pck directory\n";
+
+    auto pck = LoadPck();
+
+    if(!pck)
+        return 2;
+
+    const auto& contents = pck->GetContents();
+
+    for(const auto& entry : Files) {
+        bool found = false;
+
+        for(const auto& path : candidates(entry.InputFile)) {
+            if(const auto iter = contents.find(path); iter != contents.end()) {
+                printEntry(path, iter->second.Offset, iter->second.Size, iter->second.MD5);
+                found = true;
+                break;
+            }
+        }
+
+        if(!found) {
+            std::cout << entry.InputFile << " not found\n";
+            allFound = false;
+        }
+    }
+
+    return allFound ? 0 : 2;
+}
+// ------------------------------------ //
+bool PckTool::BuildFileList()
+{
+    // Copy standard files
+    for(const auto& entry : Opts.Files)
+        Files.push_back({entry});
+
+    if(!Opts.CommandFiles.empty() && Opts.Action != "add" && Opts.Action != "a") {
+        std::cout << "WARNING: JSON file commands are only used by the add action\n";
     }
 
     // Use first file as the pck if pck is missing
@@ -200,7 +1506,8 @@ bool PckTool::BuildFileList()
         Files.erase(Files.begin());
     }
 
-    if(Opts.Pack.find(pcktool::GODOT_PCK_EXTENSION) == std::string::npos) {
+    if(Opts.Action != "batch" &&
+        Opts.Pack.find(pcktool::GODOT_PCK_EXTENSION) == std::string::npos) {
         std::cout << "WARNING: Given pck file doesn't contain the pck file extension\n";
     }
 
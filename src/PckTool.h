@@ -3,10 +3,15 @@
 #include "Define.h"
 
 #include "FileFilter.h"
+#include "pck/AlignmentPolicy.h"
+#include "pck/Encryption.h"
+#include "pck/ProgressReporter.h"
 
 #include <nlohmann/json.hpp>
 
 #include <memory>
+#include <optional>
+#include <regex>
 #include <string>
 #include <vector>
 
@@ -14,7 +19,10 @@ namespace pcktool {
 
 using json = nlohmann::json;
 
+class BufferPool;
 class PckFile;
+class PckSync;
+class WorkerPool;
 
 //! \brief Main class for the Godot Pck Tool
 class PckTool {
@@ -36,17 +44,70 @@ public:
         int GodotMinor;
         int GodotPatch;
 
-        json FileCommands;
+        //! JSON command sources ("-" for stdin) that are streamed into the add action
+        std::vector<std::string> CommandFiles;
 
         FileFilter Filter;
 
         bool ReducedVerbosity;
         bool PrintHashes;
         bool NoResPrefix;
+        bool SidecarIndex;
+
+        //! File with res:// paths (one per line) in the order the data should be laid out in
+        std::string LayoutProfile;
+
+        AlignmentPolicy Alignment;
+
+        //! Number of threads for parallel operations, 0 uses all CPU cores
+        unsigned Threads;
+
+        //! Operation to run on all packs in the batch action
+        std::string BatchOperation;
+
+        //! Output format of the list action: text, ndjson or csv
+        std::string ListFormat;
+
+        //! Key for reading and writing encrypted packs
+        std::optional<EncryptionKey> Key;
+
+        bool EncryptDirectory;
+
+        //! Files with a path matching any of these are encrypted when saving
+        std::vector<std::regex> EncryptFiles;
+
+        //! Memory budget in bytes for file data buffers, 0 for no limit
+        uint64_t MaxMemory;
+
+        //! Use a journal to resume interrupted extractions
+        bool Resume;
+
+        //! Remove pck entries without a source file in the sync action
+        bool RemoveMissing;
+
+        //! Operation to run on the resolved files in the overlay action
+        std::string OverlayOperation;
+
+        //! Paths to find with the overlay lookup operation
+        std::vector<std::string> LookupPaths;
+
+        //! How to show progress on stderr, no progress is shown if not set
+        std::optional<ProgressReporter::Style> Progress;
+
+        //! How carefully saved and extracted data is written to disk
+        Durability DurabilityMode;
+
+        //! Hash the file data in the analyze action instead of using the directory hashes
+        bool HashContents;
+
+        //! Size limit for coalescing small files into range groups in the manifest action, 0
+        //! to not coalesce
+        uint64_t CoalesceLimit;
     };
 
 public:
     explicit PckTool(Options options);
+    ~PckTool();
 
     //! \brief Runs the tool
     //! \returns The exit code to return
@@ -61,12 +122,81 @@ private:
 
     std::unique_ptr<PckFile> LoadPck();
 
+    //! \brief Loads a pck with all its entries, ignoring the filters
+    std::unique_ptr<PckFile> LoadUnfilteredPck(const std::string& path);
+
     void SetIncludeFilter(PckFile& pck);
 
+    WorkerPool& GetWorkerPool();
+
+    //! \returns The buffer pool or null if there is no memory limit
+    BufferPool* GetBufferPool();
+
+    //! \returns The progress reporter or null if progress is not shown
+    ProgressReporter* GetProgressReporter();
+
+    //! \returns True if the files processed by the workers are printed one by one, which is
+    //! not done when the progress is shown so that the workers don't wait on the output
+    [[nodiscard]] bool PrintEachFile() const
+    {
+        return !Opts.ReducedVerbosity && !Opts.Progress;
+    }
+
+    //! \brief Sets up a pck with the options that affect both loading and saving
+    void ConfigurePck(PckFile& pck);
+
+    //! \brief Applies the layout profile and alignment policy to a pck that is about to be
+    //! saved
+    bool ApplySaveOptions(PckFile& pck);
+
+    void PrintPaddingReport(const PckFile& pck) const;
+
+    //! \brief Updates the pck with only the changed source files
+    int SyncFiles();
+
+    //! \brief Loads the pck to sync or creates it if it doesn't exist yet
+    std::unique_ptr<PckFile> OpenSyncTarget(bool& existed);
+
+    //! \brief Compares all the listed files against the pck
+    bool AddSyncSources(PckFile& pck, PckSync& sync);
+
+    //! \brief Writes the changes found by a sync to the pck
+    //! \param appendRemovals If true, removals are also done in place, leaving the data of the
+    //! removed files as unused space
+    bool WriteSyncChanges(PckFile& pck, const PckSync& sync, bool existed, bool appendRemovals);
+
+    //! \brief Syncs the pck and then keeps it up to date as the listed files change
+    int WatchFiles();
+
+    //! \brief Removes the entries matching the filters or the listed paths
+    int RemoveEntries();
+
+    //! \brief Reports where the space in the pck goes
+    int AnalyzePck();
+
+    //! \brief Writes the byte ranges of the files in the pck for fetching them separately
+    int WriteManifest();
+
+    //! \brief Writes a delta that turns the listed older build of the pck into the pck
+    int CreateDelta();
+
+    //! \brief Recreates a newer build of the pck from it and the listed delta
+    int ApplyDelta();
+
+    //! \brief Resolves the files of the pck and the listed packs on top of it
+    int RunOverlay();
+
+    //! \brief Finds single entries, using the sidecar index when it is up to date
+    int LookupEntries();
+
 private:
     Options Opts;
 
     std::vector<FileEntry> Files;
+
+    std::unique_ptr<WorkerPool> Pool;
+    std::unique_ptr<BufferPool> Buffers;
+    std::unique_ptr<ProgressReporter> Progress;
 };
 
 } // namespace pcktool
@@ -0,0 +1,411 @@
+// ------------------------------------ //
+#include "GodotPck.h"
+
+#include "pck/BufferPool.h"
+#include "pck/PckFile.h"
+#include "pck/WorkerPool.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace pcktool;
+
+struct gpck_pck {
+    std::unique_ptr<PckFile> Pck;
+
+    //! The entries in path order for index based access, rebuilt after changes
+    std::vector<const PckFile::ContainedFile*> Entries;
+    bool EntriesValid = false;
+
+    std::unique_ptr<BufferPool> Buffers;
+
+    std::unique_ptr<WorkerPool> Pool;
+    uint32_t PoolThreads = 0;
+
+    std::string Error;
+};
+
+//! Errors of open and create, which don't have a pck to store them in
+static thread_local std::string GlobalError;
+
+//! \brief Runs an API call, turning exceptions into errors so that they don't cross the C ABI
+template<typename Function>
+static gpck_result Guard(gpck_pck* pck, Function function) noexcept
+{
+    if(pck == nullptr) {
+        GlobalError = "pck is null";
+        return GPCK_INVALID_ARGUMENT;
+    }
+
+    try {
+        pck->Error.clear();
+        return function(*pck);
+    } catch(const std::exception& e) {
+        pck->Error = e.what();
+    } catch(...) {
+        pck->Error = "unknown exception";
+    }
+
+    return GPCK_ERROR;
+}
+
+static gpck_result Fail(gpck_pck& pck, const char* message, gpck_result result = GPCK_ERROR)
+{
+    pck.Error = message;
+    return result;
+}
+
+static void FillInfo(const PckFile::ContainedFile& entry, gpck_entry_info& info)
+{
+    info.path = entry.Path.c_str();
+    info.offset = entry.StoredInPck ? entry.Offset : 0;
+    info.size = entry.Size;
+    std::memcpy(info.md5, entry.MD5.data(), sizeof(info.md5));
+    info.flags = entry.Flags;
+}
+
+static WorkerPool& GetPool(gpck_pck& pck, uint32_t threads)
+{
+    if(!pck.Pool || pck.PoolThreads != threads) {
+        pck.Pool.reset();
+        pck.Pool = std::make_unique<WorkerPool>(threads);
+        pck.PoolThreads = threads;
+        pck.Pck->SetWorkerPool(pck.Pool.get());
+    }
+
+    return *pck.Pool;
+}
+
+//! \brief Opens a pck with the load function, which is given the PckFile to load
+template<typename Function>
+static gpck_pck* OpenWith(const char* path, const uint8_t* key, Function load) noexcept
+{
+    try {
+        auto pck = std::make_unique<gpck_pck>();
+        pck->Pck = std::make_unique<PckFile>(path);
+
+        if(key != nullptr) {
+            EncryptionKey fullKey;
+            std::memcpy(fullKey.data(), key, fullKey.size());
+            pck->Pck->SetEncryptionKey(fullKey);
+        }
+
+        if(!load(*pck->Pck)) {
+            GlobalError = std::string("loading the pck failed: ") + path;
+            return nullptr;
+        }
+
+        return pck.release();
+    } catch(const std::exception& e) {
+        GlobalError = e.what();
+    } catch(...) {
+        GlobalError = "unknown exception";
+    }
+
+    return nullptr;
+}
+// ------------------------------------ //
+uint32_t gpck_api_version(void)
+{
+    return GPCK_API_VERSION;
+}
+
+gpck_pck* gpck_open(const char* path, const uint8_t* key)
+{
+    if(path == nullptr) {
+        GlobalError = "path is null";
+        return nullptr;
+    }
+
+    return OpenWith(path, key, [](PckFile& pck) { return pck.Load(); });
+}
+
+gpck_pck* gpck_open_memory(const void* data, size_t size, const char* name, const uint8_t* key)
+{
+    if((data == nullptr && size > 0) || name == nullptr) {
+        GlobalError = "data or name is null";
+        return nullptr;
+    }
+
+    return OpenWith(name, key, [data, size](PckFile& pck) {
+        return pck.LoadFromMemory(std::string(static_cast<const char*>(data), size));
+    });
+}
+
+gpck_pck* gpck_create(
+    const char* path, uint32_t godot_major, uint32_t godot_minor, uint32_t godot_patch)
+{
+    if(path == nullptr) {
+        GlobalError = "path is null";
+        return nullptr;
+    }
+
+    try {
+        auto pck = std::make_unique<gpck_pck>();
+        pck->Pck = std::make_unique<PckFile>(path);
+        pck->Pck->SetGodotVersion(godot_major, godot_minor, godot_patch);
+
+        return pck.release();
+    } catch(const std::exception& e) {
+        GlobalError = e.what();
+    } catch(...) {
+        GlobalError = "unknown exception";
+    }
+
+    return nullptr;
+}
+
+void gpck_close(gpck_pck* pck)
+{
+    // The pck uses the pools so it goes first
+    if(pck != nullptr)
+        pck->Pck.reset();
+
+    delete pck;
+}
+
+const char* gpck_last_error(const gpck_pck* pck)
+{
+    return pck != nullptr ? pck->Error.c_str() : GlobalError.c_str();
+}
+// ------------------------------------ //
+gpck_result gpck_set_memory_limit(gpck_pck* pck, uint64_t bytes)
+{
+    return Guard(pck, [bytes](gpck_pck& pck) {
+        pck.Pck->SetBufferPool(nullptr);
+        pck.Buffers.reset();
+
+        if(bytes > 0) {
+            pck.Buffers = std::make_unique<BufferPool>(bytes);
+            pck.Pck->SetBufferPool(pck.Buffers.get());
+        }
+
+        return GPCK_OK;
+    });
+}
+
+uint32_t gpck_format_version(const gpck_pck* pck)
+{
+    return pck != nullptr ? pck->Pck->GetFormatVersion() : 0;
+}
+
+uint64_t gpck_entry_count(const gpck_pck* pck)
+{
+    return pck != nullptr ? pck->Pck->GetContents().size() : 0;
+}
+
+gpck_result gpck_entry_at(const gpck_pck* pck, uint64_t index, gpck_entry_info* info)
+{
+    // The entry list is a cache, so it is fine to update it through a const handle
+    return Guard(const_cast<gpck_pck*>(pck), [index, info](gpck_pck& pck) {
+        if(info == nullptr)
+            return Fail(pck, "info is null", GPCK_INVALID_ARGUMENT);
+
+        if(!pck.EntriesValid) {
+            pck.Entries.clear();
+            pck.Entries.reserve(pck.Pck->GetContents().size());
+
+            for(const auto& [_, entry] : pck.Pck->GetContents())
+                pck.Entries.push_back(&entry);
+
+            pck.EntriesValid = true;
+        }
+
+        if(index >= pck.Entries.size())
+            return Fail(pck, "entry index out of range", GPCK_INVALID_ARGUMENT);
+
+        FillInfo(*pck.Entries[index], *info);
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_find(const gpck_pck* pck, const char* path, gpck_entry_info* info)
+{
+    return Guard(const_cast<gpck_pck*>(pck), [path, info](gpck_pck& pck) {
+        if(path == nullptr || info == nullptr)
+            return Fail(pck, "path or info is null", GPCK_INVALID_ARGUMENT);
+
+        const auto& contents = pck.Pck->GetContents();
+        const auto found = contents.find(path);
+
+        if(found == contents.end())
+            return Fail(pck, "file not found in the pck", GPCK_NOT_FOUND);
+
+        FillInfo(found->second, *info);
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_read(
+    gpck_pck* pck, const char* path, uint64_t start, void* buffer, size_t length)
+{
+    return Guard(pck, [=](gpck_pck& pck) {
+        if(path == nullptr || (buffer == nullptr && length > 0))
+            return Fail(pck, "path or buffer is null", GPCK_INVALID_ARGUMENT);
+
+        const auto& contents = pck.Pck->GetContents();
+        const auto found = contents.find(path);
+
+        if(found == contents.end())
+            return Fail(pck, "file not found in the pck", GPCK_NOT_FOUND);
+
+        const auto& entry = found->second;
+
+        if(start > entry.Size || length > entry.Size - start)
+            return Fail(pck, "read is past the end of the file", GPCK_INVALID_ARGUMENT);
+
+        if(length == 0)
+            return GPCK_OK;
+
+        if(entry.ReadRange) {
+            if(!entry.ReadRange(start, static_cast<char*>(buffer), length))
+                return Fail(pck, "reading the file data failed");
+
+            return GPCK_OK;
+        }
+
+        const auto data = entry.GetData();
+        std::memcpy(buffer, data.data() + start, length);
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_extract(gpck_pck* pck, const char* output_dir, uint32_t threads)
+{
+    return Guard(pck, [output_dir, threads](gpck_pck& pck) {
+        if(output_dir == nullptr)
+            return Fail(pck, "output_dir is null", GPCK_INVALID_ARGUMENT);
+
+        GetPool(pck, threads);
+
+        if(!pck.Pck->Extract(output_dir, false))
+            return Fail(pck, "extracting failed");
+
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_verify(gpck_pck* pck, uint32_t threads, uint64_t* mismatches)
+{
+    return Guard(pck, [threads, mismatches](gpck_pck& pck) {
+        GetPool(pck, threads);
+
+        const auto result = pck.Pck->Verify(false);
+
+        if(mismatches != nullptr)
+            *mismatches = result.Mismatched.size();
+
+        return GPCK_OK;
+    });
+}
+// ------------------------------------ //
+gpck_result gpck_add_data(gpck_pck* pck, const char* pck_path, uint64_t size,
+    gpck_read_callback read, gpck_release_callback release, void* user_data)
+{
+    // Released when the last copy of the data callbacks is gone, or right away if adding fails
+    std::shared_ptr<void> source;
+
+    try {
+        source = std::shared_ptr<void>(user_data, [release](void* data) {
+            if(release != nullptr)
+                release(data);
+        });
+    } catch(...) {
+        // shared_ptr calls the deleter itself when it can't allocate
+        return GPCK_ERROR;
+    }
+
+    return Guard(pck, [&](gpck_pck& pck) {
+        if(pck_path == nullptr || read == nullptr)
+            return Fail(pck, "pck_path or read is null", GPCK_INVALID_ARGUMENT);
+
+        PckFile::ContainedFile file;
+        file.Path = pck_path;
+        file.Offset = -1;
+        file.Size = size;
+
+        file.ReadRange = [source, read, size](uint64_t start, char* buffer, size_t length) {
+            if(start + length > size)
+                return false;
+
+            return read(source.get(), start, buffer, length) == 0;
+        };
+
+        file.GetData = [source, read, size]() {
+            std::string data;
+            data.resize(size);
+
+            if(size > 0 && read(source.get(), 0, data.data(), data.size()) != 0)
+                throw std::runtime_error("data callback failed");
+
+            return data;
+        };
+
+        pck.Pck->AddFile(std::move(file));
+        pck.EntriesValid = false;
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_add_file(gpck_pck* pck, const char* source_path, const char* pck_path)
+{
+    return Guard(pck, [source_path, pck_path](gpck_pck& pck) {
+        if(source_path == nullptr || pck_path == nullptr)
+            return Fail(pck, "source_path or pck_path is null", GPCK_INVALID_ARGUMENT);
+
+        pck.Pck->AddSingleFile(source_path, pck_path);
+        pck.EntriesValid = false;
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_remove(gpck_pck* pck, const char* pck_path)
+{
+    return Guard(pck, [pck_path](gpck_pck& pck) {
+        if(pck_path == nullptr)
+            return Fail(pck, "pck_path is null", GPCK_INVALID_ARGUMENT);
+
+        if(!pck.Pck->RemoveFile(pck_path))
+            return Fail(pck, "file not found in the pck", GPCK_NOT_FOUND);
+
+        pck.EntriesValid = false;
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_save(gpck_pck* pck)
+{
+    return Guard(pck, [](gpck_pck& pck) {
+        if(!pck.Pck->Save())
+            return Fail(pck, "saving the pck failed");
+
+        // Saving closes the old file, the handle keeps working by reading the saved one
+        pck.EntriesValid = false;
+
+        if(!pck.Pck->Load())
+            return Fail(pck, "loading the saved pck failed");
+
+        return GPCK_OK;
+    });
+}
+
+gpck_result gpck_save_memory(gpck_pck* pck, gpck_write_callback write, void* user_data)
+{
+    return Guard(pck, [write, user_data](gpck_pck& pck) {
+        if(write == nullptr)
+            return Fail(pck, "write is null", GPCK_INVALID_ARGUMENT);
+
+        std::string data;
+
+        if(!pck.Pck->SaveToMemory(data))
+            return Fail(pck, "saving the pck failed");
+
+        if(write(user_data, data.data(), data.size()) != 0)
+            return Fail(pck, "write callback failed");
+
+        return GPCK_OK;
+    });
+}
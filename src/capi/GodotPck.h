@@ -0,0 +1,130 @@
+/* C interface of the pck library, built as the gpck shared library
+ *
+ * The functions and structs here are kept binary compatible between releases, new
+ * functionality is only added with new functions. GPCK_API_VERSION is increased when
+ * functions are added. Strings are UTF-8. Functions returning gpck_result never throw and
+ * store a description of the failure that gpck_last_error returns.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef GPCK_BUILDING
+#define GPCK_API __declspec(dllexport)
+#else
+#define GPCK_API __declspec(dllimport)
+#endif
+#else
+#define GPCK_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPCK_API_VERSION 2
+
+typedef enum gpck_result {
+    GPCK_OK = 0,
+    GPCK_ERROR = 1,
+    GPCK_NOT_FOUND = 2,
+    GPCK_INVALID_ARGUMENT = 3
+} gpck_result;
+
+/* An open pck, not safe to use from multiple threads at once */
+typedef struct gpck_pck gpck_pck;
+
+typedef struct gpck_entry_info {
+    /* Valid until the entries of the pck are changed or it is closed */
+    const char* path;
+
+    /* Absolute position of the data in the pck file, 0 for files that are not saved yet */
+    uint64_t offset;
+    uint64_t size;
+    uint8_t md5[16];
+    uint32_t flags;
+} gpck_entry_info;
+
+/* Reads length bytes of a file being added starting at offset into buffer.
+ * Returns 0 on success and any other value to abort the save. */
+typedef int (*gpck_read_callback)(void* user_data, uint64_t offset, void* buffer, size_t length);
+
+/* Called when the data source of a file is no longer needed, can be null */
+typedef void (*gpck_release_callback)(void* user_data);
+
+/* Receives the data of a pck saved into memory.
+ * Returns 0 on success and any other value to fail the save. */
+typedef int (*gpck_write_callback)(void* user_data, const void* data, size_t length);
+
+GPCK_API uint32_t gpck_api_version(void);
+
+/* Opens and loads an existing pck. key is the 32 byte encryption key or null.
+ * Returns null on failure, the error is then available from gpck_last_error(NULL). */
+GPCK_API gpck_pck* gpck_open(const char* path, const uint8_t* key);
+
+/* Loads a pck from memory (since API version 2). The data is copied and the file data is
+ * read from the copy, so no files are used. name is used in errors and as the path
+ * gpck_save writes to. */
+GPCK_API gpck_pck* gpck_open_memory(
+    const void* data, size_t size, const char* name, const uint8_t* key);
+
+/* Starts a new empty pck that is written to path when saved */
+GPCK_API gpck_pck* gpck_create(
+    const char* path, uint32_t godot_major, uint32_t godot_minor, uint32_t godot_patch);
+
+GPCK_API void gpck_close(gpck_pck* pck);
+
+/* Description of the last failure on the pck, or of the last failed open or create when pck
+ * is null. Valid until the next call with the same pck. */
+GPCK_API const char* gpck_last_error(const gpck_pck* pck);
+
+/* Sets the memory budget for data buffers, 0 (the default) reads each file whole */
+GPCK_API gpck_result gpck_set_memory_limit(gpck_pck* pck, uint64_t bytes);
+
+GPCK_API uint32_t gpck_format_version(const gpck_pck* pck);
+
+/* The entries are in path order */
+GPCK_API uint64_t gpck_entry_count(const gpck_pck* pck);
+
+GPCK_API gpck_result gpck_entry_at(const gpck_pck* pck, uint64_t index, gpck_entry_info* info);
+
+GPCK_API gpck_result gpck_find(const gpck_pck* pck, const char* path, gpck_entry_info* info);
+
+/* Reads part of the (decrypted) data of a file into a caller provided buffer */
+GPCK_API gpck_result gpck_read(
+    gpck_pck* pck, const char* path, uint64_t start, void* buffer, size_t length);
+
+/* Extracts all files under output_dir, threads 0 uses all CPU cores */
+GPCK_API gpck_result gpck_extract(gpck_pck* pck, const char* output_dir, uint32_t threads);
+
+/* Checks the data of all files against their MD5s. mismatches receives the number of files
+ * that didn't match and can be null. */
+GPCK_API gpck_result gpck_verify(gpck_pck* pck, uint32_t threads, uint64_t* mismatches);
+
+/* Adds or replaces a file with data from a callback, which is called while saving. The
+ * release callback is called once the data isn't needed anymore, which is right away if
+ * adding fails. */
+GPCK_API gpck_result gpck_add_data(gpck_pck* pck, const char* pck_path, uint64_t size,
+    gpck_read_callback read, gpck_release_callback release, void* user_data);
+
+/* Adds or replaces a file with the data of a file on disk */
+GPCK_API gpck_result gpck_add_file(
+    gpck_pck* pck, const char* source_path, const char* pck_path);
+
+GPCK_API gpck_result gpck_remove(gpck_pck* pck, const char* pck_path);
+
+/* Writes the pck to its path. The pck is then loaded again from the saved file, so the handle
+ * stays usable, but entry infos and paths returned before this are no longer valid. */
+GPCK_API gpck_result gpck_save(gpck_pck* pck);
+
+/* Writes the pck into memory and passes it to write in one call, without any files (since
+ * API version 2). The files keep reading their data from where it was loaded from, so this
+ * can be called again. */
+GPCK_API gpck_result gpck_save_memory(
+    gpck_pck* pck, gpck_write_callback write, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,9 +1,12 @@
 #include "Define.h"
 #include "FileFilter.h"
 #include "PckTool.h"
+#include "pck/BufferPool.h"
 
 #include <cxxopts.hpp>
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <regex>
 #include <string>
@@ -87,6 +90,51 @@ int main(int argc, char* argv[])
         ("v,version", "Print version and quit")
         ("h,help", "Print help and quit")
         ("no-res-prefix", "Don't add res:// prefix to files added to a pck")
+        ("layout-profile", "File listing res:// paths (one per line) in the order the game "
+            "loads them, their data is placed first and in that order when saving",
+            cxxopts::value<std::string>())
+        ("align", "Set alignment rules for file data when saving, format: type:value=alignment "
+            "where type is ext, size (minimum file size) or regex. For example ext:.ogv=4096",
+            cxxopts::value<std::vector<std::string>>())
+        ("threads", "Number of threads for parallel operations (0 uses all CPU cores)",
+            cxxopts::value<unsigned>()->default_value("0"))
+        ("batch-operation", "Operation to run on all packs with the batch action: list, verify, "
+            "extract or stats", cxxopts::value<std::string>()->default_value("stats"))
+        ("format", "Output format for the list action (text, ndjson or csv), the analyze "
+            "action (text or json) and the manifest action (binary or json)",
+            cxxopts::value<std::string>()->default_value("text"))
+        ("sidecar-index", "Use a .pck.idx sidecar index to speed up loading, the index is "
+            "(re)generated when saving or when it is out of date")
+        ("encryption-key", "Key (64 hex characters) for encrypted packs, can also be set with "
+            "the GODOT_SCRIPT_ENCRYPTION_KEY environment variable",
+            cxxopts::value<std::string>())
+        ("encrypt-directory", "Encrypt the directory of the pck when saving")
+        ("encrypt-files", "Set regexes for files to encrypt when saving",
+            cxxopts::value<std::vector<std::string>>())
+        ("max-memory", "Limit the memory used for file data buffers, for example 512M or 2G. "
+            "Files are then streamed in chunks instead of read whole",
+            cxxopts::value<std::string>())
+        ("resume", "Keep a journal of extracted files next to the output folder so that an "
+            "interrupted extraction continues from where it stopped when run again")
+        ("remove-missing", "With the sync and watch actions, remove pck entries that don't "
+            "have a matching source file")
+        ("overlay-operation", "Operation to run on the combined files of the packs with the "
+            "overlay action: list, lookup, extract or verify",
+            cxxopts::value<std::string>()->default_value("list"))
+        ("lookup-path", "Path to look up with the overlay lookup operation",
+            cxxopts::value<std::vector<std::string>>())
+        ("progress", "Show the progress of long operations on stderr: bar, json or auto (a "
+            "bar on terminals, otherwise JSON lines)",
+            cxxopts::value<std::string>()->implicit_value("auto"))
+        ("durability", "How carefully written data is synced to disk: normal, fast (no syncs, "
+            "fewer filesystem operations) or safe (saved packs replace the old file only once "
+            "on disk, extracted files are synced together at the end)",
+            cxxopts::value<std::string>()->default_value("normal"))
+        ("hash-contents", "With the analyze action, find duplicate files by hashing their "
+            "data instead of using the hashes in the pck directory")
+        ("coalesce", "With the manifest action, group files smaller than this (for example "
+            "64K) that are next to each other into ranges of up to this size",
+            cxxopts::value<std::string>())
         ;
     // clang-format on
 
@@ -110,6 +158,20 @@ int main(int argc, char* argv[])
         PrintActionLine("[e]xtract", "Extract the contents of a pck");
         PrintActionLine("[a]dd", "Add files to a new or existing pck");
         PrintActionLine("[r]epack", "Repack an existing pack, optionally to a different file");
+        PrintActionLine("sync", "Update a pck to match files on disk, writing only changes");
+        PrintActionLine("watch", "Sync a pck and keep it updated as files on disk change");
+        PrintActionLine("remove", "Remove files by path or filters from a pck");
+        PrintActionLine("delta", "Write a delta (to --output) from an older build of a pck");
+        PrintActionLine("apply-delta", "Turn a pck into a newer build with a delta file");
+        PrintActionLine("compact", "Reclaim unused space in a pck without a second copy");
+        PrintActionLine("overlay", "List the combined files of a pck and its patch packs");
+        PrintActionLine("verify", "Check the contents of a pck against the stored hashes");
+        PrintActionLine("stats", "Print summary info about a pck");
+        PrintActionLine("analyze", "Report padding, unused space, duplicates and file sizes");
+        PrintActionLine("manifest", "Write the byte ranges of the files for range requests");
+        PrintActionLine("batch", "Run an operation on many pcks, prints a JSON report");
+        PrintActionLine("index", "Generate a .pck.idx sidecar index for a pck");
+        PrintActionLine("lookup", "Print info about single files in a pck (uses the index)");
         return 0;
     }
 
@@ -119,12 +181,29 @@ int main(int argc, char* argv[])
     std::string output;
     std::string removePrefix;
     std::string commandFile;
+    std::string layoutProfile;
     int godotMajor, godotMinor, godotPatch;
-    nlohmann::json fileCommands;
     pcktool::FileFilter filter;
+    pcktool::AlignmentPolicy alignment;
     bool reducedVerbosity = false;
     bool printHashes = false;
     bool noResPrefix = false;
+    bool sidecarIndex = false;
+    unsigned threads = 0;
+    std::string batchOperation;
+    std::string listFormat;
+    std::optional<pcktool::EncryptionKey> encryptionKey;
+    bool encryptDirectory = false;
+    std::vector<std::regex> encryptFiles;
+    uint64_t maxMemory = 0;
+    bool resume = false;
+    bool removeMissing = false;
+    std::string overlayOperation;
+    std::vector<std::string> lookupPaths;
+    std::optional<pcktool::ProgressReporter::Style> progress;
+    auto durability = pcktool::Durability::Normal;
+    bool hashContents = false;
+    uint64_t coalesceLimit = 0;
 
     if(result.count("file")) {
         files = result["file"].as<decltype(files)>();
@@ -152,6 +231,10 @@ int main(int argc, char* argv[])
         commandFile = result["command-file"].as<std::string>();
     }
 
+    if(result.count("layout-profile")) {
+        layoutProfile = result["layout-profile"].as<std::string>();
+    }
+
     if(result.count("min-size-filter")) {
         filter.SetSizeMinLimit(result["min-size-filter"].as<uint64_t>());
     }
@@ -162,8 +245,8 @@ int main(int argc, char* argv[])
 
     if(result.count("include-regex-filter")) {
         // TODO: should we add a wildcard / plain text search mode?
-        filter.SetIncludeRegexes(
-            ParseRegexList(result["include-regex-filter"].as<std::vector<std::string>>()));
+        const auto& texts = result["include-regex-filter"].as<std::vector<std::string>>();
+        filter.SetIncludeRegexes(ParseRegexList(texts), texts);
     }
 
     if(result.count("exclude-regex-filter")) {
@@ -176,6 +259,18 @@ int main(int argc, char* argv[])
             ParseRegexList(result["include-override-filter"].as<std::vector<std::string>>()));
     }
 
+    if(result.count("align")) {
+        for(const auto& rule : result["align"].as<std::vector<std::string>>()) {
+            try {
+                alignment.AddRule(rule);
+            } catch(const std::invalid_argument& e) {
+                std::cout << "ERROR: invalid alignment rule (" << rule << "): " << e.what()
+                          << "\n";
+                return 1;
+            }
+        }
+    }
+
     if(result.count("quieter")) {
         reducedVerbosity = true;
     }
@@ -188,84 +283,133 @@ int main(int argc, char* argv[])
         noResPrefix = true;
     }
 
-    action = result["action"].as<std::string>();
+    if(result.count("sidecar-index")) {
+        sidecarIndex = true;
+    }
 
-    try {
-        std::tie(godotMajor, godotMinor, godotPatch) =
-            ParseGodotVersion(result["set-godot-version"].as<std::string>());
-    } catch(const std::exception& e) {
-        std::cout << "ERROR: specified version number is invalid: " << e.what() << "\n";
-        return 1;
+    if(result.count("encrypt-directory")) {
+        encryptDirectory = true;
     }
 
-    bool alreadyRead = false;
+    if(result.count("encrypt-files")) {
+        encryptFiles = ParseRegexList(result["encrypt-files"].as<std::vector<std::string>>());
+    }
 
-    // Stdin json commands
-    for(auto iter = files.begin(); iter != files.end();) {
-        if(*iter != "-" || alreadyRead) {
-            ++iter;
-            continue;
+    if(result.count("max-memory")) {
+        try {
+            maxMemory = pcktool::BufferPool::ParseSize(result["max-memory"].as<std::string>());
+        } catch(const std::invalid_argument& e) {
+            std::cout << "ERROR: invalid memory limit: " << e.what() << "\n";
+            return 1;
         }
+    }
 
-        alreadyRead = true;
-        iter = files.erase(iter);
+    if(result.count("coalesce")) {
+        try {
+            coalesceLimit =
+                pcktool::BufferPool::ParseSize(result["coalesce"].as<std::string>());
+        } catch(const std::invalid_argument& e) {
+            std::cout << "ERROR: invalid coalesce size: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
-        std::cout << "Reading JSON file commands from STDIN until EOF...\n";
+    if(result.count("resume")) {
+        resume = true;
+    }
 
-        std::string data;
+    if(result.count("remove-missing")) {
+        removeMissing = true;
+    }
 
-        std::string line;
-        while(std::getline(std::cin, line)) {
-            data += line;
-        }
+    if(result.count("hash-contents")) {
+        hashContents = true;
+    }
 
-        std::cout << "Finished reading STDIN (total characters: " << data.size() << ").\n";
+    if(result.count("lookup-path")) {
+        lookupPaths = result["lookup-path"].as<std::vector<std::string>>();
+    }
 
-        try {
-            fileCommands = nlohmann::json::parse(data);
-        } catch(const nlohmann::json::parse_error& e) {
-            std::cout << "ERROR: invalid json: " << e.what() << "\n";
+    if(result.count("progress")) {
+        const auto style = result["progress"].as<std::string>();
+
+        if(style == "bar") {
+            progress = pcktool::ProgressReporter::Style::Bar;
+        } else if(style == "json") {
+            progress = pcktool::ProgressReporter::Style::JSON;
+        } else if(style == "auto") {
+            progress = pcktool::ProgressReporter::DefaultStyleFor(
+                pcktool::ProgressReporter::IsErrorTerminal());
+        } else {
+            std::cout << "ERROR: unknown progress style: " << style
+                      << " (expected bar, json or auto)\n";
             return 1;
         }
     }
 
-    if(!commandFile.empty()) {
-        std::cout << "Reading JSON commands from file: " << commandFile << "\n";
+    if(const auto mode = result["durability"].as<std::string>(); mode == "fast") {
+        durability = pcktool::Durability::Fast;
+    } else if(mode == "safe") {
+        durability = pcktool::Durability::Safe;
+    } else if(mode != "normal") {
+        std::cout << "ERROR: unknown durability mode: " << mode
+                  << " (expected normal, fast or safe)\n";
+        return 1;
+    }
 
-        try {
-            auto file = std::ifstream(commandFile);
+    // The same variable Godot uses for the key when compiling export templates
+    std::string keyText;
 
-            if(!file.good())
-                throw std::runtime_error("failed to open the command file");
+    if(result.count("encryption-key")) {
+        keyText = result["encryption-key"].as<std::string>();
+    } else if(const char* environmentKey = std::getenv("GODOT_SCRIPT_ENCRYPTION_KEY")) {
+        keyText = environmentKey;
+    }
 
-            std::stringstream buffer;
-            buffer << file.rdbuf();
+    if(!keyText.empty()) {
+        pcktool::EncryptionKey key;
 
-            const auto parsed = nlohmann::json::parse(buffer);
+        if(!pcktool::ParseEncryptionKey(keyText, key)) {
+            std::cout << "ERROR: encryption key must be 64 hex characters\n";
+            return 1;
+        }
 
-            if(!parsed.is_array()) {
-                throw std::runtime_error(
-                    "expected JSON file to contain a single JSON array with objects in it");
-            }
+        encryptionKey = key;
+    }
 
-            if(!fileCommands.is_array()) {
-                // If didn't read stdin commands, make the result array now
-                fileCommands = nlohmann::json::array();
-            }
+    action = result["action"].as<std::string>();
+    threads = result["threads"].as<unsigned>();
+    batchOperation = result["batch-operation"].as<std::string>();
+    listFormat = result["format"].as<std::string>();
+    overlayOperation = result["overlay-operation"].as<std::string>();
 
-            for(const auto& entry : parsed) {
-                fileCommands.push_back(entry);
-            }
+    try {
+        std::tie(godotMajor, godotMinor, godotPatch) =
+            ParseGodotVersion(result["set-godot-version"].as<std::string>());
+    } catch(const std::exception& e) {
+        std::cout << "ERROR: specified version number is invalid: " << e.what() << "\n";
+        return 1;
+    }
 
-        } catch(const std::exception& e) {
-            std::cout << "ERROR: invalid json file: " << e.what() << "\n";
-            return 1;
-        }
+    std::vector<std::string> commandFiles;
+
+    // Stdin json commands, only read once even if specified multiple times
+    if(const auto stdinMarker = std::find(files.begin(), files.end(), "-");
+        stdinMarker != files.end()) {
+        files.erase(std::remove(stdinMarker, files.end(), "-"), files.end());
+        commandFiles.emplace_back("-");
     }
 
+    if(!commandFile.empty())
+        commandFiles.push_back(commandFile);
+
     auto tool =
         pcktool::PckTool({pack, action, files, output, removePrefix, godotMajor, godotMinor,
-            godotPatch, fileCommands, filter, reducedVerbosity, printHashes, noResPrefix});
+            godotPatch, commandFiles, filter, reducedVerbosity, printHashes, noResPrefix,
+            sidecarIndex, layoutProfile, alignment, threads, batchOperation, listFormat,
+            encryptionKey, encryptDirectory, encryptFiles, maxMemory, resume, removeMissing,
+            overlayOperation, lookupPaths, progress, durability, hashContents,
+            coalesceLimit});
 
     return tool.Run();
 }
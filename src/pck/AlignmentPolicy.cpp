@@ -0,0 +1,108 @@
+// ------------------------------------ //
+#include "AlignmentPolicy.h"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace pcktool;
+// ------------------------------------ //
+void AlignmentPolicy::AddRule(const std::string& text)
+{
+    const auto typeEnd = text.find(':');
+    const auto valueEnd = text.rfind('=');
+
+    if(typeEnd == std::string::npos || valueEnd == std::string::npos || valueEnd < typeEnd)
+        throw std::invalid_argument("expected format type:value=alignment");
+
+    const auto type = text.substr(0, typeEnd);
+    const auto value = text.substr(typeEnd + 1, valueEnd - typeEnd - 1);
+
+    Rule rule;
+    rule.Text = value;
+
+    try {
+        const auto alignment = std::stoull(text.substr(valueEnd + 1));
+
+        // Zero would mean no alignment, but that is not useful as a rule
+        if(alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+            alignment > 16 * 1024 * 1024) {
+            throw std::invalid_argument("bad alignment");
+        }
+
+        rule.Alignment = static_cast<uint32_t>(alignment);
+    } catch(const std::exception&) {
+        throw std::invalid_argument("alignment must be a power of two (max 16 MiB)");
+    }
+
+    if(value.empty())
+        throw std::invalid_argument("rule value is empty");
+
+    if(type == "ext") {
+        rule.Type = RuleType::Extension;
+    } else if(type == "size") {
+        rule.Type = RuleType::MinSize;
+
+        try {
+            rule.Size = std::stoull(value);
+        } catch(const std::exception&) {
+            throw std::invalid_argument("size rule value is not a number");
+        }
+    } else if(type == "regex") {
+        rule.Type = RuleType::Regex;
+
+        try {
+            rule.Pattern = std::regex(value, std::regex_constants::ECMAScript);
+        } catch(const std::regex_error& e) {
+            throw std::invalid_argument(std::string("invalid regex: ") + e.what());
+        }
+    } else {
+        throw std::invalid_argument("unknown rule type (expected ext, size or regex)");
+    }
+
+    AddRule(std::move(rule));
+}
+
+void AlignmentPolicy::AddRule(Rule rule)
+{
+    Rules.push_back(std::move(rule));
+}
+// ------------------------------------ //
+int AlignmentPolicy::FindRule(const PckFile::ContainedFile& file) const
+{
+    for(size_t i = 0; i < Rules.size(); ++i) {
+        const auto& rule = Rules[i];
+
+        switch(rule.Type) {
+            case RuleType::Extension:
+                if(file.Path.size() >= rule.Text.size() &&
+                    file.Path.compare(file.Path.size() - rule.Text.size(), rule.Text.size(),
+                        rule.Text) == 0) {
+                    return static_cast<int>(i);
+                }
+                break;
+            case RuleType::MinSize:
+                if(file.Size >= rule.Size)
+                    return static_cast<int>(i);
+                break;
+            case RuleType::Regex:
+                if(std::regex_search(file.Path, rule.Pattern))
+                    return static_cast<int>(i);
+                break;
+        }
+    }
+
+    return -1;
+}
+// ------------------------------------ //
+std::string AlignmentPolicy::DescribeRule(const Rule& rule)
+{
+    std::string type;
+
+    switch(rule.Type) {
+        case RuleType::Extension: type = "ext"; break;
+        case RuleType::MinSize: type = "size"; break;
+        case RuleType::Regex: type = "regex"; break;
+    }
+
+    return type + ":" + rule.Text + "=" + std::to_string(rule.Alignment);
+}
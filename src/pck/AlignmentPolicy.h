@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Selects the data alignment for files when saving a pck
+//!
+//! Rules are checked in the order they were added and the first matching rule decides the
+//! alignment. Files not matching any rule use the default pck alignment.
+class AlignmentPolicy {
+public:
+    enum class RuleType {
+        //! Matches files ending with the text
+        Extension,
+        //! Matches files at least the specified size
+        MinSize,
+        //! Matches files whose path contains a match for a regex
+        Regex
+    };
+
+    struct Rule {
+        RuleType Type;
+        std::string Text;
+        uint64_t Size = 0;
+        std::regex Pattern;
+        uint32_t Alignment;
+    };
+
+public:
+    //! \brief Parses and adds a rule in the format "type:value=alignment"
+    //!
+    //! Types are "ext", "size" and "regex", for example "ext:.ogv=4096"
+    //! \exception std::invalid_argument if the rule is not valid
+    void AddRule(const std::string& text);
+
+    void AddRule(Rule rule);
+
+    //! \returns The index of the first matching rule or -1 if no rule matches
+    [[nodiscard]] int FindRule(const PckFile::ContainedFile& file) const;
+
+    [[nodiscard]] const std::vector<Rule>& GetRules() const
+    {
+        return Rules;
+    }
+
+    [[nodiscard]] bool Empty() const
+    {
+        return Rules.empty();
+    }
+
+    //! \returns Text describing a rule for printing
+    [[nodiscard]] static std::string DescribeRule(const Rule& rule);
+
+private:
+    std::vector<Rule> Rules;
+};
+
+} // namespace pcktool
@@ -0,0 +1,126 @@
+// ------------------------------------ //
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+using namespace pcktool;
+
+constexpr size_t MIN_BUFFER_SIZE = 64 * 1024;
+constexpr size_t MAX_BUFFER_SIZE = 8 * 1024 * 1024;
+
+//! Buffer sizes are kept a multiple of this so that they work for encryption and direct IO
+constexpr size_t BUFFER_SIZE_GRANULARITY = 4096;
+
+static size_t PickBufferSize(uint64_t budget)
+{
+    // Enough buffers that all threads can have some work in flight
+    const auto size = std::clamp<uint64_t>(budget / 16, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE);
+
+    return static_cast<size_t>(size / BUFFER_SIZE_GRANULARITY * BUFFER_SIZE_GRANULARITY);
+}
+
+//! \brief Rounds an explicitly requested size up so that padded encrypted blocks still fit
+static size_t RoundBufferSize(size_t size)
+{
+    return (size + BUFFER_SIZE_GRANULARITY - 1) / BUFFER_SIZE_GRANULARITY *
+           BUFFER_SIZE_GRANULARITY;
+}
+
+// ------------------------------------ //
+// Buffer
+BufferPool::Buffer::Buffer(BufferPool* pool, char* data, size_t size) :
+    Pool(pool), Data(data), Size(size)
+{}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept :
+    Pool(other.Pool), Data(other.Data), Size(other.Size)
+{
+    other.Pool = nullptr;
+    other.Data = nullptr;
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    if(Pool != nullptr)
+        Pool->Release(Data);
+}
+// ------------------------------------ //
+// BufferPool
+BufferPool::BufferPool(uint64_t budget, size_t bufferSize /*= 0*/) :
+    BufferSize(bufferSize != 0 ? RoundBufferSize(bufferSize) : PickBufferSize(budget)),
+    MaxBuffers(static_cast<size_t>(std::max<uint64_t>(budget / BufferSize, 1)))
+{}
+// ------------------------------------ //
+BufferPool::Buffer BufferPool::Acquire()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+
+    if(FreeBuffers.empty() && Storage.size() < MaxBuffers) {
+        Storage.push_back(std::make_unique<char[]>(BufferSize));
+        return Buffer(this, Storage.back().get(), BufferSize);
+    }
+
+    Released.wait(lock, [this]() { return !FreeBuffers.empty(); });
+
+    char* data = FreeBuffers.back();
+    FreeBuffers.pop_back();
+
+    return Buffer(this, data, BufferSize);
+}
+
+void BufferPool::Release(char* data)
+{
+    {
+        std::lock_guard<std::mutex> lock(Lock);
+        FreeBuffers.push_back(data);
+    }
+
+    Released.notify_one();
+}
+// ------------------------------------ //
+uint64_t BufferPool::ParseSize(const std::string& text)
+{
+    size_t end = 0;
+    uint64_t value = 0;
+
+    try {
+        value = std::stoull(text, &end);
+    } catch(const std::exception&) {
+        throw std::invalid_argument("size must start with a number");
+    }
+
+    // Digits only is a byte count
+    if(end == text.size())
+        return value;
+
+    std::string suffix;
+
+    for(size_t i = end; i < text.size(); ++i)
+        suffix.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(text[i]))));
+
+    // Allow both 512M and 512MB
+    if(suffix.size() == 2 && suffix.back() == 'B')
+        suffix.pop_back();
+
+    int shift = 0;
+
+    if(suffix == "K") {
+        shift = 10;
+    } else if(suffix == "M") {
+        shift = 20;
+    } else if(suffix == "G") {
+        shift = 30;
+    } else if(suffix == "T") {
+        shift = 40;
+    } else {
+        throw std::invalid_argument("unknown size suffix: " + text.substr(end));
+    }
+
+    if(value > (std::numeric_limits<uint64_t>::max() >> shift))
+        throw std::invalid_argument("size is too large");
+
+    return value << shift;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Define.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Fixed size data buffers shared by all operations to stay within a memory budget
+//!
+//! Acquiring blocks while all the buffers are in use, which slows down parallel work instead
+//! of running out of memory. Users must not hold more than one buffer at a time, otherwise
+//! they can deadlock with each other.
+class BufferPool {
+public:
+    //! \brief A buffer from the pool, returned to the pool when destroyed
+    class Buffer {
+        friend BufferPool;
+
+    public:
+        ~Buffer();
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer(const Buffer& other) = delete;
+
+        Buffer& operator=(Buffer&& other) = delete;
+        Buffer& operator=(const Buffer& other) = delete;
+
+        [[nodiscard]] char* GetData() const
+        {
+            return Data;
+        }
+
+        [[nodiscard]] size_t GetSize() const
+        {
+            return Size;
+        }
+
+    private:
+        Buffer(BufferPool* pool, char* data, size_t size);
+
+    private:
+        BufferPool* Pool;
+        char* Data;
+        size_t Size;
+    };
+
+public:
+    //! \param budget Maximum total size of the buffers, at least one buffer is always allowed
+    //! \param bufferSize Size of each buffer (rounded up to a multiple of 4096), 0 picks a
+    //! size based on the budget
+    explicit BufferPool(uint64_t budget, size_t bufferSize = 0);
+
+    BufferPool(BufferPool&& other) = delete;
+    BufferPool(const BufferPool& other) = delete;
+
+    BufferPool& operator=(BufferPool&& other) = delete;
+    BufferPool& operator=(const BufferPool& other) = delete;
+
+    //! \brief Gets a free buffer, waiting for one to be released if all are in use
+    Buffer Acquire();
+
+    [[nodiscard]] size_t GetBufferSize() const
+    {
+        return BufferSize;
+    }
+
+    [[nodiscard]] size_t GetBufferCount() const
+    {
+        return MaxBuffers;
+    }
+
+    //! \brief Parses a size like 512M or 2G (K, M, G and T suffixes are powers of 1024)
+    //! \exception std::invalid_argument if the size is not valid
+    static uint64_t ParseSize(const std::string& text);
+
+private:
+    void Release(char* data);
+
+private:
+    const size_t BufferSize;
+    const size_t MaxBuffers;
+
+    std::mutex Lock;
+    std::condition_variable Released;
+
+    //! Buffers are allocated when first needed
+    std::vector<std::unique_ptr<char[]>> Storage;
+    std::vector<char*> FreeBuffers;
+};
+
+} // namespace pcktool
@@ -0,0 +1,230 @@
+// ------------------------------------ //
+#include "DirectoryWatcher.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace pcktool;
+
+#if defined(__linux__)
+constexpr uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                  IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+#endif
+
+//! Big enough for many events with long names
+constexpr size_t EVENT_BUFFER_SIZE = 64 * 1024;
+// ------------------------------------ //
+DirectoryWatcher::DirectoryWatcher()
+{
+#if defined(__linux__)
+    Descriptor = inotify_init1(IN_CLOEXEC);
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+#if defined(__linux__)
+    if(Descriptor >= 0)
+        ::close(Descriptor);
+#endif
+}
+// ------------------------------------ //
+bool DirectoryWatcher::AddTree(const std::string& path)
+{
+    if(!AddWatch(path, true))
+        return false;
+
+    std::error_code error;
+
+    for(std::filesystem::recursive_directory_iterator iterator(path, error), end;
+        !error && iterator != end; iterator.increment(error)) {
+        if(iterator->is_directory(error) && !AddWatch(iterator->path().string(), true))
+            return false;
+    }
+
+    if(error) {
+        std::cout << "ERROR: listing directory to watch failed: " << path << ": "
+                  << error.message() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool DirectoryWatcher::AddWatch(const std::string& path, bool tree)
+{
+#if defined(__linux__)
+    if(Descriptor < 0) {
+        std::cout << "ERROR: creating inotify instance failed\n";
+        return false;
+    }
+
+    const int watch = inotify_add_watch(Descriptor, path.c_str(), WATCH_EVENTS);
+
+    if(watch < 0) {
+        // Removed before it could be watched, the removal is handled as a change
+        if(errno == ENOENT)
+            return true;
+
+        std::cout << "ERROR: watching directory failed: " << path;
+
+        if(errno == ENOSPC)
+            std::cout << " (increase fs.inotify.max_user_watches)";
+
+        std::cout << "\n";
+        return false;
+    }
+
+    // A directory moved inside the tree keeps its watch, so this also updates the path
+    Directories[watch] = Watch{path, tree};
+    return true;
+#else
+    (void)tree;
+    std::cout << "ERROR: watching directories is not supported on this platform: " << path
+              << "\n";
+    return false;
+#endif
+}
+// ------------------------------------ //
+bool DirectoryWatcher::WaitForChanges(std::vector<Change>& changes, bool& rescan,
+    std::chrono::milliseconds quiet, std::chrono::milliseconds maxWait)
+{
+    changes.clear();
+    rescan = false;
+
+    std::vector<Change> events;
+
+    // Nothing to do until something happens
+    if(ReadEvents(events, rescan, -1) < 0)
+        return false;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    while(true) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            maxWait - (std::chrono::steady_clock::now() - start));
+
+        if(remaining.count() <= 0)
+            break;
+
+        const auto read =
+            ReadEvents(events, rescan, static_cast<int>(std::min(quiet, remaining).count()));
+
+        if(read < 0)
+            return false;
+
+        if(read == 0)
+            break;
+    }
+
+    // Only the last change of each path matters
+    std::unordered_map<std::string, size_t> latest;
+
+    for(auto& event : events) {
+        const auto [existing, added] = latest.emplace(event.Path, changes.size());
+
+        if(added) {
+            changes.push_back(std::move(event));
+        } else {
+            changes[existing->second] = std::move(event);
+        }
+    }
+
+    return true;
+}
+
+int DirectoryWatcher::ReadEvents(
+    std::vector<Change>& changes, bool& rescan, int timeoutMilliseconds)
+{
+#if defined(__linux__)
+    pollfd poll{Descriptor, POLLIN, 0};
+
+    const int ready = ::poll(&poll, 1, timeoutMilliseconds);
+
+    if(ready < 0) {
+        if(errno == EINTR)
+            return 0;
+
+        std::cout << "ERROR: waiting for directory changes failed\n";
+        return -1;
+    }
+
+    if(ready == 0)
+        return 0;
+
+    alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+
+    const auto length = ::read(Descriptor, buffer, sizeof(buffer));
+
+    if(length < 0) {
+        if(errno == EINTR || errno == EAGAIN)
+            return 0;
+
+        std::cout << "ERROR: reading directory changes failed\n";
+        return -1;
+    }
+
+    int count = 0;
+
+    for(ssize_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        ++count;
+
+        if(event->mask & IN_Q_OVERFLOW) {
+            rescan = true;
+            continue;
+        }
+
+        if(event->mask & IN_IGNORED) {
+            Directories.erase(event->wd);
+            continue;
+        }
+
+        const auto directory = Directories.find(event->wd);
+
+        // Events without a name are about the watched directory itself, its removal is
+        // already reported by its parent
+        if(directory == Directories.end() || event->len == 0)
+            continue;
+
+        Change change;
+        change.Path = (std::filesystem::path(directory->second.Path) / event->name).string();
+        change.Directory = event->mask & IN_ISDIR;
+        change.Removed = event->mask & (IN_DELETE | IN_MOVED_FROM);
+
+        // Files are reported once they are written, not when created
+        if(!change.Directory && (event->mask & IN_CREATE))
+            continue;
+
+        if(change.Directory && !change.Removed && directory->second.Tree &&
+            !AddTree(change.Path))
+            return -1;
+
+        changes.push_back(std::move(change));
+    }
+
+    return count;
+#else
+    (void)changes;
+    (void)rescan;
+    (void)timeoutMilliseconds;
+    return -1;
+#endif
+}
+// ------------------------------------ //
+bool DirectoryWatcher::IsSupported()
+{
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
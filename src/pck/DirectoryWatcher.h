@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Define.h"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Watches directory trees for changed files, using inotify
+//!
+//! Only available on Linux, elsewhere IsSupported returns false and adding watches fails.
+class DirectoryWatcher {
+public:
+    struct Change {
+        std::string Path;
+
+        //! The file or directory was removed or moved away, otherwise it was written or moved
+        //! into a watched directory
+        bool Removed = false;
+
+        //! A whole directory was added or removed, all the files under it should be checked
+        bool Directory = false;
+    };
+
+public:
+    DirectoryWatcher();
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(DirectoryWatcher&& other) = delete;
+    DirectoryWatcher(const DirectoryWatcher& other) = delete;
+
+    DirectoryWatcher& operator=(DirectoryWatcher&& other) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher& other) = delete;
+
+    //! \brief Watches a directory and all directories under it, new subdirectories are
+    //! watched automatically
+    bool AddTree(const std::string& path);
+
+    //! \brief Watches only the files directly in a directory
+    bool AddDirectory(const std::string& path)
+    {
+        return AddWatch(path, false);
+    }
+
+    //! \brief Waits for changes and returns them once no more have arrived for the quiet time
+    //! (or maxWait has passed since the first one), so that a burst of changes is handled at
+    //! once
+    //!
+    //! Multiple changes to the same path are combined into one.
+    //! \param rescan Set to true if the OS dropped events, everything should then be checked
+    //! \returns False on an error
+    bool WaitForChanges(std::vector<Change>& changes, bool& rescan,
+        std::chrono::milliseconds quiet, std::chrono::milliseconds maxWait);
+
+    [[nodiscard]] size_t GetWatchCount() const
+    {
+        return Directories.size();
+    }
+
+    //! \returns True if watching is possible on this platform
+    static bool IsSupported();
+
+private:
+    //! \param timeoutMilliseconds How long to wait for events, -1 waits until there are some
+    //! \returns The number of events read, -1 on an error
+    int ReadEvents(std::vector<Change>& changes, bool& rescan, int timeoutMilliseconds);
+
+    bool AddWatch(const std::string& path, bool tree);
+
+private:
+    struct Watch {
+        std::string Path;
+
+        //! New subdirectories of tree watches are watched as well
+        bool Tree;
+    };
+
+    int Descriptor = -1;
+
+    //! Watched directories by watch descriptor
+    std::unordered_map<int, Watch> Directories;
+};
+
+} // namespace pcktool
@@ -0,0 +1,378 @@
+// ------------------------------------ //
+#include "Encryption.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PCKTOOL_AES_INSTRUCTIONS
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PCKTOOL_TARGET_AES
+#else
+#include <cpuid.h>
+#define PCKTOOL_TARGET_AES __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+using namespace pcktool;
+
+namespace {
+
+//! Number of blocks the hardware decryption processes at once to keep the AES unit busy
+constexpr size_t PARALLEL_BLOCKS = 8;
+
+constexpr int ROUNDS = 14;
+
+uint8_t RotateLeft8(uint8_t value, int shift)
+{
+    return static_cast<uint8_t>((value << shift) | (value >> (8 - shift)));
+}
+
+uint32_t RotateRight32(uint32_t value, int shift)
+{
+    return (value >> shift) | (value << (32 - shift));
+}
+
+uint8_t MultiplyBy2(uint8_t value)
+{
+    return static_cast<uint8_t>((value << 1) ^ ((value & 0x80) ? 0x1b : 0));
+}
+
+uint32_t LoadBigEndian(const uint8_t* data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+void StoreBigEndian(uint32_t value, uint8_t* data)
+{
+    data[0] = static_cast<uint8_t>(value >> 24);
+    data[1] = static_cast<uint8_t>(value >> 16);
+    data[2] = static_cast<uint8_t>(value >> 8);
+    data[3] = static_cast<uint8_t>(value);
+}
+
+//! \brief S-box and the combined SubBytes + MixColumns tables, generated once on first use
+struct AESTables {
+    AESTables()
+    {
+        // Walks the multiplicative group with p and q = p^-1 to compute the S-box without a
+        // hardcoded table
+        uint8_t p = 1;
+        uint8_t q = 1;
+
+        do {
+            // Multiply p by 3 and divide q by 3
+            p = static_cast<uint8_t>(p ^ MultiplyBy2(p));
+
+            q ^= static_cast<uint8_t>(q << 1);
+            q ^= static_cast<uint8_t>(q << 2);
+            q ^= static_cast<uint8_t>(q << 4);
+
+            if(q & 0x80)
+                q ^= 0x09;
+
+            SBox[p] = static_cast<uint8_t>(q ^ RotateLeft8(q, 1) ^ RotateLeft8(q, 2) ^
+                                           RotateLeft8(q, 3) ^ RotateLeft8(q, 4) ^ 0x63);
+        } while(p != 1);
+
+        SBox[0] = 0x63;
+
+        for(int i = 0; i < 256; ++i) {
+            const uint8_t s = SBox[i];
+            const uint8_t s2 = MultiplyBy2(s);
+            const uint8_t s3 = s2 ^ s;
+
+            const uint32_t word = (static_cast<uint32_t>(s2) << 24) |
+                                  (static_cast<uint32_t>(s) << 16) |
+                                  (static_cast<uint32_t>(s) << 8) | s3;
+
+            Te0[i] = word;
+            Te1[i] = RotateRight32(word, 8);
+            Te2[i] = RotateRight32(word, 16);
+            Te3[i] = RotateRight32(word, 24);
+        }
+    }
+
+    uint8_t SBox[256];
+    uint32_t Te0[256];
+    uint32_t Te1[256];
+    uint32_t Te2[256];
+    uint32_t Te3[256];
+};
+
+const AESTables& GetTables()
+{
+    static const AESTables tables;
+    return tables;
+}
+
+uint32_t SubWord(uint32_t word)
+{
+    const auto& sBox = GetTables().SBox;
+
+    return (static_cast<uint32_t>(sBox[word >> 24]) << 24) |
+           (static_cast<uint32_t>(sBox[(word >> 16) & 0xff]) << 16) |
+           (static_cast<uint32_t>(sBox[(word >> 8) & 0xff]) << 8) | sBox[word & 0xff];
+}
+
+int HexValue(char character)
+{
+    if(character >= '0' && character <= '9')
+        return character - '0';
+
+    if(character >= 'a' && character <= 'f')
+        return character - 'a' + 10;
+
+    if(character >= 'A' && character <= 'F')
+        return character - 'A' + 10;
+
+    return -1;
+}
+
+#ifdef PCKTOOL_AES_INSTRUCTIONS
+PCKTOOL_TARGET_AES inline __m128i EncryptHardware(__m128i block, const __m128i* keys)
+{
+    block = _mm_xor_si128(block, keys[0]);
+
+    for(int round = 1; round < ROUNDS; ++round)
+        block = _mm_aesenc_si128(block, keys[round]);
+
+    return _mm_aesenclast_si128(block, keys[ROUNDS]);
+}
+
+PCKTOOL_TARGET_AES void LoadKeys(const uint8_t* roundKeys, __m128i* keys)
+{
+    const auto* source = reinterpret_cast<const __m128i*>(roundKeys);
+
+    for(int round = 0; round <= ROUNDS; ++round)
+        keys[round] = _mm_load_si128(source + round);
+}
+
+PCKTOOL_TARGET_AES void EncryptCFBHardware(
+    const uint8_t* roundKeys, uint8_t* data, size_t blocks, uint8_t* iv)
+{
+    __m128i keys[ROUNDS + 1];
+    LoadKeys(roundKeys, keys);
+
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+    // Each block depends on the previous ciphertext so this can't be parallelized
+    for(size_t i = 0; i < blocks; ++i) {
+        auto* block = reinterpret_cast<__m128i*>(data + i * AES_BLOCK_SIZE);
+
+        feedback = _mm_xor_si128(_mm_loadu_si128(block), EncryptHardware(feedback, keys));
+        _mm_storeu_si128(block, feedback);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), feedback);
+}
+
+PCKTOOL_TARGET_AES void DecryptCFBHardware(
+    const uint8_t* roundKeys, uint8_t* data, size_t blocks, uint8_t* iv)
+{
+    __m128i keys[ROUNDS + 1];
+    LoadKeys(roundKeys, keys);
+
+    __m128i feedback = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+    size_t i = 0;
+
+    // In decryption all the cipher inputs are known ciphertext blocks, so multiple blocks can
+    // be in flight in the AES unit at once
+    for(; i + PARALLEL_BLOCKS <= blocks; i += PARALLEL_BLOCKS) {
+        auto* block = reinterpret_cast<__m128i*>(data + i * AES_BLOCK_SIZE);
+
+        __m128i cipherText[PARALLEL_BLOCKS];
+        __m128i state[PARALLEL_BLOCKS];
+
+        for(size_t j = 0; j < PARALLEL_BLOCKS; ++j)
+            cipherText[j] = _mm_loadu_si128(block + j);
+
+        state[0] = _mm_xor_si128(feedback, keys[0]);
+
+        for(size_t j = 1; j < PARALLEL_BLOCKS; ++j)
+            state[j] = _mm_xor_si128(cipherText[j - 1], keys[0]);
+
+        for(int round = 1; round < ROUNDS; ++round) {
+            for(size_t j = 0; j < PARALLEL_BLOCKS; ++j)
+                state[j] = _mm_aesenc_si128(state[j], keys[round]);
+        }
+
+        for(size_t j = 0; j < PARALLEL_BLOCKS; ++j) {
+            state[j] = _mm_aesenclast_si128(state[j], keys[ROUNDS]);
+            _mm_storeu_si128(block + j, _mm_xor_si128(state[j], cipherText[j]));
+        }
+
+        feedback = cipherText[PARALLEL_BLOCKS - 1];
+    }
+
+    for(; i < blocks; ++i) {
+        auto* block = reinterpret_cast<__m128i*>(data + i * AES_BLOCK_SIZE);
+
+        const auto cipherText = _mm_loadu_si128(block);
+        _mm_storeu_si128(block, _mm_xor_si128(EncryptHardware(feedback, keys), cipherText));
+        feedback = cipherText;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), feedback);
+}
+#endif
+
+} // namespace
+
+// ------------------------------------ //
+bool pcktool::ParseEncryptionKey(const std::string& hex, EncryptionKey& key)
+{
+    if(hex.size() != key.size() * 2)
+        return false;
+
+    for(size_t i = 0; i < key.size(); ++i) {
+        const auto high = HexValue(hex[i * 2]);
+        const auto low = HexValue(hex[i * 2 + 1]);
+
+        if(high < 0 || low < 0)
+            return false;
+
+        key[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+
+    return true;
+}
+// ------------------------------------ //
+AESCipher::AESCipher(const EncryptionKey& key, bool allowHardware /*= true*/) :
+    Hardware(allowHardware && HasHardwareSupport())
+{
+    constexpr size_t keyWords = 8;
+    uint32_t roundConstant = 0x01;
+
+    for(size_t i = 0; i < keyWords; ++i)
+        RoundWords[i] = LoadBigEndian(key.data() + i * 4);
+
+    for(size_t i = keyWords; i < RoundWords.size(); ++i) {
+        uint32_t temp = RoundWords[i - 1];
+
+        if(i % keyWords == 0) {
+            temp = SubWord(RotateRight32(temp, 24)) ^ (roundConstant << 24);
+            roundConstant = MultiplyBy2(static_cast<uint8_t>(roundConstant));
+        } else if(i % keyWords == 4) {
+            temp = SubWord(temp);
+        }
+
+        RoundWords[i] = RoundWords[i - keyWords] ^ temp;
+    }
+
+    for(size_t i = 0; i < RoundWords.size(); ++i)
+        StoreBigEndian(RoundWords[i], RoundKeys.data() + i * 4);
+}
+// ------------------------------------ //
+void AESCipher::EncryptCFB(uint8_t* data, size_t length, IV& iv) const
+{
+#ifdef PCKTOOL_AES_INSTRUCTIONS
+    if(Hardware) {
+        EncryptCFBHardware(RoundKeys.data(), data, length / AES_BLOCK_SIZE, iv.data());
+        return;
+    }
+#endif
+
+    uint8_t keyStream[AES_BLOCK_SIZE];
+
+    for(size_t offset = 0; offset + AES_BLOCK_SIZE <= length; offset += AES_BLOCK_SIZE) {
+        EncryptBlock(iv.data(), keyStream);
+
+        for(size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+            data[offset + i] ^= keyStream[i];
+            iv[i] = data[offset + i];
+        }
+    }
+}
+
+void AESCipher::DecryptCFB(uint8_t* data, size_t length, IV& iv) const
+{
+#ifdef PCKTOOL_AES_INSTRUCTIONS
+    if(Hardware) {
+        DecryptCFBHardware(RoundKeys.data(), data, length / AES_BLOCK_SIZE, iv.data());
+        return;
+    }
+#endif
+
+    uint8_t keyStream[AES_BLOCK_SIZE];
+
+    for(size_t offset = 0; offset + AES_BLOCK_SIZE <= length; offset += AES_BLOCK_SIZE) {
+        EncryptBlock(iv.data(), keyStream);
+
+        // The ciphertext is the feedback for the next block
+        std::memcpy(iv.data(), data + offset, AES_BLOCK_SIZE);
+
+        for(size_t i = 0; i < AES_BLOCK_SIZE; ++i)
+            data[offset + i] ^= keyStream[i];
+    }
+}
+// ------------------------------------ //
+bool AESCipher::HasHardwareSupport()
+{
+#ifdef PCKTOOL_AES_INSTRUCTIONS
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    return (ecx & bit_AES) != 0;
+#endif
+#else
+    return false;
+#endif
+}
+// ------------------------------------ //
+void AESCipher::EncryptBlock(const uint8_t* input, uint8_t* output) const
+{
+    const auto& tables = GetTables();
+    const auto* keys = RoundWords.data();
+
+    uint32_t s0 = LoadBigEndian(input) ^ keys[0];
+    uint32_t s1 = LoadBigEndian(input + 4) ^ keys[1];
+    uint32_t s2 = LoadBigEndian(input + 8) ^ keys[2];
+    uint32_t s3 = LoadBigEndian(input + 12) ^ keys[3];
+
+    for(int round = 1; round < ROUNDS; ++round) {
+        keys += 4;
+
+        const uint32_t t0 = tables.Te0[s0 >> 24] ^ tables.Te1[(s1 >> 16) & 0xff] ^
+                            tables.Te2[(s2 >> 8) & 0xff] ^ tables.Te3[s3 & 0xff] ^ keys[0];
+        const uint32_t t1 = tables.Te0[s1 >> 24] ^ tables.Te1[(s2 >> 16) & 0xff] ^
+                            tables.Te2[(s3 >> 8) & 0xff] ^ tables.Te3[s0 & 0xff] ^ keys[1];
+        const uint32_t t2 = tables.Te0[s2 >> 24] ^ tables.Te1[(s3 >> 16) & 0xff] ^
+                            tables.Te2[(s0 >> 8) & 0xff] ^ tables.Te3[s1 & 0xff] ^ keys[2];
+        const uint32_t t3 = tables.Te0[s3 >> 24] ^ tables.Te1[(s0 >> 16) & 0xff] ^
+                            tables.Te2[(s1 >> 8) & 0xff] ^ tables.Te3[s2 & 0xff] ^ keys[3];
+
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // The last round has no MixColumns
+    keys += 4;
+    const auto& sBox = tables.SBox;
+
+    const auto lastRound = [&sBox](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        return (static_cast<uint32_t>(sBox[a >> 24]) << 24) |
+               (static_cast<uint32_t>(sBox[(b >> 16) & 0xff]) << 16) |
+               (static_cast<uint32_t>(sBox[(c >> 8) & 0xff]) << 8) | sBox[d & 0xff];
+    };
+
+    StoreBigEndian(lastRound(s0, s1, s2, s3) ^ keys[0], output);
+    StoreBigEndian(lastRound(s1, s2, s3, s0) ^ keys[1], output + 4);
+    StoreBigEndian(lastRound(s2, s3, s0, s1) ^ keys[2], output + 8);
+    StoreBigEndian(lastRound(s3, s0, s1, s2) ^ keys[3], output + 12);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Define.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pcktool {
+
+//! \brief Godot uses AES-256 so the key is always 32 bytes
+using EncryptionKey = std::array<uint8_t, 32>;
+
+//! \brief Size of the header in front of encrypted data: plaintext MD5, plaintext length and
+//! the IV
+constexpr uint64_t ENCRYPTED_HEADER_SIZE = 16 + 8 + 16;
+
+constexpr size_t AES_BLOCK_SIZE = 16;
+
+//! \brief Size of data once encrypted with the Godot FileAccessEncrypted format (the data is
+//! padded to the AES block size)
+constexpr uint64_t GetEncryptedSize(uint64_t plainSize)
+{
+    return ENCRYPTED_HEADER_SIZE +
+           (plainSize + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+}
+
+//! \brief Parses a key given as 64 hex characters (the format Godot uses)
+bool ParseEncryptionKey(const std::string& hex, EncryptionKey& key);
+
+//! \brief AES-256 in CFB mode with 128-bit feedback as used by Godot encrypted packs
+//!
+//! Uses the AES-NI instructions when the CPU has them, otherwise a table based software
+//! implementation. Data can be processed in chunks by passing the same IV array to the calls,
+//! it is updated to continue from where the previous chunk ended.
+class AESCipher {
+public:
+    using IV = std::array<uint8_t, AES_BLOCK_SIZE>;
+
+public:
+    explicit AESCipher(const EncryptionKey& key, bool allowHardware = true);
+
+    //! \brief Encrypts in place, length must be a multiple of AES_BLOCK_SIZE
+    void EncryptCFB(uint8_t* data, size_t length, IV& iv) const;
+
+    //! \brief Decrypts in place, length must be a multiple of AES_BLOCK_SIZE
+    void DecryptCFB(uint8_t* data, size_t length, IV& iv) const;
+
+    [[nodiscard]] bool UsesHardware() const
+    {
+        return Hardware;
+    }
+
+    //! \returns True if the CPU supports the AES-NI instructions
+    static bool HasHardwareSupport();
+
+private:
+    void EncryptBlock(const uint8_t* input, uint8_t* output) const;
+
+private:
+    //! Expanded key schedule as words for the software implementation
+    std::array<uint32_t, 60> RoundWords;
+
+    //! The same schedule as bytes for the AES instructions
+    alignas(16) std::array<uint8_t, 240> RoundKeys;
+
+    bool Hardware = false;
+};
+
+} // namespace pcktool
@@ -0,0 +1,216 @@
+// ------------------------------------ //
+#include "ExtractJournal.h"
+
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "md5.h"
+
+using namespace pcktool;
+
+//! Pending records are written after this many files or bytes have been extracted. Bigger
+//! batches mean fewer syncs but more work to redo after an interruption.
+constexpr size_t JOURNAL_BATCH_FILES = 256;
+constexpr uint64_t JOURNAL_BATCH_BYTES = 64 * 1024 * 1024;
+
+constexpr auto JOURNAL_HEADER = "# GodotPckTool extract journal 1\n";
+// ------------------------------------ //
+ExtractJournal::ExtractJournal(std::string path, std::string outputFolder) :
+    Path(std::move(path)), OutputFolder(std::move(outputFolder))
+{}
+// ------------------------------------ //
+bool ExtractJournal::Open()
+{
+    if(!Load())
+        return false;
+
+    const bool existed = std::filesystem::exists(Path);
+
+    if(!Writer.OpenForAppend(Path)) {
+        std::cout << "ERROR: opening the extract journal for writing: " << Path << "\n";
+        return false;
+    }
+
+    std::string start;
+
+    if(!existed) {
+        start = JOURNAL_HEADER;
+    } else if(PartialLastLine) {
+        // End the cut off line so that it doesn't merge with the next record
+        start = "\n";
+    }
+
+    if(!start.empty() && (!Writer.Write(start.data(), start.size()) || !Writer.Sync())) {
+        std::cout << "ERROR: writing to the extract journal failed: " << Path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool ExtractJournal::Load()
+{
+    Completed.clear();
+    PartialLastLine = false;
+
+    std::ifstream reader(Path, std::ios::in | std::ios::binary);
+
+    // No journal is fine, that means nothing has been extracted yet
+    if(!reader.good())
+        return true;
+
+    std::string line;
+
+    while(std::getline(reader, line)) {
+        // Only a line without the newline sets eof, it wasn't fully written
+        if(reader.eof()) {
+            PartialLastLine = true;
+            break;
+        }
+
+        if(line.empty() || line.front() == '#')
+            continue;
+
+        const auto sizeStart = line.find(' ');
+        const auto pathStart =
+            sizeStart == std::string::npos ? sizeStart : line.find(' ', sizeStart + 1);
+
+        if(pathStart == std::string::npos || sizeStart != MD5_SIZE * 2) {
+            std::cout << "WARNING: ignoring invalid line in the extract journal: " << line
+                      << "\n";
+            continue;
+        }
+
+        Record record;
+        record.MD5 = line.substr(0, sizeStart);
+
+        try {
+            record.Size = std::stoull(line.substr(sizeStart + 1, pathStart - sizeStart - 1));
+        } catch(const std::exception&) {
+            std::cout << "WARNING: ignoring invalid line in the extract journal: " << line
+                      << "\n";
+            continue;
+        }
+
+        Completed.insert_or_assign(line.substr(pathStart + 1), std::move(record));
+    }
+
+    if(reader.bad()) {
+        std::cout << "ERROR: reading the extract journal failed: " << Path << "\n";
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool ExtractJournal::IsComplete(
+    const PckFile::ContainedFile& entry, const std::filesystem::path& target) const
+{
+    const auto found = Completed.find(entry.Path);
+
+    // The pck may have changed since the earlier run
+    if(found == Completed.end() || found->second.Size != entry.Size ||
+        found->second.MD5 != FormatMD5(entry))
+        return false;
+
+    std::error_code error;
+    const auto size = std::filesystem::file_size(target, error);
+
+    return !error && size == entry.Size;
+}
+
+bool ExtractJournal::RecordComplete(const PckFile::ContainedFile& entry)
+{
+    bool flush;
+
+    {
+        std::lock_guard<std::mutex> lock(PendingLock);
+
+        Pending += FormatMD5(entry);
+        Pending += ' ';
+        Pending += std::to_string(entry.Size);
+        Pending += ' ';
+        Pending += entry.Path;
+        Pending += '\n';
+
+        ++PendingCount;
+        PendingBytes += entry.Size;
+
+        flush = PendingCount >= JOURNAL_BATCH_FILES || PendingBytes >= JOURNAL_BATCH_BYTES;
+    }
+
+    if(!flush)
+        return true;
+
+    return Flush();
+}
+
+bool ExtractJournal::Flush()
+{
+    std::lock_guard<std::mutex> writeLock(WriteLock);
+
+    std::string batch;
+
+    {
+        std::lock_guard<std::mutex> lock(PendingLock);
+        batch.swap(Pending);
+        PendingCount = 0;
+        PendingBytes = 0;
+    }
+
+    if(batch.empty())
+        return true;
+
+    // The files need to be on disk before the records claiming they are complete. The output
+    // folder may be a different mount than the journal, so its own filesystem is synced (on
+    // platforms that can't sync a filesystem the extraction syncs each file before recording
+    // it).
+    if(!WritableFile::SyncFilesystemOf(OutputFolder) ||
+        !Writer.Write(batch.data(), batch.size()) || !Writer.Sync()) {
+        std::cout << "ERROR: writing to the extract journal failed: " << Path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool ExtractJournal::Remove()
+{
+    {
+        std::lock_guard<std::mutex> lock(PendingLock);
+        Pending.clear();
+        PendingCount = 0;
+        PendingBytes = 0;
+    }
+
+    Writer.Close();
+
+    std::error_code error;
+    std::filesystem::remove(Path, error);
+
+    if(error) {
+        std::cout << "ERROR: removing the extract journal failed: " << Path << "\n";
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+std::string ExtractJournal::PathFor(const std::string& outputPrefix)
+{
+    auto output = std::filesystem::absolute(outputPrefix).lexically_normal();
+
+    // A trailing separator leaves an empty file name
+    if(!output.has_filename())
+        output = output.parent_path();
+
+    return (output.parent_path() / (output.filename().string() + ".extract-journal")).string();
+}
+
+std::string ExtractJournal::FormatMD5(const PckFile::ContainedFile& entry)
+{
+    char buffer[MD5_STRING_SIZE];
+    md5::sig_to_string(entry.MD5.data(), buffer, MD5_STRING_SIZE);
+    return buffer;
+}
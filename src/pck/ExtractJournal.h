@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+#include "PlatformFile.h"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Records which files an extraction has completed so that an interrupted extraction
+//! can be resumed
+//!
+//! The journal is a text file with a line per completed file: the MD5 and size from the pck
+//! directory followed by the pck path. Records are written in batches and only after the
+//! extracted data has been synced to disk, so a record never claims a file that could be lost
+//! in a crash. A partially written last line is ignored when loading.
+class ExtractJournal {
+public:
+    //! \param path Where the journal is kept, see PathFor
+    //! \param outputFolder The folder files are extracted to, synced before writing records
+    ExtractJournal(std::string path, std::string outputFolder);
+
+    ExtractJournal(ExtractJournal&& other) = delete;
+    ExtractJournal(const ExtractJournal& other) = delete;
+
+    ExtractJournal& operator=(ExtractJournal&& other) = delete;
+    ExtractJournal& operator=(const ExtractJournal& other) = delete;
+
+    //! \brief Loads the records of an earlier run (if there was one) and opens the journal for
+    //! adding new records
+    bool Open();
+
+    //! \returns True if an earlier run completed the entry and the target still has the right
+    //! size
+    [[nodiscard]] bool IsComplete(
+        const PckFile::ContainedFile& entry, const std::filesystem::path& target) const;
+
+    //! \brief Adds a record for a fully written file, can be called from multiple threads
+    //! \returns False if writing a batch of records failed
+    bool RecordComplete(const PckFile::ContainedFile& entry);
+
+    //! \brief Syncs the extracted files and writes all the pending records
+    bool Flush();
+
+    //! \brief Closes and deletes the journal, for when the extraction has finished
+    bool Remove();
+
+    [[nodiscard]] size_t GetLoadedCount() const
+    {
+        return Completed.size();
+    }
+
+    [[nodiscard]] const std::string& GetPath() const
+    {
+        return Path;
+    }
+
+    //! \returns The journal path used for extracting to outputPrefix
+    static std::string PathFor(const std::string& outputPrefix);
+
+private:
+    struct Record {
+        uint64_t Size;
+        std::string MD5;
+    };
+
+    bool Load();
+
+    static std::string FormatMD5(const PckFile::ContainedFile& entry);
+
+private:
+    const std::string Path;
+
+    //! The journal is next to the output folder, which can be on a different filesystem
+    const std::string OutputFolder;
+
+    //! Records from earlier runs, only read after Open
+    std::unordered_map<std::string, Record> Completed;
+
+    std::mutex PendingLock;
+    std::string Pending;
+    size_t PendingCount = 0;
+    uint64_t PendingBytes = 0;
+
+    //! Held while syncing and writing so that batches are written whole and in order
+    std::mutex WriteLock;
+    WritableFile Writer;
+
+    //! Set when the last line of the journal was cut off by an interruption
+    bool PartialLastLine = false;
+};
+
+} // namespace pcktool
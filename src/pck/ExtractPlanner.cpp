@@ -0,0 +1,74 @@
+// ------------------------------------ //
+#include "ExtractPlanner.h"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <utility>
+
+using namespace pcktool;
+// ------------------------------------ //
+ExtractPlanner::ExtractPlanner(std::filesystem::path outputBase) :
+    OutputBase(std::move(outputBase))
+{}
+// ------------------------------------ //
+void ExtractPlanner::Add(const PckFile::ContainedFile& entry)
+{
+    Items.push_back({&entry, OutputBase / std::filesystem::path(ToRelativePath(entry.Path))});
+}
+
+bool ExtractPlanner::CreateDirectories()
+{
+    std::set<std::string> folders;
+
+    for(const auto& item : Items) {
+        auto folder = item.Target.parent_path();
+
+        if(!folder.empty())
+            folders.insert(folder.string());
+    }
+
+    const auto isInside = [](const std::string& parent, const std::string& child) {
+        return child.size() > parent.size() && child.compare(0, parent.size(), parent) == 0 &&
+               (child[parent.size()] == '/' || child[parent.size()] == '\\');
+    };
+
+    // As create_directories creates all parents, only the deepest folders need to be created.
+    // In sorted order a folder's subfolders come right after it
+    for(auto iter = folders.begin(); iter != folders.end(); ++iter) {
+        const auto next = std::next(iter);
+
+        if(next != folders.end() && isInside(*iter, *next))
+            continue;
+
+        try {
+            std::filesystem::create_directories(*iter);
+        } catch(const std::filesystem::filesystem_error& e) {
+            std::cout << "ERROR: creating target directory (" << *iter << "): " << e.what()
+                      << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ExtractPlanner::SortByOffset()
+{
+    std::stable_sort(Items.begin(), Items.end(), [](const Item& first, const Item& second) {
+        return first.Entry->Offset < second.Entry->Offset;
+    });
+}
+// ------------------------------------ //
+std::string ExtractPlanner::ToRelativePath(const std::string& pckPath)
+{
+    std::string processedPath = pckPath.find(GODOT_RES_PATH) == 0 ?
+                                    pckPath.substr(std::string_view(GODOT_RES_PATH).size()) :
+                                    pckPath;
+
+    // Remove any starting slashes
+    while(processedPath.size() > 0 && processedPath.front() == '/')
+        processedPath.erase(processedPath.begin());
+
+    return processedPath;
+}
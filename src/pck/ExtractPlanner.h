@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Plans the order and target locations for extracting pck entries
+//!
+//! The plan creates each needed directory only once and orders the entries by their position
+//! in the pck so that the pck is read sequentially.
+class ExtractPlanner {
+public:
+    struct Item {
+        const PckFile::ContainedFile* Entry;
+        std::filesystem::path Target;
+    };
+
+public:
+    explicit ExtractPlanner(std::filesystem::path outputBase);
+
+    void Add(const PckFile::ContainedFile& entry);
+
+    //! \brief Creates all the directories the planned files need
+    bool CreateDirectories();
+
+    //! \brief Sorts the items in ascending pck offset order
+    void SortByOffset();
+
+    [[nodiscard]] const std::vector<Item>& GetItems() const
+    {
+        return Items;
+    }
+
+    //! \brief Converts a path inside a pck to a relative filesystem path
+    static std::string ToRelativePath(const std::string& pckPath);
+
+private:
+    std::filesystem::path OutputBase;
+
+    std::vector<Item> Items;
+};
+
+} // namespace pcktool
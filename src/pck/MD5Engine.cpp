@@ -0,0 +1,399 @@
+// ------------------------------------ //
+#include "MD5Engine.h"
+
+#include <cstring>
+#include <initializer_list>
+
+// The SIMD versions use the GCC vector extensions, which compile to the instruction set of
+// the function they are used in
+#if(defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PCKTOOL_MD5_SIMD
+#define PCKTOOL_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define PCKTOOL_ALWAYS_INLINE inline
+#endif
+
+using namespace pcktool;
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+constexpr uint32_t INITIAL_STATE[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+//! \brief Provides the 64 byte blocks of one piece of data, including the MD5 padding
+class BlockCursor {
+public:
+    void Start(const MD5Engine::Job& job)
+    {
+        Data = reinterpret_cast<const uint8_t*>(job.Data);
+        FullBlocks = job.Size / BLOCK_SIZE;
+        Block = 0;
+
+        const auto tailBytes = static_cast<size_t>(job.Size % BLOCK_SIZE);
+
+        // The padding is a 1 bit, zeros and the length in bits, which needs an extra block if
+        // there is no room for it after the data
+        const size_t tailBlocks = tailBytes + 1 + 8 <= BLOCK_SIZE ? 1 : 2;
+        TotalBlocks = FullBlocks + tailBlocks;
+
+        std::memset(Tail, 0, tailBlocks * BLOCK_SIZE);
+        std::memcpy(Tail, Data + FullBlocks * BLOCK_SIZE, tailBytes);
+        Tail[tailBytes] = 0x80;
+
+        const uint64_t bits = job.Size * 8;
+        std::memcpy(Tail + tailBlocks * BLOCK_SIZE - 8, &bits, 8);
+    }
+
+    //! \returns The next block, must not be called when finished
+    const uint8_t* Next()
+    {
+        const auto block = Block++;
+
+        if(block < FullBlocks)
+            return Data + block * BLOCK_SIZE;
+
+        return Tail + (block - FullBlocks) * BLOCK_SIZE;
+    }
+
+    [[nodiscard]] bool IsFinished() const
+    {
+        return Block == TotalBlocks;
+    }
+
+private:
+    const uint8_t* Data = nullptr;
+    uint64_t FullBlocks = 0;
+    uint64_t TotalBlocks = 0;
+    uint64_t Block = 0;
+
+    uint8_t Tail[BLOCK_SIZE * 2];
+};
+
+//! Data for lanes that have nothing to do
+const uint8_t IDLE_BLOCK[BLOCK_SIZE] = {};
+
+// The MD5 round functions (in forms that need fewer operations than in RFC 1321)
+#define MD5_F(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define MD5_G(b, c, d) ((c) ^ ((d) & ((b) ^ (c))))
+#define MD5_H(b, c, d) ((b) ^ (c) ^ (d))
+#define MD5_I(b, c, d) ((c) ^ ((b) | ~(d)))
+
+#define MD5_STEP(function, a, b, c, d, word, constant, shift) \
+    a += function(b, c, d) + words[word] + (constant);       \
+    a = ((a << (shift)) | (a >> (32 - (shift)))) + (b)
+
+//! \brief Runs the MD5 compression function on a block for each lane
+//!
+//! Vector is either uint32_t for a single lane or a vector extension type with Lanes values.
+template<typename Vector, size_t Lanes>
+PCKTOOL_ALWAYS_INLINE void CompressBlocks(
+    uint32_t (&state)[4][Lanes], const uint8_t* const (&blocks)[Lanes])
+{
+    static_assert(sizeof(Vector) == Lanes * sizeof(uint32_t), "vector size must match lanes");
+
+    // Transpose so that each vector has the same word from every block
+    Vector words[16];
+
+    for(size_t i = 0; i < 16; ++i) {
+        alignas(sizeof(Vector)) uint32_t gathered[Lanes];
+
+        for(size_t lane = 0; lane < Lanes; ++lane)
+            std::memcpy(&gathered[lane], blocks[lane] + i * 4, 4);
+
+        std::memcpy(&words[i], gathered, sizeof(Vector));
+    }
+
+    Vector a, b, c, d;
+    std::memcpy(&a, state[0], sizeof(Vector));
+    std::memcpy(&b, state[1], sizeof(Vector));
+    std::memcpy(&c, state[2], sizeof(Vector));
+    std::memcpy(&d, state[3], sizeof(Vector));
+
+    const Vector startA = a;
+    const Vector startB = b;
+    const Vector startC = c;
+    const Vector startD = d;
+
+    MD5_STEP(MD5_F, a, b, c, d, 0, 0xd76aa478, 7);
+    MD5_STEP(MD5_F, d, a, b, c, 1, 0xe8c7b756, 12);
+    MD5_STEP(MD5_F, c, d, a, b, 2, 0x242070db, 17);
+    MD5_STEP(MD5_F, b, c, d, a, 3, 0xc1bdceee, 22);
+    MD5_STEP(MD5_F, a, b, c, d, 4, 0xf57c0faf, 7);
+    MD5_STEP(MD5_F, d, a, b, c, 5, 0x4787c62a, 12);
+    MD5_STEP(MD5_F, c, d, a, b, 6, 0xa8304613, 17);
+    MD5_STEP(MD5_F, b, c, d, a, 7, 0xfd469501, 22);
+    MD5_STEP(MD5_F, a, b, c, d, 8, 0x698098d8, 7);
+    MD5_STEP(MD5_F, d, a, b, c, 9, 0x8b44f7af, 12);
+    MD5_STEP(MD5_F, c, d, a, b, 10, 0xffff5bb1, 17);
+    MD5_STEP(MD5_F, b, c, d, a, 11, 0x895cd7be, 22);
+    MD5_STEP(MD5_F, a, b, c, d, 12, 0x6b901122, 7);
+    MD5_STEP(MD5_F, d, a, b, c, 13, 0xfd987193, 12);
+    MD5_STEP(MD5_F, c, d, a, b, 14, 0xa679438e, 17);
+    MD5_STEP(MD5_F, b, c, d, a, 15, 0x49b40821, 22);
+
+    MD5_STEP(MD5_G, a, b, c, d, 1, 0xf61e2562, 5);
+    MD5_STEP(MD5_G, d, a, b, c, 6, 0xc040b340, 9);
+    MD5_STEP(MD5_G, c, d, a, b, 11, 0x265e5a51, 14);
+    MD5_STEP(MD5_G, b, c, d, a, 0, 0xe9b6c7aa, 20);
+    MD5_STEP(MD5_G, a, b, c, d, 5, 0xd62f105d, 5);
+    MD5_STEP(MD5_G, d, a, b, c, 10, 0x02441453, 9);
+    MD5_STEP(MD5_G, c, d, a, b, 15, 0xd8a1e681, 14);
+    MD5_STEP(MD5_G, b, c, d, a, 4, 0xe7d3fbc8, 20);
+    MD5_STEP(MD5_G, a, b, c, d, 9, 0x21e1cde6, 5);
+    MD5_STEP(MD5_G, d, a, b, c, 14, 0xc33707d6, 9);
+    MD5_STEP(MD5_G, c, d, a, b, 3, 0xf4d50d87, 14);
+    MD5_STEP(MD5_G, b, c, d, a, 8, 0x455a14ed, 20);
+    MD5_STEP(MD5_G, a, b, c, d, 13, 0xa9e3e905, 5);
+    MD5_STEP(MD5_G, d, a, b, c, 2, 0xfcefa3f8, 9);
+    MD5_STEP(MD5_G, c, d, a, b, 7, 0x676f02d9, 14);
+    MD5_STEP(MD5_G, b, c, d, a, 12, 0x8d2a4c8a, 20);
+
+    MD5_STEP(MD5_H, a, b, c, d, 5, 0xfffa3942, 4);
+    MD5_STEP(MD5_H, d, a, b, c, 8, 0x8771f681, 11);
+    MD5_STEP(MD5_H, c, d, a, b, 11, 0x6d9d6122, 16);
+    MD5_STEP(MD5_H, b, c, d, a, 14, 0xfde5380c, 23);
+    MD5_STEP(MD5_H, a, b, c, d, 1, 0xa4beea44, 4);
+    MD5_STEP(MD5_H, d, a, b, c, 4, 0x4bdecfa9, 11);
+    MD5_STEP(MD5_H, c, d, a, b, 7, 0xf6bb4b60, 16);
+    MD5_STEP(MD5_H, b, c, d, a, 10, 0xbebfbc70, 23);
+    MD5_STEP(MD5_H, a, b, c, d, 13, 0x289b7ec6, 4);
+    MD5_STEP(MD5_H, d, a, b, c, 0, 0xeaa127fa, 11);
+    MD5_STEP(MD5_H, c, d, a, b, 3, 0xd4ef3085, 16);
+    MD5_STEP(MD5_H, b, c, d, a, 6, 0x04881d05, 23);
+    MD5_STEP(MD5_H, a, b, c, d, 9, 0xd9d4d039, 4);
+    MD5_STEP(MD5_H, d, a, b, c, 12, 0xe6db99e5, 11);
+    MD5_STEP(MD5_H, c, d, a, b, 15, 0x1fa27cf8, 16);
+    MD5_STEP(MD5_H, b, c, d, a, 2, 0xc4ac5665, 23);
+
+    MD5_STEP(MD5_I, a, b, c, d, 0, 0xf4292244, 6);
+    MD5_STEP(MD5_I, d, a, b, c, 7, 0x432aff97, 10);
+    MD5_STEP(MD5_I, c, d, a, b, 14, 0xab9423a7, 15);
+    MD5_STEP(MD5_I, b, c, d, a, 5, 0xfc93a039, 21);
+    MD5_STEP(MD5_I, a, b, c, d, 12, 0x655b59c3, 6);
+    MD5_STEP(MD5_I, d, a, b, c, 3, 0x8f0ccc92, 10);
+    MD5_STEP(MD5_I, c, d, a, b, 10, 0xffeff47d, 15);
+    MD5_STEP(MD5_I, b, c, d, a, 1, 0x85845dd1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, 8, 0x6fa87e4f, 6);
+    MD5_STEP(MD5_I, d, a, b, c, 15, 0xfe2ce6e0, 10);
+    MD5_STEP(MD5_I, c, d, a, b, 6, 0xa3014314, 15);
+    MD5_STEP(MD5_I, b, c, d, a, 13, 0x4e0811a1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, 4, 0xf7537e82, 6);
+    MD5_STEP(MD5_I, d, a, b, c, 11, 0xbd3af235, 10);
+    MD5_STEP(MD5_I, c, d, a, b, 2, 0x2ad7d2bb, 15);
+    MD5_STEP(MD5_I, b, c, d, a, 9, 0xeb86d391, 21);
+
+    a += startA;
+    b += startB;
+    c += startC;
+    d += startD;
+
+    std::memcpy(state[0], &a, sizeof(Vector));
+    std::memcpy(state[1], &b, sizeof(Vector));
+    std::memcpy(state[2], &c, sizeof(Vector));
+    std::memcpy(state[3], &d, sizeof(Vector));
+}
+
+#undef MD5_STEP
+#undef MD5_F
+#undef MD5_G
+#undef MD5_H
+#undef MD5_I
+
+template<size_t Lanes>
+PCKTOOL_ALWAYS_INLINE void StartLane(uint32_t (&state)[4][Lanes], size_t lane)
+{
+    for(size_t i = 0; i < 4; ++i)
+        state[i][lane] = INITIAL_STATE[i];
+}
+
+template<size_t Lanes>
+PCKTOOL_ALWAYS_INLINE void FinishLane(
+    const uint32_t (&state)[4][Lanes], size_t lane, uint8_t* result)
+{
+    // MD5 outputs the state as little endian words
+    for(size_t i = 0; i < 4; ++i)
+        std::memcpy(result + i * 4, &state[i][lane], 4);
+}
+
+//! \brief Hashes the jobs Lanes at a time, each lane takes the next job once it is done
+template<typename Vector, size_t Lanes>
+PCKTOOL_ALWAYS_INLINE void HashLanes(const MD5Engine::Job* jobs, size_t count)
+{
+    alignas(64) uint32_t state[4][Lanes];
+    const uint8_t* blocks[Lanes];
+
+    BlockCursor cursors[Lanes];
+    const MD5Engine::Job* laneJobs[Lanes];
+
+    size_t nextJob = 0;
+    size_t active = 0;
+
+    for(size_t lane = 0; lane < Lanes; ++lane) {
+        if(nextJob < count) {
+            laneJobs[lane] = &jobs[nextJob++];
+            cursors[lane].Start(*laneJobs[lane]);
+            StartLane(state, lane);
+            ++active;
+        } else {
+            laneJobs[lane] = nullptr;
+        }
+    }
+
+    while(active > 0) {
+        // With only one job left the other lanes would be wasted work, so the scalar code
+        // finishes it
+        if(Lanes > 1 && active == 1 && nextJob == count) {
+            size_t lane = 0;
+
+            while(laneJobs[lane] == nullptr)
+                ++lane;
+
+            uint32_t single[4][1];
+
+            for(size_t i = 0; i < 4; ++i)
+                single[i][0] = state[i][lane];
+
+            auto& cursor = cursors[lane];
+
+            while(!cursor.IsFinished()) {
+                const uint8_t* block[1] = {cursor.Next()};
+                CompressBlocks<uint32_t, 1>(single, block);
+            }
+
+            FinishLane(single, 0, laneJobs[lane]->Result);
+            return;
+        }
+
+        for(size_t lane = 0; lane < Lanes; ++lane)
+            blocks[lane] = laneJobs[lane] != nullptr ? cursors[lane].Next() : IDLE_BLOCK;
+
+        CompressBlocks<Vector, Lanes>(state, blocks);
+
+        for(size_t lane = 0; lane < Lanes; ++lane) {
+            if(laneJobs[lane] == nullptr || !cursors[lane].IsFinished())
+                continue;
+
+            FinishLane(state, lane, laneJobs[lane]->Result);
+
+            if(nextJob < count) {
+                laneJobs[lane] = &jobs[nextJob++];
+                cursors[lane].Start(*laneJobs[lane]);
+                StartLane(state, lane);
+            } else {
+                laneJobs[lane] = nullptr;
+                --active;
+            }
+        }
+    }
+}
+
+void HashScalar(const MD5Engine::Job* jobs, size_t count)
+{
+    HashLanes<uint32_t, 1>(jobs, count);
+}
+
+#ifdef PCKTOOL_MD5_SIMD
+// Each version uses vectors twice the register size, which the compiler splits into two
+// registers. The two independent halves hide the latency of the MD5 steps that each depend
+// on the previous one.
+using Vector8 = uint32_t __attribute__((vector_size(32)));
+using Vector16 = uint32_t __attribute__((vector_size(64)));
+using Vector32 = uint32_t __attribute__((vector_size(128)));
+
+__attribute__((target("sse2"))) void HashSSE2(const MD5Engine::Job* jobs, size_t count)
+{
+    HashLanes<Vector8, 8>(jobs, count);
+}
+
+__attribute__((target("avx2"))) void HashAVX2(const MD5Engine::Job* jobs, size_t count)
+{
+    HashLanes<Vector16, 16>(jobs, count);
+}
+
+__attribute__((target("avx512f"))) void HashAVX512(const MD5Engine::Job* jobs, size_t count)
+{
+    HashLanes<Vector32, 32>(jobs, count);
+}
+#endif
+
+} // namespace
+// ------------------------------------ //
+MD5Engine::MD5Engine() : Used(GetBestImplementation()) {}
+
+MD5Engine::MD5Engine(Implementation implementation) : Used(implementation)
+{
+    if(!IsSupported(implementation))
+        Used = Implementation::Scalar;
+}
+// ------------------------------------ //
+void MD5Engine::Hash(const Job* jobs, size_t count) const
+{
+    switch(Used) {
+#ifdef PCKTOOL_MD5_SIMD
+        case Implementation::SSE2: HashSSE2(jobs, count); return;
+        case Implementation::AVX2: HashAVX2(jobs, count); return;
+        case Implementation::AVX512: HashAVX512(jobs, count); return;
+#endif
+        default: HashScalar(jobs, count); return;
+    }
+}
+
+size_t MD5Engine::GetLanes() const
+{
+    switch(Used) {
+        case Implementation::SSE2: return 8;
+        case Implementation::AVX2: return 16;
+        case Implementation::AVX512: return 32;
+        case Implementation::Scalar: break;
+    }
+
+    return 1;
+}
+// ------------------------------------ //
+bool MD5Engine::IsSupported(Implementation implementation)
+{
+    switch(implementation) {
+        case Implementation::Scalar: return true;
+#ifdef PCKTOOL_MD5_SIMD
+        case Implementation::SSE2: return __builtin_cpu_supports("sse2");
+        case Implementation::AVX2: return __builtin_cpu_supports("avx2");
+        case Implementation::AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+        default: return false;
+    }
+}
+
+MD5Engine::Implementation MD5Engine::GetBestImplementation()
+{
+    // AVX-512 measured slower than AVX2 in md5benchmark, so it needs to be enabled when building
+#ifdef PCKTOOL_MD5_PREFER_AVX512
+    constexpr Implementation preferred[] = {
+        Implementation::AVX512, Implementation::AVX2, Implementation::SSE2};
+#else
+    constexpr Implementation preferred[] = {Implementation::AVX2, Implementation::SSE2};
+#endif
+
+    static const Implementation best = [&]() {
+        for(const auto implementation : preferred) {
+            if(IsSupported(implementation))
+                return implementation;
+        }
+
+        return Implementation::Scalar;
+    }();
+
+    return best;
+}
+
+const char* MD5Engine::GetName(Implementation implementation)
+{
+    switch(implementation) {
+        case Implementation::Scalar: return "scalar";
+        case Implementation::SSE2: return "SSE2";
+        case Implementation::AVX2: return "AVX2";
+        case Implementation::AVX512: return "AVX-512";
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Define.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pcktool {
+
+//! \brief Calculates the MD5 hashes of many independent pieces of data at once
+//!
+//! A single MD5 can't be parallelized, so instead each lane of the SIMD registers works on a
+//! different piece of data. A new piece is started in a lane as soon as the previous one
+//! finishes, which keeps the lanes busy with files of different sizes. The best instruction
+//! set the CPU supports is picked at runtime. The results are identical to the md5 library.
+class MD5Engine {
+public:
+    struct Job {
+        const char* Data;
+        uint64_t Size;
+
+        //! Receives the 16 byte hash
+        uint8_t* Result;
+    };
+
+    enum class Implementation { Scalar, SSE2, AVX2, AVX512 };
+
+public:
+    //! \brief Uses the fastest implementation the CPU supports, see GetBestImplementation
+    MD5Engine();
+
+    //! \brief Uses a specific implementation, which must be supported
+    explicit MD5Engine(Implementation implementation);
+
+    //! \brief Hashes all the jobs, can be called from multiple threads at once
+    void Hash(const Job* jobs, size_t count) const;
+
+    [[nodiscard]] Implementation GetImplementation() const
+    {
+        return Used;
+    }
+
+    //! \returns How many jobs are processed at once
+    [[nodiscard]] size_t GetLanes() const;
+
+    static bool IsSupported(Implementation implementation);
+
+    //! \returns AVX2 or the best older instruction set the CPU supports. AVX-512 is only
+    //! preferred when built with the GODOT_PCK_TOOL_MD5_AVX512 cmake option
+    static Implementation GetBestImplementation();
+
+    static const char* GetName(Implementation implementation);
+
+private:
+    Implementation Used;
+};
+
+} // namespace pcktool
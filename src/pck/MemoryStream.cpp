@@ -0,0 +1,135 @@
+// ------------------------------------ //
+#include "MemoryStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace pcktool;
+// ------------------------------------ //
+// MemoryStreamBuffer
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size) :
+    View(data), ViewSize(size)
+{}
+
+MemoryStreamBuffer::MemoryStreamBuffer(size_t reserve) : Writable(true)
+{
+    Data.reserve(reserve);
+}
+
+std::string MemoryStreamBuffer::TakeData()
+{
+    Position = 0;
+    return std::move(Data);
+}
+// ------------------------------------ //
+std::streamsize MemoryStreamBuffer::xsgetn(char* buffer, std::streamsize count)
+{
+    const auto size = GetSize();
+
+    if(count <= 0 || Position >= size)
+        return 0;
+
+    const auto amount = std::min(static_cast<size_t>(count), size - Position);
+    std::memcpy(buffer, GetData() + Position, amount);
+    Position += amount;
+
+    return static_cast<std::streamsize>(amount);
+}
+
+MemoryStreamBuffer::int_type MemoryStreamBuffer::underflow()
+{
+    if(Position >= GetSize())
+        return traits_type::eof();
+
+    return traits_type::to_int_type(GetData()[Position]);
+}
+
+MemoryStreamBuffer::int_type MemoryStreamBuffer::uflow()
+{
+    const auto character = underflow();
+
+    if(!traits_type::eq_int_type(character, traits_type::eof()))
+        ++Position;
+
+    return character;
+}
+
+std::streamsize MemoryStreamBuffer::showmanyc()
+{
+    const auto size = GetSize();
+    return Position < size ? static_cast<std::streamsize>(size - Position) : -1;
+}
+// ------------------------------------ //
+std::streamsize MemoryStreamBuffer::xsputn(const char* data, std::streamsize count)
+{
+    if(!Writable || count <= 0)
+        return 0;
+
+    const auto amount = static_cast<size_t>(count);
+
+    // Writing at the end is the common case when saving, only the header and the directory
+    // are written again over earlier data
+    if(Position == Data.size()) {
+        Data.append(data, amount);
+    } else {
+        if(Position + amount > Data.size())
+            Data.resize(Position + amount);
+
+        std::memcpy(Data.data() + Position, data, amount);
+    }
+
+    Position += amount;
+    return count;
+}
+
+MemoryStreamBuffer::int_type MemoryStreamBuffer::overflow(int_type character)
+{
+    if(traits_type::eq_int_type(character, traits_type::eof()))
+        return traits_type::not_eof(character);
+
+    const char value = traits_type::to_char_type(character);
+
+    return xsputn(&value, 1) == 1 ? character : traits_type::eof();
+}
+// ------------------------------------ //
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(
+    off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+    (void)which;
+
+    off_type base = 0;
+
+    if(direction == std::ios_base::cur) {
+        base = static_cast<off_type>(Position);
+    } else if(direction == std::ios_base::end) {
+        base = static_cast<off_type>(GetSize());
+    }
+
+    const auto target = base + offset;
+
+    // Seeking past the end is allowed when writing, the gap is filled with zeros
+    if(target < 0 || (!Writable && static_cast<size_t>(target) > ViewSize))
+        return pos_type(off_type(-1));
+
+    Position = static_cast<size_t>(target);
+    return pos_type(target);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(
+    pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+// ------------------------------------ //
+// MemoryStream
+MemoryStream::MemoryStream(const char* data, size_t size) :
+    std::iostream(nullptr), Buffer(data, size)
+{
+    // The buffer is only set once it is constructed
+    rdbuf(&Buffer);
+}
+
+MemoryStream::MemoryStream(size_t reserve) : std::iostream(nullptr), Buffer(reserve)
+{
+    rdbuf(&Buffer);
+}
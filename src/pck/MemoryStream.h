@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Define.h"
+
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+namespace pcktool {
+
+//! \brief Stream buffer over memory with a single read and write position like a file has
+//!
+//! Reads either from a buffer it doesn't own or from the data written to it. Writing past the
+//! end grows the data, so a seek back can be used to fill in data written earlier.
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    //! \brief Reads from data that must stay alive and unchanged while this is used
+    MemoryStreamBuffer(const char* data, size_t size);
+
+    //! \brief Writes into a buffer owned by this
+    //! \param reserve Space to reserve up front for the written data
+    explicit MemoryStreamBuffer(size_t reserve);
+
+    //! \brief Moves the written data out, this is then empty
+    std::string TakeData();
+
+protected:
+    std::streamsize xsgetn(char* buffer, std::streamsize count) override;
+    int_type underflow() override;
+    int_type uflow() override;
+    std::streamsize showmanyc() override;
+
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int_type overflow(int_type character) override;
+
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+        std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+
+private:
+    [[nodiscard]] const char* GetData() const
+    {
+        return Writable ? Data.data() : View;
+    }
+
+    [[nodiscard]] size_t GetSize() const
+    {
+        return Writable ? Data.size() : ViewSize;
+    }
+
+private:
+    const char* View = nullptr;
+    size_t ViewSize = 0;
+
+    std::string Data;
+    bool Writable = false;
+
+    size_t Position = 0;
+};
+
+//! \brief Seekable stream over memory, used to read and write a pck without a file
+class MemoryStream : public std::iostream {
+public:
+    //! \brief Reads from data that must stay alive and unchanged while this is used
+    MemoryStream(const char* data, size_t size);
+
+    //! \brief Writes into a buffer owned by this
+    //! \param reserve Space to reserve up front for the written data
+    explicit MemoryStream(size_t reserve);
+
+    MemoryStream(MemoryStream&& other) = delete;
+    MemoryStream(const MemoryStream& other) = delete;
+
+    MemoryStream& operator=(MemoryStream&& other) = delete;
+    MemoryStream& operator=(const MemoryStream& other) = delete;
+
+    //! \brief Moves the written data out, this is then empty
+    std::string TakeData()
+    {
+        return Buffer.TakeData();
+    }
+
+private:
+    MemoryStreamBuffer Buffer;
+};
+
+} // namespace pcktool
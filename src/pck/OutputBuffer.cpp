@@ -0,0 +1,102 @@
+// ------------------------------------ //
+#include "OutputBuffer.h"
+
+#include <charconv>
+
+using namespace pcktool;
+
+static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+// ------------------------------------ //
+OutputBuffer::OutputBuffer(std::ostream& output, size_t flushSize /*= 1024 * 1024*/) :
+    Output(output), FlushSize(flushSize)
+{
+    // Some extra space so that the last record before a flush doesn't need to reallocate
+    Buffer.reserve(FlushSize + FlushSize / 4);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    Flush();
+}
+// ------------------------------------ //
+void OutputBuffer::AppendNumber(uint64_t value)
+{
+    char digits[20];
+    const auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    Buffer.append(digits, result.ptr);
+}
+
+void OutputBuffer::AppendHex(const uint8_t* data, size_t length)
+{
+    const auto start = Buffer.size();
+    Buffer.resize(start + length * 2);
+
+    char* target = Buffer.data() + start;
+
+    for(size_t i = 0; i < length; ++i) {
+        *target++ = HEX_DIGITS[data[i] >> 4];
+        *target++ = HEX_DIGITS[data[i] & 0xf];
+    }
+}
+
+void OutputBuffer::AppendJSONString(std::string_view text)
+{
+    Buffer.push_back('"');
+
+    size_t plainStart = 0;
+
+    for(size_t i = 0; i < text.size(); ++i) {
+        const auto character = static_cast<unsigned char>(text[i]);
+
+        if(character >= 0x20 && character != '"' && character != '\\')
+            continue;
+
+        // Copy the run of characters that don't need escaping at once
+        Buffer.append(text.data() + plainStart, i - plainStart);
+        plainStart = i + 1;
+
+        switch(character) {
+            case '"': Buffer.append("\\\""); break;
+            case '\\': Buffer.append("\\\\"); break;
+            case '\n': Buffer.append("\\n"); break;
+            case '\r': Buffer.append("\\r"); break;
+            case '\t': Buffer.append("\\t"); break;
+            default:
+                Buffer.append("\\u00");
+                Buffer.push_back(HEX_DIGITS[character >> 4]);
+                Buffer.push_back(HEX_DIGITS[character & 0xf]);
+                break;
+        }
+    }
+
+    Buffer.append(text.data() + plainStart, text.size() - plainStart);
+    Buffer.push_back('"');
+}
+
+void OutputBuffer::AppendCSVField(std::string_view text)
+{
+    if(text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        Buffer.append(text);
+        return;
+    }
+
+    Buffer.push_back('"');
+
+    for(const auto character : text) {
+        if(character == '"')
+            Buffer.push_back('"');
+
+        Buffer.push_back(character);
+    }
+
+    Buffer.push_back('"');
+}
+// ------------------------------------ //
+void OutputBuffer::Flush()
+{
+    if(Buffer.empty())
+        return;
+
+    Output.write(Buffer.data(), static_cast<std::streamsize>(Buffer.size()));
+    Buffer.clear();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Define.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace pcktool {
+
+//! \brief Formats text output into a large buffer that is written out in big blocks
+//!
+//! Used for outputs with a lot of lines where writing each piece separately to a stream
+//! would be slow
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::ostream& output, size_t flushSize = 1024 * 1024);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer& other) = delete;
+    OutputBuffer& operator=(const OutputBuffer& other) = delete;
+
+    void Append(std::string_view text)
+    {
+        Buffer.append(text);
+    }
+
+    void Append(char character)
+    {
+        Buffer.push_back(character);
+    }
+
+    void AppendNumber(uint64_t value);
+
+    //! \brief Appends bytes as lowercase hex
+    void AppendHex(const uint8_t* data, size_t length);
+
+    //! \brief Appends a quoted and escaped JSON string
+    void AppendJSONString(std::string_view text);
+
+    //! \brief Appends a CSV field, quoted only if needed
+    void AppendCSVField(std::string_view text);
+
+    //! \brief Writes the buffer if it is over the flush size, call after each record
+    void EndRecord()
+    {
+        if(Buffer.size() >= FlushSize)
+            Flush();
+    }
+
+    void Flush();
+
+private:
+    std::ostream& Output;
+    const size_t FlushSize;
+
+    std::string Buffer;
+};
+
+} // namespace pcktool
@@ -0,0 +1,236 @@
+// ------------------------------------ //
+#include "PckAnalyzer.h"
+
+#include "PckFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+using namespace pcktool;
+
+namespace {
+
+//! A part of the pck used by a file or the directory
+struct Region {
+    uint64_t Start;
+    uint64_t End;
+
+    //! Null for the directory
+    const PckFile::ContainedFile* File;
+};
+
+const char* DescribeRegion(const Region& region)
+{
+    return region.File != nullptr ? region.File->Path.c_str() : "(directory)";
+}
+
+//! \returns The largest power of two the offset is a multiple of
+uint64_t GetOffsetAlignment(uint64_t offset)
+{
+    return offset == 0 ? std::numeric_limits<uint64_t>::max() : offset & (~offset + 1);
+}
+
+std::string GetExtension(const std::string& path)
+{
+    const auto nameStart = path.find_last_of('/');
+    const auto dot = path.find_last_of('.');
+
+    if(dot == std::string::npos || (nameStart != std::string::npos && dot < nameStart))
+        return "";
+
+    auto extension = path.substr(dot);
+
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char character) { return std::tolower(character); });
+
+    return extension;
+}
+
+} // namespace
+// ------------------------------------ //
+bool PckAnalyzer::Analyze(PckFile& pck, bool hashContents, Report& report)
+{
+    report = Report();
+
+    if(pck.HasExcludedEntries()) {
+        std::cout << "ERROR: can't analyze a pck when filters have excluded entries\n";
+        return false;
+    }
+
+    std::error_code error;
+    report.PckSize = std::filesystem::file_size(pck.GetPath(), error);
+
+    if(error) {
+        std::cout << "ERROR: can't read pck file size: " << pck.GetPath() << "\n";
+        return false;
+    }
+
+    const auto& contents = pck.GetContents();
+
+    report.Files = contents.size();
+    report.HashedContents = hashContents;
+
+    // Hashes of the data when hashing, otherwise the hashes from the directory are used
+    std::unordered_map<const PckFile::ContainedFile*, std::array<uint8_t, 16>> hashes;
+
+    if(hashContents) {
+        std::mutex hashesLock;
+        hashes.reserve(contents.size());
+
+        try {
+            pck.HashContents("analyze",
+                [&](const PckFile::ContainedFile& file, const std::array<uint8_t, 16>& hash) {
+                    std::lock_guard<std::mutex> lock(hashesLock);
+                    hashes.emplace(&file, hash);
+                });
+        } catch(const std::exception& e) {
+            std::cout << "ERROR: hashing file data failed: " << e.what() << "\n";
+            return false;
+        }
+    }
+
+    std::vector<Region> regions;
+    regions.reserve(contents.size() + 1);
+
+    if(pck.GetDirectoryEnd() > pck.GetDirectoryStart()) {
+        report.DirectorySize = pck.GetDirectoryEnd() - pck.GetDirectoryStart();
+        regions.push_back({pck.GetDirectoryStart(), pck.GetDirectoryEnd(), nullptr});
+    }
+
+    for(const auto& [path, file] : contents) {
+        report.PathSize += path.size();
+        report.PathPadding += pck.GetPathPadding(path.size());
+
+        auto& extension = report.Extensions[GetExtension(path)];
+        ++extension.Files;
+        extension.Size += file.Size;
+        extension.Largest = std::max(extension.Largest, file.Size);
+        ++extension.SizeClasses[GetSizeClass(file.Size)];
+
+        if(file.StoredInPck)
+            regions.push_back({file.Offset, file.Offset + file.GetStoredSize(), &file});
+    }
+
+    // The ranges are walked in file order to find the space between and around them
+    std::sort(regions.begin(), regions.end(), [](const Region& first, const Region& second) {
+        return first.Start != second.Start ? first.Start < second.Start :
+                                             first.End < second.End;
+    });
+
+    const Region* previous = nullptr;
+    uint64_t position = 0;
+
+    // Content of each distinct range of data, to find the ones stored more than once
+    std::map<std::pair<std::array<uint8_t, 16>, uint64_t>,
+        std::vector<const PckFile::ContainedFile*>>
+        contentCopies;
+
+    for(const auto& region : regions) {
+        if(region.End > report.PckSize && region.File != nullptr)
+            report.OutOfBounds.push_back(region.File->Path);
+
+        if(previous != nullptr && region.Start == previous->Start &&
+            region.End == previous->End && region.File != nullptr &&
+            previous->File != nullptr) {
+            ++report.SharedFiles;
+            continue;
+        }
+
+        if(previous == nullptr) {
+            // Only the header itself counts, anything between it and the first data (like the
+            // old directory left behind by an in-place update) is handled as a gap
+            const auto headerStart = std::min(region.Start, pck.GetPckStart());
+            position = std::min(region.Start, pck.GetPckStart() + pck.GetHeaderSize());
+            report.HeaderSize = position - headerStart;
+        } else if(region.Start < position) {
+            report.Overlaps.push_back(
+                {DescribeRegion(*previous), DescribeRegion(region), region.Start});
+        }
+
+        if(region.Start > position) {
+            const auto gap = region.Start - position;
+
+            // Padding to an alignment ends at an offset that is a multiple of it
+            if(gap < GetOffsetAlignment(region.Start)) {
+                report.AlignmentPadding += gap;
+                ++report.AlignmentGaps;
+            } else {
+                report.UnusedSpace += gap;
+                ++report.UnusedGaps;
+            }
+        }
+
+        if(region.End > position) {
+            position = region.End;
+            previous = &region;
+        }
+
+        if(region.File == nullptr)
+            continue;
+
+        report.DataSize += region.End - region.Start;
+
+        const auto hashed = hashes.find(region.File);
+        const auto& hash = hashed != hashes.end() ? hashed->second : region.File->MD5;
+
+        if(std::all_of(hash.begin(), hash.end(), [](uint8_t value) { return value == 0; })) {
+            ++report.Unhashed;
+            continue;
+        }
+
+        contentCopies[std::make_pair(hash, region.File->Size)].push_back(region.File);
+    }
+
+    if(previous != nullptr && position < report.PckSize)
+        report.TrailingSize = report.PckSize - position;
+
+    // Files sharing data with a duplicate are listed with it
+    std::unordered_map<uint64_t, std::vector<const PckFile::ContainedFile*>> sharing;
+
+    for(const auto& [path, file] : contents)
+        sharing[file.Offset].push_back(&file);
+
+    for(const auto& [key, copies] : contentCopies) {
+        if(copies.size() < 2)
+            continue;
+
+        DuplicateGroup group;
+        group.MD5 = key.first;
+        group.Size = key.second;
+        group.Copies = copies.size();
+
+        for(const auto* copy : copies) {
+            for(const auto* file : sharing[copy->Offset])
+                group.Paths.push_back(file->Path);
+        }
+
+        std::sort(group.Paths.begin(), group.Paths.end());
+        group.Paths.erase(
+            std::unique(group.Paths.begin(), group.Paths.end()), group.Paths.end());
+
+        report.DuplicateSize += (copies.size() - 1) * copies.front()->GetStoredSize();
+        report.Duplicates.push_back(std::move(group));
+    }
+
+    // Biggest savings first
+    std::stable_sort(report.Duplicates.begin(), report.Duplicates.end(),
+        [](const DuplicateGroup& first, const DuplicateGroup& second) {
+            return first.Size * (first.Copies - 1) > second.Size * (second.Copies - 1);
+        });
+
+    return true;
+}
+
+size_t PckAnalyzer::GetSizeClass(uint64_t size)
+{
+    for(size_t i = 0; i < SIZE_CLASS_LIMITS.size(); ++i) {
+        if(size < SIZE_CLASS_LIMITS[i])
+            return i;
+    }
+
+    return SIZE_CLASS_LIMITS.size();
+}
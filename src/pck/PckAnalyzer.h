@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Define.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+class PckFile;
+
+//! \brief Finds out where the space in a pck goes: padding, unused space between the file
+//! data, duplicate file contents and the sizes of the different file types
+//!
+//! Works from the directory alone unless the file data is asked to be hashed.
+class PckAnalyzer {
+public:
+    //! Upper limits of the size classes files are counted in, the last class has the rest
+    static constexpr std::array<uint64_t, 5> SIZE_CLASS_LIMITS = {
+        1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024, 64 * 1024 * 1024};
+
+    struct ExtensionStats {
+        size_t Files = 0;
+        uint64_t Size = 0;
+        uint64_t Largest = 0;
+
+        //! File counts in the classes of SIZE_CLASS_LIMITS
+        std::array<size_t, SIZE_CLASS_LIMITS.size() + 1> SizeClasses = {0};
+    };
+
+    //! \brief Files with identical contents that are stored more than once
+    struct DuplicateGroup {
+        uint64_t Size;
+        std::array<uint8_t, 16> MD5;
+        std::vector<std::string> Paths;
+
+        //! How many times the data is stored, files sharing the same data count once
+        size_t Copies;
+    };
+
+    //! \brief Two ranges of the pck that partly overlap, which shouldn't happen
+    struct Overlap {
+        std::string First;
+        std::string Second;
+        uint64_t Offset;
+    };
+
+    struct Report {
+        uint64_t PckSize = 0;
+        size_t Files = 0;
+
+        //! Size of the file data as stored, counted once for files sharing their data
+        uint64_t DataSize = 0;
+
+        //! Size of the pck header, space after it before the first data or the directory is
+        //! counted as alignment padding or unused space
+        uint64_t HeaderSize = 0;
+
+        uint64_t DirectorySize = 0;
+        uint64_t PathSize = 0;
+
+        //! NUL bytes after the paths in the directory
+        uint64_t PathPadding = 0;
+
+        //! Gaps that end at an offset aligned enough to explain them
+        uint64_t AlignmentPadding = 0;
+        size_t AlignmentGaps = 0;
+
+        //! Other gaps, for example data of replaced files left by updating in place
+        uint64_t UnusedSpace = 0;
+        size_t UnusedGaps = 0;
+
+        //! Data after the last file and the directory, an embedded pck has a small trailer
+        uint64_t TrailingSize = 0;
+
+        //! Files pointing to the same data as another file
+        size_t SharedFiles = 0;
+
+        std::vector<Overlap> Overlaps;
+
+        //! Files with data past the end of the pck
+        std::vector<std::string> OutOfBounds;
+
+        //! True if the file data was hashed instead of using the hashes in the directory
+        bool HashedContents = false;
+
+        //! Files without a hash in the directory, these are not checked for duplicates
+        size_t Unhashed = 0;
+
+        std::vector<DuplicateGroup> Duplicates;
+
+        //! Space that storing each duplicated content once would save
+        uint64_t DuplicateSize = 0;
+
+        //! Stats by lowercase extension (with the dot), files without one are under ""
+        std::map<std::string, ExtensionStats> Extensions;
+    };
+
+public:
+    //! \brief Analyzes a loaded pck, which must have been loaded without filters
+    //! \param hashContents When true the file data is read and hashed (in parallel if the pck
+    //! has a worker pool) to find duplicates, otherwise the directory hashes are used
+    static bool Analyze(PckFile& pck, bool hashContents, Report& report);
+
+    //! \returns The index of the size class of a file in SIZE_CLASS_LIMITS
+    static size_t GetSizeClass(uint64_t size);
+};
+
+} // namespace pcktool
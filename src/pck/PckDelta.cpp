@@ -0,0 +1,721 @@
+// ------------------------------------ //
+#include "PckDelta.h"
+
+#include "MD5Engine.h"
+#include "PlatformFile.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "md5.h"
+
+using namespace pcktool;
+
+namespace {
+
+// Deltas and chunk indexes are written in the native (little endian) byte order like the pck
+// data is
+
+struct DeltaHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t BaseSize;
+    uint64_t OutputSize;
+    uint64_t OperationCount;
+    uint8_t OutputMD5[16];
+};
+
+//! Literal operations are followed by Length bytes of data
+struct DeltaOperation {
+    //! Offset in the base pck or LITERAL_SOURCE
+    uint64_t Source;
+    uint64_t Length;
+};
+
+struct ChunkIndexHeader {
+    uint32_t Magic;
+    uint32_t Version;
+
+    // Values used to detect the pck changing
+    uint64_t PckSize;
+    int64_t PckModified;
+
+    uint64_t ChunkCount;
+};
+
+struct ChunkIndexEntry {
+    uint64_t Offset;
+    uint32_t Length;
+    uint32_t Reserved;
+    uint8_t Hash[16];
+};
+
+static_assert(sizeof(DeltaHeader) == 48, "delta header has unexpected padding");
+static_assert(sizeof(DeltaOperation) == 16, "delta operation has unexpected padding");
+static_assert(sizeof(ChunkIndexHeader) == 32, "chunk index header has unexpected padding");
+static_assert(sizeof(ChunkIndexEntry) == 32, "chunk index entry has unexpected padding");
+
+constexpr uint64_t LITERAL_SOURCE = std::numeric_limits<uint64_t>::max();
+
+//! Chunks are between the min and max size and 8 KiB on average
+constexpr size_t CHUNK_MIN_SIZE = 2 * 1024;
+constexpr size_t CHUNK_MAX_SIZE = 64 * 1024;
+constexpr int CHUNK_AVERAGE_BITS = 13;
+
+//! A chunk ends where these bits of the rolling hash are zero. The top bits are used as they
+//! depend on the last 64 bytes, the low bits only on the last few.
+constexpr uint64_t CHUNK_BOUNDARY_MASK = ((uint64_t(1) << CHUNK_AVERAGE_BITS) - 1)
+                                         << (64 - CHUNK_AVERAGE_BITS);
+
+//! Data is chunked in segments of up to this size, each read whole into memory by one thread
+constexpr uint64_t CHUNK_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+//! Buffer for copying data when writing and applying a delta
+constexpr size_t DELTA_COPY_BUFFER_SIZE = 1024 * 1024;
+
+//! \brief Random values for the rolling (gear) hash. Changing these moves the chunk
+//! boundaries, so PCK_CHUNK_INDEX_VERSION needs to be changed as well.
+constexpr std::array<uint64_t, 256> MakeGearTable()
+{
+    std::array<uint64_t, 256> table{};
+
+    // splitmix64
+    uint64_t state = 0;
+
+    for(auto& value : table) {
+        state += 0x9E3779B97F4A7C15ULL;
+
+        uint64_t mixed = state;
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+        value = mixed ^ (mixed >> 31);
+    }
+
+    return table;
+}
+
+constexpr auto GEAR_TABLE = MakeGearTable();
+
+//! \returns The length of the chunk starting at data
+size_t FindChunkEnd(const uint8_t* data, size_t size)
+{
+    if(size <= CHUNK_MIN_SIZE)
+        return size;
+
+    const auto limit = std::min(size, CHUNK_MAX_SIZE);
+
+    // The bytes before the min size can't end a chunk so they are not hashed
+    uint64_t hash = 0;
+
+    for(size_t i = CHUNK_MIN_SIZE; i < limit; ++i) {
+        hash = (hash << 1) + GEAR_TABLE[data[i]];
+
+        if((hash & CHUNK_BOUNDARY_MASK) == 0)
+            return i + 1;
+    }
+
+    return limit;
+}
+
+uint64_t HashKey(const std::array<uint8_t, 16>& hash)
+{
+    uint64_t key;
+    std::memcpy(&key, hash.data(), sizeof(key));
+    return key;
+}
+
+int64_t GetModificationTime(const std::string& path)
+{
+    return static_cast<int64_t>(
+        std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+//! Planned part of the target pck
+struct PlannedOperation {
+    uint64_t TargetOffset;
+    uint64_t Source;
+    uint64_t Length;
+};
+
+//! \brief Adds an operation, extending the previous one if the data continues it
+void AddOperation(std::vector<PlannedOperation>& operations, uint64_t targetOffset,
+    uint64_t source, uint64_t length)
+{
+    if(!operations.empty()) {
+        auto& last = operations.back();
+
+        const bool continues = last.TargetOffset + last.Length == targetOffset &&
+                               (source == LITERAL_SOURCE ?
+                                       last.Source == LITERAL_SOURCE :
+                                       last.Source != LITERAL_SOURCE &&
+                                           last.Source + last.Length == source);
+
+        if(continues) {
+            last.Length += length;
+            return;
+        }
+    }
+
+    operations.push_back({targetOffset, source, length});
+}
+
+} // namespace
+// ------------------------------------ //
+bool PckDelta::Create(const PckFile& base, const PckFile& target,
+    const std::string& deltaPath, WorkerPool* pool, Stats& stats)
+{
+    stats = Stats();
+
+    uint64_t baseSize;
+    uint64_t targetSize;
+
+    try {
+        baseSize = std::filesystem::file_size(base.GetPath());
+        targetSize = std::filesystem::file_size(target.GetPath());
+    } catch(const std::filesystem::filesystem_error& e) {
+        std::cout << "ERROR: can't read pck file sizes for delta: " << e.what() << "\n";
+        return false;
+    }
+
+    std::vector<Chunk> baseChunks;
+
+    if(!LoadChunkIndex(base.GetPath(), pool, baseChunks))
+        return false;
+
+    // Entries with the same contents are copied whole without looking at their data. The
+    // data of encrypted entries differs even with the same contents, so those are chunked.
+    const std::array<uint8_t, 16> noHash{};
+    std::map<std::pair<std::array<uint8_t, 16>, uint64_t>, uint64_t> baseEntries;
+
+    for(const auto& [_, entry] : base.GetContents()) {
+        if(entry.StoredInPck && !(entry.Flags & PCK_FILE_ENCRYPTED) && entry.MD5 != noHash)
+            baseEntries.emplace(std::make_pair(entry.MD5, entry.Size), entry.Offset);
+    }
+
+    std::vector<const PckFile::ContainedFile*> targetEntries;
+
+    for(const auto& [_, entry] : target.GetContents()) {
+        if(entry.StoredInPck && entry.Size > 0 && !(entry.Flags & PCK_FILE_ENCRYPTED) &&
+            entry.MD5 != noHash)
+            targetEntries.push_back(&entry);
+    }
+
+    std::sort(targetEntries.begin(), targetEntries.end(),
+        [](const auto* first, const auto* second) { return first->Offset < second->Offset; });
+
+    std::vector<PlannedOperation> unchanged;
+    std::vector<Range> unmatched;
+    uint64_t position = 0;
+
+    for(const auto* entry : targetEntries) {
+        // Overlapping entries (with shared data) are covered by the first one
+        if(entry->Offset < position || entry->Offset + entry->Size > targetSize)
+            continue;
+
+        const auto found = baseEntries.find(std::make_pair(entry->MD5, entry->Size));
+
+        if(found == baseEntries.end())
+            continue;
+
+        if(entry->Offset > position)
+            unmatched.push_back({position, entry->Offset});
+
+        unchanged.push_back({entry->Offset, found->second, entry->Size});
+        position = entry->Offset + entry->Size;
+        ++stats.UnchangedEntries;
+    }
+
+    if(position < targetSize)
+        unmatched.push_back({position, targetSize});
+
+    // The whole target is hashed so that applying the delta can check the result. That runs
+    // alongside the chunking.
+    std::array<uint8_t, 16> targetHash{};
+    std::atomic<bool> hashFailed{false};
+
+    const auto hashTarget = [&]() {
+        ReadableFile reader;
+
+        if(!reader.Open(target.GetPath())) {
+            hashFailed = true;
+            return;
+        }
+
+        reader.AdviseSequential();
+
+        const auto buffer = std::make_unique<char[]>(DELTA_COPY_BUFFER_SIZE);
+        md5::md5_t hasher;
+
+        for(uint64_t offset = 0; offset < targetSize; offset += DELTA_COPY_BUFFER_SIZE) {
+            const auto amount = static_cast<size_t>(
+                std::min<uint64_t>(DELTA_COPY_BUFFER_SIZE, targetSize - offset));
+
+            if(!reader.ReadAt(offset, buffer.get(), amount)) {
+                hashFailed = true;
+                return;
+            }
+
+            hasher.process(buffer.get(), static_cast<unsigned>(amount));
+        }
+
+        hasher.finish(targetHash.data());
+    };
+
+    std::vector<Chunk> targetChunks;
+    bool chunked;
+
+    if(pool != nullptr && pool->GetThreadCount() > 1) {
+        WorkerPool::TaskGroup hashing(*pool);
+        hashing.Run(hashTarget);
+
+        chunked = ChunkFile(target.GetPath(), unmatched, pool, targetChunks);
+        hashing.Wait();
+    } else {
+        hashTarget();
+        chunked = ChunkFile(target.GetPath(), unmatched, pool, targetChunks);
+    }
+
+    if(!chunked)
+        return false;
+
+    if(hashFailed) {
+        std::cout << "ERROR: reading pck for delta failed: " << target.GetPath() << "\n";
+        return false;
+    }
+
+    std::unordered_map<uint64_t, size_t> baseChunksByHash;
+    baseChunksByHash.reserve(baseChunks.size());
+
+    for(size_t i = 0; i < baseChunks.size(); ++i)
+        baseChunksByHash.emplace(HashKey(baseChunks[i].Hash), i);
+
+    // Both lists are in target order, so they are merged into one
+    std::vector<PlannedOperation> operations;
+    auto nextUnchanged = unchanged.begin();
+
+    const auto addUnchangedBefore = [&](uint64_t offset) {
+        for(; nextUnchanged != unchanged.end() && nextUnchanged->TargetOffset < offset;
+            ++nextUnchanged) {
+            AddOperation(operations, nextUnchanged->TargetOffset, nextUnchanged->Source,
+                nextUnchanged->Length);
+        }
+    };
+
+    for(const auto& chunk : targetChunks) {
+        addUnchangedBefore(chunk.Offset);
+
+        const auto found = baseChunksByHash.find(HashKey(chunk.Hash));
+
+        if(found != baseChunksByHash.end() &&
+            baseChunks[found->second].Length == chunk.Length &&
+            baseChunks[found->second].Hash == chunk.Hash) {
+            AddOperation(operations, chunk.Offset, baseChunks[found->second].Offset,
+                chunk.Length);
+            ++stats.MatchedChunks;
+        } else {
+            AddOperation(operations, chunk.Offset, LITERAL_SOURCE, chunk.Length);
+        }
+    }
+
+    addUnchangedBefore(targetSize);
+
+    stats.Chunks = targetChunks.size();
+    stats.OutputSize = targetSize;
+
+    const auto tmpWrite = deltaPath + ".write";
+
+    {
+        std::ofstream writer(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+        if(!writer.good()) {
+            std::cout << "ERROR: delta file is unwritable: " << tmpWrite << "\n";
+            return false;
+        }
+
+        DeltaHeader header{};
+        header.Magic = PCK_DELTA_MAGIC;
+        header.Version = PCK_DELTA_VERSION;
+        header.BaseSize = baseSize;
+        header.OutputSize = targetSize;
+        header.OperationCount = operations.size();
+        std::memcpy(header.OutputMD5, targetHash.data(), sizeof(header.OutputMD5));
+
+        writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        ReadableFile reader;
+
+        if(!reader.Open(target.GetPath())) {
+            std::cout << "ERROR: opening pck for delta failed: " << target.GetPath() << "\n";
+            return false;
+        }
+
+        const auto buffer = std::make_unique<char[]>(DELTA_COPY_BUFFER_SIZE);
+
+        for(const auto& operation : operations) {
+            const DeltaOperation raw{operation.Source, operation.Length};
+            writer.write(reinterpret_cast<const char*>(&raw), sizeof(raw));
+
+            if(operation.Source != LITERAL_SOURCE) {
+                stats.CopiedSize += operation.Length;
+                continue;
+            }
+
+            stats.LiteralSize += operation.Length;
+
+            for(uint64_t offset = 0; offset < operation.Length;
+                offset += DELTA_COPY_BUFFER_SIZE) {
+                const auto amount = static_cast<size_t>(
+                    std::min<uint64_t>(DELTA_COPY_BUFFER_SIZE, operation.Length - offset));
+
+                if(!reader.ReadAt(operation.TargetOffset + offset, buffer.get(), amount)) {
+                    std::cout << "ERROR: reading pck for delta failed: " << target.GetPath()
+                              << "\n";
+                    return false;
+                }
+
+                writer.write(buffer.get(), static_cast<std::streamsize>(amount));
+            }
+        }
+
+        if(!writer.good()) {
+            std::cout << "ERROR: writing delta file failed: " << tmpWrite << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpWrite, deltaPath, error);
+
+    if(error) {
+        std::cout << "ERROR: replacing delta file failed: " << deltaPath << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PckDelta::Apply(const std::string& basePath, const std::string& deltaPath,
+    const std::string& outputPath, Durability durability)
+{
+    std::ifstream reader(deltaPath, std::ios::in | std::ios::binary);
+
+    if(!reader.good()) {
+        std::cout << "ERROR: delta file is unreadable: " << deltaPath << "\n";
+        return false;
+    }
+
+    DeltaHeader header{};
+    reader.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if(!reader.good() || header.Magic != PCK_DELTA_MAGIC) {
+        std::cout << "ERROR: not a pck delta file: " << deltaPath << "\n";
+        return false;
+    }
+
+    if(header.Version != PCK_DELTA_VERSION) {
+        std::cout << "ERROR: unsupported pck delta version: " << header.Version << "\n";
+        return false;
+    }
+
+    std::error_code error;
+    const auto baseSize = std::filesystem::file_size(basePath, error);
+
+    if(error || baseSize != header.BaseSize) {
+        std::cout << "ERROR: the delta was made for a different pck than: " << basePath
+                  << "\n";
+        return false;
+    }
+
+    ReadableFile base;
+
+    if(!base.Open(basePath)) {
+        std::cout << "ERROR: file is unreadable: " << basePath << "\n";
+        return false;
+    }
+
+    const auto tmpWrite = outputPath + ".write";
+
+    const auto fail = [&](const std::string& message) {
+        std::cout << "ERROR: " << message << "\n";
+        std::filesystem::remove(tmpWrite, error);
+        return false;
+    };
+
+    {
+        WritableFile writer;
+
+        if(!writer.Create(tmpWrite)) {
+            std::cout << "ERROR: file is unwritable: " << tmpWrite << "\n";
+            return false;
+        }
+
+        if(durability != Durability::Fast)
+            writer.Preallocate(header.OutputSize);
+
+        const auto buffer = std::make_unique<char[]>(DELTA_COPY_BUFFER_SIZE);
+        md5::md5_t hasher;
+        uint64_t written = 0;
+
+        for(uint64_t i = 0; i < header.OperationCount; ++i) {
+            DeltaOperation operation{};
+            reader.read(reinterpret_cast<char*>(&operation), sizeof(operation));
+
+            if(!reader.good() || operation.Length > header.OutputSize - written)
+                return fail("delta file is truncated or corrupt: " + deltaPath);
+
+            for(uint64_t offset = 0; offset < operation.Length;
+                offset += DELTA_COPY_BUFFER_SIZE) {
+                const auto amount = static_cast<size_t>(
+                    std::min<uint64_t>(DELTA_COPY_BUFFER_SIZE, operation.Length - offset));
+
+                if(operation.Source == LITERAL_SOURCE) {
+                    if(!reader.read(buffer.get(), static_cast<std::streamsize>(amount)))
+                        return fail("delta file is truncated: " + deltaPath);
+                } else if(!base.ReadAt(operation.Source + offset, buffer.get(), amount)) {
+                    return fail("reading delta base failed: " + basePath);
+                }
+
+                hasher.process(buffer.get(), static_cast<unsigned>(amount));
+
+                if(!writer.Write(buffer.get(), amount))
+                    return fail("writing file failed: " + tmpWrite);
+            }
+
+            written += operation.Length;
+        }
+
+        std::array<uint8_t, 16> hash{};
+        hasher.finish(hash.data());
+
+        if(written != header.OutputSize ||
+            std::memcmp(hash.data(), header.OutputMD5, hash.size()) != 0)
+            return fail("the result of the delta doesn't match the expected hash, the delta "
+                        "was made for a different pck than: " +
+                        basePath);
+
+        if(durability == Durability::Safe && !writer.Sync())
+            return fail("syncing file failed: " + tmpWrite);
+
+        if(!writer.Close())
+            return fail("writing file failed: " + tmpWrite);
+    }
+
+    // The base may be the file being replaced
+    base.Close();
+
+    std::filesystem::rename(tmpWrite, outputPath, error);
+
+    if(error)
+        return fail("replacing file failed: " + outputPath);
+
+    if(durability == Durability::Safe) {
+        const auto parent = std::filesystem::path(outputPath).parent_path();
+        WritableFile::SyncDirectory(parent.empty() ? "." : parent.string());
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool PckDelta::ChunkFile(const std::string& path, const std::vector<Range>& ranges,
+    WorkerPool* pool, std::vector<Chunk>& chunks)
+{
+    chunks.clear();
+
+    ReadableFile reader;
+
+    if(!reader.Open(path)) {
+        std::cout << "ERROR: file is unreadable: " << path << "\n";
+        return false;
+    }
+
+    // Small ranges are grouped into segments, big ones are split into multiple
+    std::vector<std::vector<Range>> segments;
+    uint64_t segmentSize = CHUNK_SEGMENT_SIZE;
+
+    for(const auto& range : ranges) {
+        for(auto start = range.Start; start < range.End;) {
+            const auto end = std::min(range.End, start + CHUNK_SEGMENT_SIZE);
+
+            if(segmentSize + (end - start) > CHUNK_SEGMENT_SIZE) {
+                segments.emplace_back();
+                segmentSize = 0;
+            }
+
+            segments.back().push_back({start, end});
+            segmentSize += end - start;
+            start = end;
+        }
+    }
+
+    std::vector<std::vector<Chunk>> results(segments.size());
+    std::atomic<bool> failed{false};
+    const MD5Engine hashEngine;
+
+    const auto chunkSegment = [&](size_t index) {
+        const auto& parts = segments[index];
+        auto& result = results[index];
+
+        uint64_t size = 0;
+
+        for(const auto& part : parts)
+            size += part.End - part.Start;
+
+        const auto data = std::make_unique<char[]>(size);
+        std::vector<MD5Engine::Job> jobs;
+        char* position = data.get();
+
+        for(const auto& part : parts) {
+            const auto length = static_cast<size_t>(part.End - part.Start);
+
+            if(!reader.ReadAt(part.Start, position, length)) {
+                failed = true;
+                return;
+            }
+
+            for(size_t offset = 0; offset < length;) {
+                const auto chunkLength = FindChunkEnd(
+                    reinterpret_cast<const uint8_t*>(position + offset), length - offset);
+
+                result.push_back(
+                    {part.Start + offset, static_cast<uint32_t>(chunkLength), {}});
+                jobs.push_back({position + offset, chunkLength, nullptr});
+
+                offset += chunkLength;
+            }
+
+            position += length;
+        }
+
+        // The results are set only now as adding chunks moves them around
+        for(size_t i = 0; i < jobs.size(); ++i)
+            jobs[i].Result = result[i].Hash.data();
+
+        hashEngine.Hash(jobs.data(), jobs.size());
+    };
+
+    if(pool != nullptr && pool->GetThreadCount() > 1) {
+        WorkerPool::TaskGroup group(*pool);
+
+        for(size_t i = 0; i < segments.size(); ++i)
+            group.Run([&chunkSegment, i]() { chunkSegment(i); });
+
+        group.Wait();
+    } else {
+        for(size_t i = 0; i < segments.size(); ++i)
+            chunkSegment(i);
+    }
+
+    if(failed) {
+        std::cout << "ERROR: reading file for chunking failed: " << path << "\n";
+        return false;
+    }
+
+    size_t total = 0;
+
+    for(const auto& result : results)
+        total += result.size();
+
+    chunks.reserve(total);
+
+    for(const auto& result : results)
+        chunks.insert(chunks.end(), result.begin(), result.end());
+
+    return true;
+}
+
+bool PckDelta::LoadChunkIndex(
+    const std::string& pckPath, WorkerPool* pool, std::vector<Chunk>& chunks)
+{
+    const auto indexPath = ChunkIndexPathFor(pckPath);
+
+    uint64_t pckSize;
+    int64_t pckModified;
+
+    try {
+        pckSize = std::filesystem::file_size(pckPath);
+        pckModified = GetModificationTime(pckPath);
+    } catch(const std::filesystem::filesystem_error& e) {
+        std::cout << "ERROR: can't read pck file info for chunk index: " << e.what() << "\n";
+        return false;
+    }
+
+    std::ifstream reader(indexPath, std::ios::in | std::ios::binary);
+
+    if(reader.good()) {
+        ChunkIndexHeader header{};
+        reader.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if(reader.good() && header.Magic == PCK_CHUNK_INDEX_MAGIC &&
+            header.Version == PCK_CHUNK_INDEX_VERSION && header.PckSize == pckSize &&
+            header.PckModified == pckModified && header.ChunkCount <= pckSize) {
+            std::vector<ChunkIndexEntry> entries(header.ChunkCount);
+            reader.read(reinterpret_cast<char*>(entries.data()),
+                static_cast<std::streamsize>(entries.size() * sizeof(ChunkIndexEntry)));
+
+            if(reader.good()) {
+                chunks.resize(entries.size());
+
+                for(size_t i = 0; i < entries.size(); ++i) {
+                    chunks[i].Offset = entries[i].Offset;
+                    chunks[i].Length = entries[i].Length;
+                    std::memcpy(chunks[i].Hash.data(), entries[i].Hash, chunks[i].Hash.size());
+                }
+
+                return true;
+            }
+        }
+    }
+
+    reader.close();
+
+    if(!ChunkFile(pckPath, {{0, pckSize}}, pool, chunks))
+        return false;
+
+    // Not having the index only makes the next delta slower
+    const auto tmpWrite = indexPath + ".write";
+
+    {
+        std::ofstream writer(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+        ChunkIndexHeader header{};
+        header.Magic = PCK_CHUNK_INDEX_MAGIC;
+        header.Version = PCK_CHUNK_INDEX_VERSION;
+        header.PckSize = pckSize;
+        header.PckModified = pckModified;
+        header.ChunkCount = chunks.size();
+
+        writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for(const auto& chunk : chunks) {
+            ChunkIndexEntry entry{};
+            entry.Offset = chunk.Offset;
+            entry.Length = chunk.Length;
+            std::memcpy(entry.Hash, chunk.Hash.data(), sizeof(entry.Hash));
+
+            writer.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        }
+
+        if(!writer.good()) {
+            std::cout << "WARNING: writing chunk index failed: " << tmpWrite << "\n";
+            return true;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpWrite, indexPath, error);
+
+    if(error)
+        std::cout << "WARNING: replacing chunk index failed: " << indexPath << "\n";
+
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+class WorkerPool;
+
+constexpr uint32_t PCK_DELTA_MAGIC = 0x44504347;
+constexpr uint32_t PCK_DELTA_VERSION = 1;
+
+constexpr uint32_t PCK_CHUNK_INDEX_MAGIC = 0x43504347;
+constexpr uint32_t PCK_CHUNK_INDEX_VERSION = 1;
+
+constexpr auto PCK_CHUNK_INDEX_EXTENSION = ".chunks";
+
+//! \brief Binary delta that turns one build of a pck into another byte for byte
+//!
+//! The new pck is described as ranges copied from the old pck and literal data. Entries that
+//! the old pck has with the same hash are copied whole, the rest of the new pck is split into
+//! content-defined chunks with a rolling hash so that data shifted around by changes is still
+//! found. The chunks of the old pck are kept in a sidecar chunk index (.pck.chunks) so that
+//! an old build is chunked only once.
+class PckDelta {
+public:
+    struct Stats {
+        //! Size of the new pck
+        uint64_t OutputSize = 0;
+
+        //! Data copied from the old pck
+        uint64_t CopiedSize = 0;
+
+        //! Data stored in the delta
+        uint64_t LiteralSize = 0;
+
+        //! Entries found whole in the old pck, these were not chunked
+        size_t UnchangedEntries = 0;
+
+        size_t Chunks = 0;
+        size_t MatchedChunks = 0;
+    };
+
+    struct Chunk {
+        uint64_t Offset;
+        uint32_t Length;
+        std::array<uint8_t, 16> Hash;
+    };
+
+    //! Part of a file from Start up to End
+    struct Range {
+        uint64_t Start;
+        uint64_t End;
+    };
+
+public:
+    //! \brief Writes a delta from the base pck to the target pck
+    //!
+    //! Both packs need to be loaded. The chunk index of the base is created or updated if it
+    //! is missing or out of date.
+    //! \param pool If set, chunking and hashing are done with multiple threads
+    static bool Create(const PckFile& base, const PckFile& target,
+        const std::string& deltaPath, WorkerPool* pool, Stats& stats);
+
+    //! \brief Recreates the target pck of a delta from its base pck
+    //!
+    //! The data is streamed through a small buffer and checked against the hash of the target
+    //! before it replaces the output file, so the output can also be the base pck.
+    static bool Apply(const std::string& basePath, const std::string& deltaPath,
+        const std::string& outputPath, Durability durability);
+
+    //! \brief Splits ranges of a file into content-defined chunks and hashes them
+    //!
+    //! Boundaries are picked by the content, so an insertion only changes the chunks around
+    //! it. The ranges are processed in segments that always end a chunk, which allows the
+    //! segments to be chunked in parallel.
+    //! \param chunks Receives the chunks in file order
+    static bool ChunkFile(const std::string& path, const std::vector<Range>& ranges,
+        WorkerPool* pool, std::vector<Chunk>& chunks);
+
+    static std::string ChunkIndexPathFor(const std::string& pckPath)
+    {
+        return pckPath + PCK_CHUNK_INDEX_EXTENSION;
+    }
+
+private:
+    //! \brief Reads the chunk index of a pck, creating it if it is missing or out of date
+    static bool LoadChunkIndex(
+        const std::string& pckPath, WorkerPool* pool, std::vector<Chunk>& chunks);
+};
+
+} // namespace pcktool
@@ -1,9 +1,28 @@
 // ------------------------------------ //
 #include "PckFile.h"
 
+#include "AlignmentPolicy.h"
+#include "BufferPool.h"
+#include "ExtractJournal.h"
+#include "ExtractPlanner.h"
+#include "MD5Engine.h"
+#include "MemoryStream.h"
+#include "OutputBuffer.h"
+#include "PckIndex.h"
+#include "PlatformFile.h"
+#include "ProgressReporter.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
 #include <utility>
 
 #include "md5.h"
@@ -12,36 +31,186 @@ static_assert(MD5_SIZE == 16, "MD5 size changed");
 // ------------------------------------ //
 using namespace pcktool;
 
+//! Keeps the output lines of parallel operations from mixing together
+static std::mutex OutputLock;
+
+//! Encrypted data is read and written in chunks of this size (a multiple of the AES block)
+constexpr size_t ENCRYPTION_CHUNK_SIZE = 1024 * 1024;
+
+//! Small files are hashed in batches of up to this many files and bytes, the batch data is
+//! kept in memory
+constexpr size_t HASH_BATCH_FILES = 256;
+constexpr uint64_t HASH_BATCH_SIZE = 8 * 1024 * 1024;
+
+//! Position of the flags from the start of the pck (format version 2 and newer), the file base
+//! offset and the directory offset come right after it
+constexpr uint64_t HEADER_FLAGS_POSITION = 20;
+
+//! Size of the header in format version 3 and newer, including the reserved part
+constexpr uint64_t HEADER_SIZE_V3 = 104;
+
+//! Header sizes of the older versions, which don't have the directory offset (and version 1
+//! not the flags and the file base either)
+constexpr uint64_t HEADER_SIZE_V2 = 96;
+constexpr uint64_t HEADER_SIZE_V1 = 84;
+
+//! Size of the blocks compaction moves file data in when there is no memory budget
+constexpr size_t COMPACT_BLOCK_SIZE = 8 * 1024 * 1024;
+
+//! Size of the write buffer used by saving in the fast durability mode
+constexpr size_t FAST_WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+//! \brief Waits until the data written to a file is on disk
+static bool SyncFile(const std::string& path)
+{
+    WritableFile file;
+    return file.OpenForAppend(path) && file.Sync() && file.Close();
+}
+
+//! \brief Moves a newly written file over the target it replaces
+static bool ReplaceFile(
+    const std::string& written, const std::string& target, Durability durability)
+{
+    std::error_code error;
+
+    // Renaming over the target replaces it atomically so that it is never missing. That is
+    // only done when safe as some filesystems (ext4) then write out the new data right away,
+    // and some platforms can only rename to a path that doesn't exist.
+    if(durability != Durability::Safe)
+        std::filesystem::remove(target, error);
+
+    std::filesystem::rename(written, target, error);
+
+    if(error && durability == Durability::Safe) {
+        std::filesystem::remove(target, error);
+        std::filesystem::rename(written, target, error);
+    }
+
+    if(error) {
+        std::cout << "ERROR: moving " << written << " to " << target << " failed: "
+                  << error.message() << "\n";
+        return false;
+    }
+
+    if(durability == Durability::Safe) {
+        auto directory = std::filesystem::path(target).parent_path();
+
+        if(directory.empty())
+            directory = ".";
+
+        if(!WritableFile::SyncDirectory(directory.string())) {
+            std::cout << "ERROR: flushing the folder of " << target << " to disk failed\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static AESCipher::IV GenerateIV()
+{
+    static std::mutex randomLock;
+    static std::random_device random;
+
+    std::lock_guard<std::mutex> lock(randomLock);
+
+    AESCipher::IV iv;
+
+    for(auto& value : iv)
+        value = static_cast<uint8_t>(random());
+
+    return iv;
+}
+
 PckFile::PckFile(std::string path) : Path(std::move(path)) {}
+
+//! \brief Reads the data of an entry through a buffer from the pool one chunk at a time
+static bool StreamData(const PckFile::ContainedFile& entry, BufferPool& buffers,
+    const std::function<bool(char* data, size_t size)>& consumer)
+{
+    const auto buffer = buffers.Acquire();
+
+    for(uint64_t position = 0; position < entry.Size; position += buffer.GetSize()) {
+        const auto amount =
+            static_cast<size_t>(std::min<uint64_t>(buffer.GetSize(), entry.Size - position));
+
+        if(!entry.ReadRange(position, buffer.GetData(), amount))
+            return false;
+
+        if(!consumer(buffer.GetData(), amount))
+            return false;
+    }
+
+    return true;
+}
 // ------------------------------------ //
 bool PckFile::Load()
 {
     Contents.clear();
+    ExcludedEntries = 0;
+
+    if(UseSidecarIndex) {
+        PckIndex index;
 
-    File = std::fstream(Path, std::ios::in | std::ios::binary);
+        // Reading the directory to check it would take as long as just parsing it
+        if(index.Open(PckIndex::IndexPathFor(Path), Path, false))
+            return LoadFromIndex(index);
+    }
+
+    File = std::make_unique<std::fstream>(Path, std::ios::in | std::ios::binary);
 
     if(!File->good()) {
         std::cout << "ERROR: file is unreadable: " << Path << "\n";
         return false;
     }
 
-    File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
     // Separate reader to make writing work
-    DataReader = std::ifstream(Path, std::ios::in | std::ios::binary);
+    DataReader.emplace();
 
-    if(!DataReader || !DataReader->good())
+    if(!DataReader->Open(Path))
         throw std::runtime_error("second data reader opening failed");
 
-    const auto pckStart = DataReader->tellg();
+    return ReadHeaderAndDirectory();
+}
+
+bool PckFile::LoadFromMemory(std::string data)
+{
+    Contents.clear();
+    ExcludedEntries = 0;
+
+    // The old data may still be in use until the reader is switched over
+    File.reset();
+    DataReader.reset();
+
+    MemoryData = std::move(data);
+
+    File = std::make_unique<MemoryStream>(MemoryData.data(), MemoryData.size());
+
+    DataReader.emplace();
+    DataReader->OpenMemory(MemoryData.data(), MemoryData.size());
+
+    return ReadHeaderAndDirectory();
+}
 
-    uint32_t magic = Read32();
+bool PckFile::ReadHeaderAndDirectory()
+{
+    File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-    if(magic != PCK_HEADER_MAGIC) {
+    if(!FindPckStart()) {
         std::cout << "ERROR: invalid magic number\n";
         return false;
     }
 
+    if(PckStart > 0)
+        std::cout << "Found pck embedded in an executable at offset " << PckStart << "\n";
+
+    File->seekg(static_cast<std::streamoff>(PckStart));
+
+    const auto pckStart = File->tellg();
+
+    // Already checked by FindPckStart
+    Read32();
+
     FormatVersion = Read32();
 
     // Godot engine version, we don't care about these
@@ -59,11 +228,6 @@ bool PckFile::Load()
         FileOffsetBase = Read64();
     }
 
-    if(Flags & PACK_DIR_ENCRYPTED) {
-        std::cout << "ERROR: pck is encrypted\n";
-        return false;
-    }
-
     if(Flags & PCK_FILE_SPARSE_BUNDLE) {
         std::cout << "Warning: Sparse pck detected, this is unlikely to work!\n";
     }
@@ -97,48 +261,85 @@ bool PckFile::Load()
 
 
     // Now we are at the file directory section
+    DirectoryStart = File->tellg();
     const auto files = Read32();
 
+    // The file count is not encrypted, but everything after it is
+    std::optional<std::istringstream> decryptedDirectory;
+
+    if(Flags & PACK_DIR_ENCRYPTED) {
+        if(!Cipher) {
+            std::cout << "ERROR: pck directory is encrypted, an encryption key is required to "
+                         "read it\n";
+            return false;
+        }
+
+        std::string decrypted;
+
+        if(!ReadEncryptedBlock(decrypted)) {
+            std::cout << "ERROR: decrypting the pck directory failed\n";
+            return false;
+        }
+
+        decryptedDirectory.emplace(std::move(decrypted));
+        decryptedDirectory->exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    }
+
+    std::istream& directory =
+        decryptedDirectory ? static_cast<std::istream&>(*decryptedDirectory) : *File;
+
     size_t excluded = 0;
+    size_t encrypted = 0;
 
-    for(uint32_t i = 0; i < files; i++) {
+    // The fields are read into reused locals so that entries rejected by the prefilter don't
+    // allocate anything
+    std::string pathBuffer;
+    std::array<uint8_t, 16> md5;
 
-        const auto pathLength = Read32();
+    for(uint32_t i = 0; i < files; i++) {
 
-        ContainedFile entry;
+        const auto pathLength = Read32(directory);
 
-        entry.Path.resize(pathLength);
+        pathBuffer.resize(pathLength);
+        directory.read(pathBuffer.data(), pathLength);
 
-        File->read(entry.Path.data(), pathLength);
+        std::string_view path = pathBuffer;
 
         // Remove trailing null bytes
-        while(!entry.Path.empty() && entry.Path.back() == '\0')
-            entry.Path.pop_back();
+        while(!path.empty() && path.back() == '\0')
+            path.remove_suffix(1);
 
-        entry.Offset = FileOffsetBase + Read64();
-        entry.Size = Read64();
+        const auto offset = Read64(directory);
+        const auto size = Read64(directory);
 
-        File->read(reinterpret_cast<char*>(entry.MD5.data()), sizeof(entry.MD5));
+        directory.read(reinterpret_cast<char*>(md5.data()), sizeof(md5));
 
-        if(FormatVersion >= 2) {
-            entry.Flags = Read32();
-            entry.Salt = Salt;
+        const uint32_t flags = FormatVersion >= 2 ? Read32(directory) : 0;
 
-            if(entry.Flags & PCK_FILE_ENCRYPTED) {
-                std::cout << "WARNING: pck file (" << entry.Path
-                          << ") is marked as encrypted, decoding the encryption is not "
-                             "implemented\n";
-            }
+        if(flags & PCK_FILE_ENCRYPTED)
+            ++encrypted;
 
-            if(entry.Flags & PCK_FILE_DELETED) {
-                std::cout << "Pck file is marked as removed (but still processing it): "
-                          << entry.Path << "\n";
-            }
+        if(flags & PCK_FILE_DELETED) {
+            std::cout << "Pck file is marked as removed (but still processing it): " << path
+                      << "\n";
         }
 
-        entry.GetData = [offset = entry.Offset, size = entry.Size, this]() {
-            return ReadContainedFileContents(offset, size);
-        };
+        if(!Prefilter.Accepts(path, size)) {
+            ++excluded;
+            continue;
+        }
+
+        ContainedFile entry;
+        entry.Path = path;
+        entry.Offset = FileOffsetBase + offset;
+        entry.Size = size;
+        entry.MD5 = md5;
+        entry.Flags = flags;
+
+        if(FormatVersion >= 2)
+            entry.Salt = Salt;
+
+        SetDataSource(entry);
 
         if(IncludeFilter && !IncludeFilter(entry)) {
             ++excluded;
@@ -148,8 +349,81 @@ bool PckFile::Load()
         Contents[entry.Path] = std::move(entry);
     }
 
-    File->close();
-    File.reset();
+    DirectoryEnd = File->tellg();
+
+    CloseFile();
+
+    ExcludedEntries = excluded;
+
+    if(excluded)
+        std::cout << Path << " files excluded by filters: " << excluded << "\n";
+
+    if(encrypted && !Cipher) {
+        std::cout << "WARNING: " << encrypted
+                  << " files are encrypted, their data can't be read without the encryption "
+                     "key\n";
+    }
+
+    return true;
+}
+
+bool PckFile::LoadFromIndex(const PckIndex& index)
+{
+    Contents.clear();
+    ExcludedEntries = 0;
+
+    DataReader.emplace();
+
+    if(!DataReader->Open(Path)) {
+        std::cout << "ERROR: file is unreadable: " << Path << "\n";
+        return false;
+    }
+
+    PckStart = index.GetPckStart();
+    FormatVersion = index.GetFormatVersion();
+    MajorGodotVersion = index.GetMajorGodotVersion();
+    MinorGodotVersion = index.GetMinorGodotVersion();
+    PatchGodotVersion = index.GetPatchGodotVersion();
+    Flags = index.GetPckFlags();
+    FileOffsetBase = index.GetFileOffsetBase();
+    DirectoryStart = index.GetDirectoryStart();
+    DirectoryEnd = index.GetDirectoryEnd();
+
+    // Relative to the pck start like it is in the header
+    if(FormatVersion >= 3)
+        DirectoryOffset = DirectoryStart - PckStart;
+
+    size_t excluded = 0;
+    const auto count = index.GetEntryCount();
+
+    for(uint32_t i = 0; i < count; ++i) {
+        const auto indexEntry = index.GetEntry(i);
+
+        if(!Prefilter.Accepts(indexEntry.Path, indexEntry.Size)) {
+            ++excluded;
+            continue;
+        }
+
+        ContainedFile entry;
+        entry.Path = indexEntry.Path;
+        entry.Offset = indexEntry.Offset;
+        entry.Size = indexEntry.Size;
+        entry.MD5 = indexEntry.MD5;
+        entry.Flags = indexEntry.Flags;
+        entry.Salt = Salt;
+
+        SetDataSource(entry);
+
+        if(IncludeFilter && !IncludeFilter(entry)) {
+            ++excluded;
+            continue;
+        }
+
+        // Index entries are in path order so this always inserts at the end
+        Contents.emplace_hint(Contents.end(), entry.Path, std::move(entry));
+    }
+
+    ExcludedEntries = excluded;
 
     if(excluded)
         std::cout << Path << " files excluded by filters: " << excluded << "\n";
@@ -159,27 +433,168 @@ bool PckFile::Load()
 // ------------------------------------ //
 bool PckFile::Save()
 {
-    if(FormatVersion > MAX_SUPPORTED_PCK_VERSION_SAVE) {
-        std::cout << "ERROR: cannot save pck version: " << FormatVersion << "\n";
+    std::vector<ContainedFile*> writeOrder;
+
+    if(!PrepareSave(writeOrder))
         return false;
-    }
 
     const auto tmpWrite = Path + ".write";
 
-    File = std::fstream(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+    auto file = std::make_unique<std::fstream>();
 
-    if(!File->good()) {
+    // A big buffer turns the many small header and directory writes into a few system calls
+    if(DurabilityMode == Durability::Fast) {
+        WriteBuffer.resize(FAST_WRITE_BUFFER_SIZE);
+        file->rdbuf()->pubsetbuf(
+            WriteBuffer.data(), static_cast<std::streamsize>(WriteBuffer.size()));
+    }
+
+    file->open(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+    if(!file->good()) {
         std::cout << "ERROR: file is unwritable: " << tmpWrite << "\n";
         return false;
     }
 
+    File = std::move(file);
+
+    // A partially written file must not be left behind to be mistaken for a pck
+    const auto discardWrite = [&]() {
+        File.reset();
+
+        std::error_code error;
+        std::filesystem::remove(tmpWrite, error);
+    };
+
+    if(!WritePck(writeOrder)) {
+        discardWrite();
+        return false;
+    }
+
+    CloseFile();
+    DataReader.reset();
+
+    WriteBuffer.clear();
+    WriteBuffer.shrink_to_fit();
+
+    // The new file must be fully on disk before it replaces the old one, otherwise a crash can
+    // leave an empty or partial file in place of both
+    if(DurabilityMode == Durability::Safe && !SyncFile(tmpWrite)) {
+        std::cout << "ERROR: flushing the written pck to disk failed\n";
+        discardWrite();
+        return false;
+    }
+
+    // Keep the executable runnable
+    if(PckStart > 0 && std::filesystem::exists(Path)) {
+        std::filesystem::permissions(tmpWrite, std::filesystem::status(Path).permissions());
+    }
+
+    if(!ReplaceFile(tmpWrite, Path, DurabilityMode))
+        return false;
+
+    // The written file has exactly the current entries
+    ExcludedEntries = 0;
+
+    if(UseSidecarIndex && !(Flags & PACK_DIR_ENCRYPTED) &&
+        !PckIndex::Write(*this, PckIndex::IndexPathFor(Path))) {
+        std::cout << "ERROR: writing sidecar index failed\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PckFile::SaveToMemory(std::string& output)
+{
+    std::vector<ContainedFile*> writeOrder;
+
+    if(!PrepareSave(writeOrder))
+        return false;
+
+    auto stream = std::make_unique<MemoryStream>(GetSaveSizeLimit(writeOrder));
+    auto& memory = *stream;
+
+    File = std::move(stream);
+
+    if(!WritePck(writeOrder))
+        return false;
+
+    output = memory.TakeData();
+    CloseFile();
+
+    return true;
+}
+
+bool PckFile::PrepareSave(std::vector<ContainedFile*>& writeOrder)
+{
+    if(FormatVersion > MAX_SUPPORTED_PCK_VERSION_SAVE) {
+        std::cout << "ERROR: cannot save pck version: " << FormatVersion << "\n";
+        return false;
+    }
+
+    writeOrder = GetDataWriteOrder();
+
+    if(!CheckEncryptionKey(writeOrder))
+        return false;
+
     // Alignment is used with Godot 4 .pck files
     if(FormatVersion >= 2 && Alignment < 1) {
         Alignment = 32;
     }
 
+    return true;
+}
+
+uint64_t PckFile::GetHeaderSize() const
+{
+    if(FormatVersion >= 3)
+        return HEADER_SIZE_V3;
+
+    return FormatVersion == 2 ? HEADER_SIZE_V2 : HEADER_SIZE_V1;
+}
+
+uint64_t PckFile::GetSaveSizeLimit(const std::vector<ContainedFile*>& writeOrder) const
+{
+    // The executable, the header and the trailer of an embedded pck
+    uint64_t size = PckStart + HEADER_SIZE_V3 + (PckStart > 0 ? 12 + 7 : 0);
+
+    uint64_t directorySize = 0;
+
+    for(const auto& [path, entry] : Contents) {
+        directorySize += 4 + path.size() + GetPathPadding(path.size()) + 8 + 8 +
+                         sizeof(entry.MD5) + (FormatVersion >= 2 ? 4 : 0);
+    }
+
+    size += 4 +
+            (Flags & PACK_DIR_ENCRYPTED ? GetEncryptedSize(directorySize) : directorySize);
+
+    // Each file and the directory can be followed by padding to the biggest alignment
+    uint64_t alignment = std::max(Alignment, 1);
+
+    if(AlignmentRules) {
+        for(const auto& rule : AlignmentRules->GetRules())
+            alignment = std::max<uint64_t>(alignment, rule.Alignment);
+    }
+
+    size += alignment - 1;
+
+    for(const auto* entry : writeOrder)
+        size += entry->GetStoredSize() + alignment - 1;
+
+    return size;
+}
+
+bool PckFile::WritePck(const std::vector<ContainedFile*>& writeOrder)
+{
+    const bool encryptDirectory = Flags & PACK_DIR_ENCRYPTED;
+
     File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
+    // An embedded pck is written back after the same executable
+    if(PckStart > 0 && !CopyEmbeddingExecutable())
+        return false;
+
     // Header
 
     Write32(PCK_HEADER_MAGIC);
@@ -237,11 +652,12 @@ bool PckFile::Save()
     // file data
 
     const auto remember = File->tellg();
+    DirectoryStart = remember;
 
     if(FormatVersion >= 3) {
         // Write start of the directory variable
         File->seekg(directoryOffsetLocation);
-        Write64(remember);
+        Write64(static_cast<uint64_t>(remember) - PckStart);
     }
 
     File->seekg(remember);
@@ -250,42 +666,25 @@ bool PckFile::Save()
     // File count
     Write32(Contents.size());
 
-    std::map<const ContainedFile*, std::fstream::pos_type> continueWriteIndex;
-
-    // First, write blank file entries as placeholders
-    for(const auto& [_, entry] : Contents) {
-
-        // When the path is exactly the right size, this results in 4 extra NULLs
-        // but that seems to be what Godot itself also does
-        const size_t pathToWriteSize =
-            entry.Path.size() +
-            (PadPathsToMultipleWithNULLS - (entry.Path.size() % PadPathsToMultipleWithNULLS));
-        const size_t padding = pathToWriteSize - entry.Path.size();
-
-        Write32(pathToWriteSize);
-        File->write(entry.Path.data(), entry.Path.size());
-
-        // Padding null bytes
-        for(size_t i = 0; i < padding; ++i) {
-            char null = '\0';
-            File->write(&null, 1);
-        }
+    const auto entriesStart = File->tellg();
 
-        continueWriteIndex[&entry] = File->tellg();
-        // No offset yet
-        Write64(0);
-        Write64(entry.Size);
+    // First, write the file entries as placeholders. The offsets and MD5s are not known yet
+    // so this writes garbage, but the entries are written again once the data is written.
+    if(encryptDirectory) {
+        // Only the size of the encrypted directory is needed now
+        std::ostringstream placeholder;
+        WriteDirectoryEntries(placeholder);
+        WriteZeros(GetEncryptedSize(static_cast<uint64_t>(placeholder.tellp())));
+    } else {
+        WriteDirectoryEntries(*File);
+    }
 
-        // MD5 is not calculated yet, so this writes garbage but this will be fixed later
-        File->write(reinterpret_cast<const char*>(entry.MD5.data()), sizeof(entry.MD5));
+    DirectoryEnd = File->tellg();
 
-        if(FormatVersion >= 2) {
-            Write32(entry.Flags);
-        }
-    }
+    ResetPaddingReport();
 
     // Align
-    PadToAlignment();
+    LastPaddingReport.DirectoryPadding = PadToAlignment();
 
     const auto filesStart = File->tellg();
 
@@ -293,281 +692,1456 @@ bool PckFile::Save()
     if(FormatVersion >= 2) {
 
         // Set a valid offset now for the files start.
-        // Even with useRelativeOffset we don't need to adjust here as we always write the
-        // header at offset 0 of the file.
+        // With useRelativeOffset this is relative to the pck header, which is only not at the
+        // start of the file when the pck is embedded
         File->seekg(baseOffsetLocation);
-        Write64(filesStart);
+        Write64(useRelativeOffset ? static_cast<uint64_t>(filesStart) - PckStart :
+                                    static_cast<uint64_t>(filesStart));
+
+        FileOffsetBase = filesStart;
+    } else {
+        FileOffsetBase = 0;
     }
 
     File->seekg(filesStart);
 
-    // Then write the data
-    for(auto& [_, entry] : Contents) {
-        // Pad file data to the alignment (doing it here ensures it is correct for the first
-        // file as well)
-        PadToAlignment();
-
-        uint64_t offset = File->tellg();
+    // Then write the data (the directory stays in path order, but the data can be in a
+    // different order)
+    if(!WriteEntryData(writeOrder))
+        return false;
 
-        // Write the data here
-        // NOTE: the godot packer only writes like 50k bytes at once, but we load the whole
-        // thing to memory
-        const auto data = entry.GetData();
+    // Non-embedded pck doesn't have to be aligned up to end at Alignment size
+    // PadToAlignment();
 
-        if(data.size() != entry.Size) {
-            std::cout << "ERROR: file entry data source returned different amount of data "
-                      << "than the entry said its size is";
-            return false;
-        }
+    if(PckStart > 0) {
+        // Trailer that Godot uses to find the embedded pck, Godot makes the embedded data end
+        // at a multiple of 8 bytes
+        const auto embeddedEnd = static_cast<uint64_t>(File->tellg()) - PckStart + 12;
+        WriteZeros((8 - embeddedEnd % 8) % 8);
 
-        File->write(data.data(), entry.Size); // NOLINT(*-narrowing-conversions)
+        Write64(static_cast<uint64_t>(File->tellg()) - PckStart);
+        Write32(PCK_HEADER_MAGIC);
+    }
 
-        // Update MD5
-        // The md5 library assumes the write target size here
-        static_assert(sizeof(entry.MD5) == MD5_SIZE);
-        md5::md5_t(data.data(), data.size(), entry.MD5.data());
+    // And finally write the file entries again now that the offsets and hashes are known
+    File->seekg(entriesStart);
 
-        // Update the entry offset for writing
-        if(FormatVersion < 2) {
+    if(encryptDirectory) {
+        std::ostringstream directory;
+        WriteDirectoryEntries(directory);
 
-            entry.Offset = offset;
-        } else {
-            // Offsets are now relative to the files block
-            entry.Offset = offset - filesStart;
-        }
-    }
+        const auto plain = directory.str();
 
-    // Non-embedded pck doesn't have to be aligned up to end at Alignment size
-    // PadToAlignment();
+        std::array<uint8_t, 16> hash;
+        md5::md5_t(plain.data(), plain.size(), hash.data());
 
-    // And finally fix up the file headers
-    for(const auto& [_, entry] : Contents) {
-        File->seekg(continueWriteIndex[&entry]);
-        Write64(entry.Offset);
+        WriteEncrypted(plain, hash);
+    } else {
+        WriteDirectoryEntries(*File);
+    }
 
-        // Don't need to write this again, but for simplicity this can be written again to
-        // align the hash to the right spot
-        Write64(entry.Size);
+    return true;
+}
+// ------------------------------------ //
+bool PckFile::CanUpdateInPlace() const
+{
+    return DataReader && !DataReader->IsMemory() && PckStart == 0 && FormatVersion >= 3 &&
+           FormatVersion <= MAX_SUPPORTED_PCK_VERSION_SAVE;
+}
+
+bool PckFile::UpdateInPlace()
+{
+    if(!CanUpdateInPlace()) {
+        std::cout << "ERROR: this pck can't be updated in place, it needs to be saved whole\n";
+        return false;
+    }
+
+    const bool encryptDirectory = Flags & PACK_DIR_ENCRYPTED;
+
+    std::vector<ContainedFile*> unwritten;
+
+    for(auto* entry : GetDataWriteOrder()) {
+        if(!entry->StoredInPck)
+            unwritten.push_back(entry);
+    }
+
+    if(!CheckEncryptionKey(unwritten))
+        return false;
+
+    File = std::make_unique<std::fstream>(
+        Path, std::ios::in | std::ios::out | std::ios::binary);
+
+    if(!File->good()) {
+        std::cout << "ERROR: file is unwritable: " << Path << "\n";
+        return false;
+    }
+
+    if(Alignment < 1)
+        Alignment = 32;
+
+    File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    File->seekg(0, std::ios::end);
+
+    ResetPaddingReport();
+
+    if(!WriteEntryData(unwritten))
+        return false;
+
+    // The new directory goes after the new data
+    WriteDirectory();
+
+    if(!SwitchToDirectory())
+        return false;
+
+    // The written data is now read from the pck
+    for(auto* entry : unwritten)
+        SetDataSource(*entry);
+
+    ExcludedEntries = 0;
+
+    if(UseSidecarIndex && !encryptDirectory &&
+        !PckIndex::Write(*this, PckIndex::IndexPathFor(Path))) {
+        std::cout << "ERROR: writing sidecar index failed\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PckFile::Compact(uint64_t& reclaimed)
+{
+    reclaimed = 0;
+
+    if(!CanUpdateInPlace()) {
+        std::cout << "ERROR: this pck can't be compacted in place, repack it instead\n";
+        return false;
+    }
+
+    // The new directory would lose these entries
+    if(ExcludedEntries > 0) {
+        std::cout << "ERROR: can't compact a pck that was loaded with filters\n";
+        return false;
+    }
+
+    if(HasUnwrittenData()) {
+        std::cout << "ERROR: pck has unsaved changes, save it before compacting\n";
+        return false;
+    }
+
+    const auto oldSize = std::filesystem::file_size(Path);
+
+    std::vector<ContainedFile*> entries;
+    entries.reserve(Contents.size());
+
+    for(auto& [_, entry] : Contents)
+        entries.push_back(&entry);
+
+    std::stable_sort(entries.begin(), entries.end(),
+        [](const ContainedFile* first, const ContainedFile* second) {
+            return first->Offset < second->Offset;
+        });
+
+    File = std::make_unique<std::fstream>(
+        Path, std::ios::in | std::ios::out | std::ios::binary);
+
+    if(!File->good()) {
+        std::cout << "ERROR: file is unwritable: " << Path << "\n";
+        return false;
+    }
+
+    if(Alignment < 1)
+        Alignment = 32;
+
+    File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    // Moves are done in big blocks, which stay in the memory budget if there is one
+    std::optional<BufferPool::Buffer> pooled;
+    std::unique_ptr<char[]> owned;
+    char* buffer;
+    size_t bufferSize;
+
+    if(Buffers) {
+        pooled.emplace(Buffers->Acquire());
+        buffer = pooled->GetData();
+        bufferSize = pooled->GetSize();
+    } else {
+        owned = std::make_unique<char[]>(COMPACT_BLOCK_SIZE);
+        buffer = owned.get();
+        bufferSize = COMPACT_BLOCK_SIZE;
+    }
+
+    // The old directory is also unused space, so the data starts right after the header and
+    // the new directory goes at the end like Godot does it
+    File->seekg(static_cast<std::streamoff>(PckStart + HEADER_SIZE_V3));
+    PadToAlignment();
+
+    const uint64_t newBase = File->tellg();
+
+    if(Progress != nullptr) {
+        uint64_t totalSize = 0;
+
+        for(const auto* entry : entries)
+            totalSize += entry->GetStoredSize();
+
+        Progress->Begin("compact", entries.size(), totalSize);
+    }
+
+    uint64_t previousOffset = 0;
+    uint64_t previousEnd = 0;
+    uint64_t previousTarget = 0;
+    bool first = true;
+
+    for(auto* entry : entries) {
+        const auto size = entry->GetStoredSize();
+
+        // Entries sharing the same data keep sharing it
+        if(!first && entry->Offset == previousOffset && entry->Offset + size <= previousEnd) {
+            entry->Offset = previousTarget + (entry->Offset - previousOffset);
+
+            if(Progress != nullptr)
+                Progress->Add(1, size);
+
+            continue;
+        }
+
+        if(!first && entry->Offset < previousEnd) {
+            std::cout << "ERROR: file data overlaps with another file, repack instead: "
+                      << entry->Path << "\n";
+            return false;
+        }
+
+        const int rule = AlignmentRules ? AlignmentRules->FindRule(*entry) : -1;
+        const uint64_t alignment = std::max<uint64_t>(
+            rule >= 0 ? AlignmentRules->GetRules()[rule].Alignment : Alignment, 1);
+
+        const uint64_t cursor = File->tellg();
+        auto target = (cursor + alignment - 1) / alignment * alignment;
+
+        // A file that can't be aligned better than it is now stays where it is
+        if(target > entry->Offset)
+            target = entry->Offset;
+
+        if(target > cursor) {
+            File->seekg(static_cast<std::streamoff>(cursor));
+            WriteZeros(target - cursor);
+        }
+
+        // Moving towards the start of the file one block at a time never overwrites data that
+        // is still to be read
+        for(uint64_t moved = 0; target < entry->Offset && moved < size;) {
+            const auto amount =
+                static_cast<std::streamsize>(std::min<uint64_t>(bufferSize, size - moved));
+
+            File->seekg(static_cast<std::streamoff>(entry->Offset + moved));
+            File->read(buffer, amount);
+
+            File->seekp(static_cast<std::streamoff>(target + moved));
+            File->write(buffer, amount);
+
+            moved += amount;
+        }
+
+        first = false;
+        previousOffset = entry->Offset;
+        previousEnd = entry->Offset + size;
+        previousTarget = target;
+
+        entry->Offset = target;
+        File->seekg(static_cast<std::streamoff>(target + size));
+
+        if(Progress != nullptr)
+            Progress->Add(1, size);
+    }
+
+    if(Progress != nullptr)
+        Progress->End();
+
+    FileOffsetBase = newBase;
+
+    WriteDirectory();
+
+    if(!SwitchToDirectory())
+        return false;
+
+    std::filesystem::resize_file(Path, DirectoryEnd);
+
+    if(!SyncFile(Path)) {
+        std::cout << "ERROR: flushing the pck to disk failed\n";
+        return false;
+    }
+
+    for(auto* entry : entries)
+        SetDataSource(*entry);
+
+    reclaimed = oldSize - DirectoryEnd;
+
+    if(UseSidecarIndex && !(Flags & PACK_DIR_ENCRYPTED) &&
+        !PckIndex::Write(*this, PckIndex::IndexPathFor(Path))) {
+        std::cout << "ERROR: writing sidecar index failed\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PckFile::HasUnwrittenData() const
+{
+    return std::any_of(Contents.begin(), Contents.end(),
+        [](const auto& item) { return !item.second.StoredInPck; });
+}
+// ------------------------------------ //
+bool PckFile::WriteEntryData(const std::vector<ContainedFile*>& entries)
+{
+    // Pads to the alignment of an entry (doing it here ensures it is correct for the first
+    // file as well) and returns where the entry data starts
+    const auto startEntryData = [this](const ContainedFile& entry) {
+        const int rule = AlignmentRules ? AlignmentRules->FindRule(entry) : -1;
+
+        if(rule >= 0) {
+            LastPaddingReport.RulePadding[rule] +=
+                PadTo(AlignmentRules->GetRules()[rule].Alignment);
+            ++LastPaddingReport.RuleFiles[rule];
+        } else {
+            LastPaddingReport.DefaultPadding += PadToAlignment();
+            ++LastPaddingReport.DefaultFiles;
+        }
+
+        LastPaddingReport.DataSize += entry.GetStoredSize();
+
+        return static_cast<uint64_t>(File->tellg());
+    };
+
+    if(Progress != nullptr) {
+        uint64_t totalSize = 0;
+
+        for(const auto* entry : entries)
+            totalSize += entry->Size;
+
+        Progress->Begin("save", entries.size(), totalSize);
+    }
+
+    const MD5Engine hashEngine;
+
+    for(size_t index = 0; index < entries.size();) {
+        if(Buffers != nullptr && entries[index]->ReadRange) {
+            auto& entry = *entries[index++];
+
+            const auto offset = startEntryData(entry);
+
+            if(!WriteStreamedData(entry))
+                return false;
+
+            entry.Offset = offset;
+            entry.StoredInPck = false;
+
+            if(Progress != nullptr)
+                Progress->Add(1, 0);
+
+            continue;
+        }
+
+        // Files are read in batches so that the MD5s of many files can be calculated at once
+        // NOTE: the godot packer only writes like 50k bytes at once, but we load whole files
+        // to memory
+        std::vector<std::string> batch;
+        uint64_t batchSize = 0;
+
+        for(size_t i = index; i < entries.size() && batch.size() < HASH_BATCH_FILES; ++i) {
+            const auto& entry = *entries[i];
+
+            if((Buffers != nullptr && entry.ReadRange) ||
+                (!batch.empty() && batchSize + entry.Size > HASH_BATCH_SIZE))
+                break;
+
+            try {
+                batch.push_back(entry.GetData());
+            } catch(const std::exception& e) {
+                std::cout << "ERROR: reading data of " << entry.Path << " failed: " << e.what()
+                          << "\n";
+                return false;
+            }
+
+            batchSize += entry.Size;
+
+            if(batch.back().size() != entry.Size) {
+                std::cout << "ERROR: file entry data source returned different amount of data "
+                          << "than the entry said its size is";
+                return false;
+            }
+        }
+
+        // Update MD5s (it is of the unencrypted data also for encrypted files)
+        std::vector<MD5Engine::Job> jobs;
+        jobs.reserve(batch.size());
+
+        for(size_t i = 0; i < batch.size(); ++i) {
+            jobs.push_back(
+                {batch[i].data(), batch[i].size(), entries[index + i]->MD5.data()});
+        }
+
+        hashEngine.Hash(jobs.data(), jobs.size());
+
+        for(const auto& data : batch) {
+            auto& entry = *entries[index++];
+
+            const auto offset = startEntryData(entry);
+
+            if(entry.Flags & PCK_FILE_ENCRYPTED) {
+                WriteEncrypted(data, entry.MD5);
+            } else {
+                File->write(data.data(), entry.Size); // NOLINT(*-narrowing-conversions)
+            }
+
+            // Offsets in memory are always absolute, the relative offset is calculated when
+            // writing the directory
+            entry.Offset = offset;
+
+            // The data sources still point to where the data was read from
+            entry.StoredInPck = false;
+
+            if(Progress != nullptr)
+                Progress->Add(1, entry.Size);
+        }
+    }
+
+    if(Progress != nullptr)
+        Progress->End();
+
+    return true;
+}
+
+void PckFile::WriteDirectory()
+{
+    DirectoryStart = File->tellg();
+
+    Write32(Contents.size());
+
+    if(Flags & PACK_DIR_ENCRYPTED) {
+        std::ostringstream directory;
+        WriteDirectoryEntries(directory);
+
+        const auto plain = directory.str();
+
+        std::array<uint8_t, 16> hash;
+        md5::md5_t(plain.data(), plain.size(), hash.data());
+
+        WriteEncrypted(plain, hash);
+    } else {
+        WriteDirectoryEntries(*File);
+    }
+
+    DirectoryEnd = File->tellg();
+}
+
+bool PckFile::SwitchToDirectory()
+{
+    CloseFile();
+
+    // Only switch to the new directory once it is fully on disk
+    if(!SyncFile(Path)) {
+        std::cout << "ERROR: flushing the pck data to disk failed\n";
+        return false;
+    }
+
+    File = std::make_unique<std::fstream>(
+        Path, std::ios::in | std::ios::out | std::ios::binary);
+    File->exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    File->seekg(static_cast<std::streamoff>(PckStart + HEADER_FLAGS_POSITION));
+    Write32(Flags | PCK_FILE_RELATIVE_BASE);
+    Write64(FileOffsetBase - PckStart);
+
+    DirectoryOffset = DirectoryStart - PckStart;
+    Write64(DirectoryOffset);
+
+    CloseFile();
+
+    if(!SyncFile(Path)) {
+        std::cout << "ERROR: flushing the pck header to disk failed\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PckFile::CheckEncryptionKey(const std::vector<ContainedFile*>& entries) const
+{
+    const bool encryptFiles = std::any_of(entries.begin(), entries.end(),
+        [](const ContainedFile* entry) { return entry->Flags & PCK_FILE_ENCRYPTED; });
+
+    if(!(Flags & PACK_DIR_ENCRYPTED) && !encryptFiles)
+        return true;
+
+    if(FormatVersion < 2) {
+        std::cout << "ERROR: encryption is not supported by pck version: " << FormatVersion
+                  << "\n";
+        return false;
+    }
+
+    if(!Cipher) {
+        std::cout << "ERROR: an encryption key is required to save encrypted data\n";
+        return false;
+    }
+
+    return true;
+}
+
+void PckFile::ResetPaddingReport()
+{
+    LastPaddingReport = PaddingReport();
+
+    if(AlignmentRules) {
+        LastPaddingReport.RulePadding.resize(AlignmentRules->GetRules().size());
+        LastPaddingReport.RuleFiles.resize(AlignmentRules->GetRules().size());
+    }
+}
+// ------------------------------------ //
+void PckFile::CloseFile()
+{
+    // Closing explicitly (unlike destroying the stream) throws if the data can't be written
+    if(auto* file = dynamic_cast<std::fstream*>(File.get()))
+        file->close();
+
+    File.reset();
+}
+// ------------------------------------ //
+bool PckFile::FindPckStart()
+{
+    PckStart = 0;
+
+    File->seekg(0, std::ios::end);
+    const auto fileSize = static_cast<uint64_t>(File->tellg());
+
+    // Pck size and magic
+    constexpr uint64_t trailerSize = 12;
+
+    if(fileSize < 4)
+        return false;
+
+    File->seekg(0);
+
+    if(Read32() == PCK_HEADER_MAGIC)
+        return true;
+
+    // Godot appends the pck to a self-contained executable followed by the size of the pck and
+    // the magic, so only the end of the file needs to be read
+    if(fileSize < trailerSize + 4)
+        return false;
+
+    File->seekg(static_cast<std::streamoff>(fileSize - trailerSize));
+
+    const auto embeddedSize = Read64();
+
+    if(Read32() != PCK_HEADER_MAGIC || embeddedSize > fileSize - trailerSize)
+        return false;
+
+    const auto start = fileSize - trailerSize - embeddedSize;
+    File->seekg(static_cast<std::streamoff>(start));
+
+    if(Read32() != PCK_HEADER_MAGIC)
+        return false;
+
+    PckStart = start;
+    return true;
+}
+
+bool PckFile::CopyEmbeddingExecutable()
+{
+    if(!DataReader) {
+        std::cout << "ERROR: the executable the pck is embedded in is no longer open\n";
+        return false;
+    }
+
+    std::vector<char> buffer(std::min<uint64_t>(PckStart, 1024 * 1024));
+
+    for(uint64_t position = 0; position < PckStart; position += buffer.size()) {
+        const auto amount = std::min<uint64_t>(buffer.size(), PckStart - position);
+
+        if(!DataReader->ReadAt(position, buffer.data(), amount)) {
+            std::cout << "ERROR: reading the executable the pck is embedded in failed\n";
+            return false;
+        }
+
+        File->write(buffer.data(), static_cast<std::streamsize>(amount));
+    }
+
+    return true;
+}
+// ------------------------------------ //
+std::vector<PckFile::ContainedFile*> PckFile::GetDataWriteOrder()
+{
+    std::vector<ContainedFile*> result;
+    result.reserve(Contents.size());
+
+    if(LayoutOrder.empty()) {
+        for(auto& [_, entry] : Contents)
+            result.push_back(&entry);
+
+        return result;
+    }
+
+    std::set<const ContainedFile*> placed;
+
+    for(const auto& path : LayoutOrder) {
+        const auto iter = Contents.find(path);
+
+        if(iter == Contents.end())
+            continue;
+
+        if(placed.insert(&iter->second).second)
+            result.push_back(&iter->second);
+    }
+
+    // Everything not in the profile goes after the profiled files
+    for(auto& [_, entry] : Contents) {
+        if(placed.count(&entry) == 0)
+            result.push_back(&entry);
+    }
+
+    return result;
+}
+
+size_t PckFile::SetLayoutOrder(std::vector<std::string> paths)
+{
+    LayoutOrder = std::move(paths);
+
+    size_t matched = 0;
+
+    for(const auto& path : LayoutOrder) {
+        if(Contents.count(path) > 0)
+            ++matched;
+    }
+
+    return matched;
+}
+// ------------------------------------ //
+void PckFile::AddFile(ContainedFile&& file)
+{
+    if(IncludeFilter && !IncludeFilter(file))
+        return;
+
+    Contents[file.Path] = std::move(file);
+}
+
+bool PckFile::RemoveFile(const std::string& path)
+{
+    return Contents.erase(path) > 0;
+}
+// ------------------------------------ //
+bool PckFile::AddFilesFromFilesystem(
+    const std::string& path, const std::string& stripPrefix, bool printAddedFiles /*= false*/)
+{
+    if(!std::filesystem::exists(path)) {
+        return false;
+    }
+
+    if(!std::filesystem::is_directory(path)) {
+        // Just a single file
+        AddSingleFile(path, PreparePckPath(path, stripPrefix), printAddedFiles);
+        return true;
+    }
+
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_directory())
+            continue;
+
+        const std::string entryPath = entry.path().string();
+
+        AddSingleFile(entryPath, PreparePckPath(entryPath, stripPrefix), printAddedFiles);
+    }
+
+    return true;
+}
+
+void PckFile::AddSingleFile(
+    std::string filesystemPath, std::string pckPath, bool printAddedFile /*= false*/)
+{
+    if(pckPath.empty())
+        throw std::runtime_error("path inside pck is empty to add file to");
+
+    ContainedFile file;
+
+    const auto size = std::filesystem::file_size(filesystemPath);
+
+    file.Path = std::move(pckPath);
+    file.Offset = -1;
+    file.Size = size;
+
+    // Seems like Godot pcks don't currently use hashes, so we don't need to do this
+    // file.MD5 = {0};
+
+    // TODO: might be nice to add an option to print out rejected files
+    if(IncludeFilter && !IncludeFilter(file))
+        return;
+
+    if(printAddedFile)
+        std::cout << "Adding " << filesystemPath << " as " << file.Path << "\n";
+
+    // Shared by both of the data reading callbacks
+    auto source = std::make_shared<const std::string>(std::move(filesystemPath));
 
-        // Update MD5 now that it is calculated
-        File->write(reinterpret_cast<const char*>(entry.MD5.data()), sizeof(entry.MD5));
+    file.ReadRange = [source, size](uint64_t start, char* buffer, size_t length) {
+        if(start + length > size)
+            return false;
+
+        ReadableFile reader;
+
+        if(!reader.Open(*source)) {
+            std::cout << "ERROR: opening for reading: " << *source << "\n";
+            return false;
+        }
+
+        return reader.ReadAt(start, buffer, length);
+    };
+
+    file.GetData = [source, size]() {
+        const auto& filesystemPath = *source;
+
+        std::ifstream reader(filesystemPath, std::ios::in | std::ios::binary);
+
+        if(!reader.good()) {
+            std::cout << "ERROR: opening for reading: " << filesystemPath << "\n";
+            throw std::runtime_error("can't read source file");
+        }
+
+        std::string data;
+        data.resize(size);
+
+        reader.read(data.data(), size);
+
+        return data;
+    };
+
+    auto key = file.Path;
+    Contents.insert_or_assign(std::move(key), std::move(file));
+}
+
+std::string PckFile::PreparePckPath(std::string path, const std::string& stripPrefix)
+{
+    if(stripPrefix.size() > 0 && path.find(stripPrefix) == 0) {
+        path = path.substr(stripPrefix.size());
+    }
+
+    // Fix Windows paths to make this work on Windows
+    for(size_t i = 0; i < path.size(); ++i) {
+        if(path[i] == '\\')
+            path[i] = '/';
+    }
+
+    while(path.size() > 0 && path.front() == '/') {
+        path.erase(path.begin());
     }
 
-    File->close();
+    if(NoResPrefix)
+        return path;
+
+    return GODOT_RES_PATH + path;
+}
+// ------------------------------------ //
+void PckFile::ChangePath(const std::string& path)
+{
     File.reset();
-    DataReader.reset();
+    // Actually needed for reading previous data
+    // DataReader.reset();
+
+    Path = path;
+}
+// ------------------------------------ //
+//! \param source The pck file to copy entries stored in it from, can be null
+static bool ExtractItem(const ExtractPlanner::Item& item, bool printExtracted,
+    BufferPool* buffers, const ReadableFile* source, ProgressReporter* progress,
+    Durability durability)
+{
+    const auto& [entry, targetFile] = item;
+
+    if(printExtracted) {
+        std::lock_guard<std::mutex> lock(OutputLock);
+        std::cout << "Extracting " << entry->Path << " to " << targetFile << "\n";
+    }
+
+    WritableFile writer;
+
+    if(!writer.Create(targetFile.string())) {
+        std::lock_guard<std::mutex> lock(OutputLock);
+        std::cout << "ERROR: opening file for writing: " << targetFile << "\n";
+        return false;
+    }
+
+    // A failed extract must not leave behind a partial file that looks like the extracted one
+    const auto discard = [&]() {
+        writer.Close();
+
+        std::error_code error;
+        std::filesystem::remove(targetFile, error);
+        return false;
+    };
+
+    // Allocating is an extra filesystem operation per file, which only pays off for keeping
+    // the files unfragmented
+    if(durability != Durability::Fast)
+        writer.Preallocate(entry->Size);
+
+    // Letting the kernel copy the data is fastest as it doesn't go through user space
+    if(source != nullptr && entry->StoredInPck && !(entry->Flags & PCK_FILE_ENCRYPTED) &&
+        entry->Size > 0) {
+        const auto copied = writer.CopyFrom(*source, entry->Offset, entry->Size);
+
+        if(copied == entry->Size) {
+            if(!writer.Close()) {
+                std::lock_guard<std::mutex> lock(OutputLock);
+                std::cout << "ERROR: writing failure to file: " << targetFile << "\n";
+                return discard();
+            }
+
+            if(progress != nullptr)
+                progress->Add(1, entry->Size);
+
+            return true;
+        }
+
+        // Start over with a normal copy if the kernel couldn't copy all of the data
+        if(copied > 0 && !writer.Create(targetFile.string())) {
+            std::lock_guard<std::mutex> lock(OutputLock);
+            std::cout << "ERROR: opening file for writing: " << targetFile << "\n";
+            return discard();
+        }
+    }
+
+    if(buffers != nullptr && entry->ReadRange) {
+        // The hash is the only way to notice that encrypted data was decrypted with a wrong
+        // key, so that is checked
+        const bool check = (entry->Flags & PCK_FILE_ENCRYPTED) &&
+                           std::any_of(entry->MD5.begin(), entry->MD5.end(),
+                               [](uint8_t value) { return value != 0; });
+
+        md5::md5_t hasher;
+
+        const bool streamed = StreamData(*entry, *buffers, [&](char* data, size_t size) {
+            if(check)
+                hasher.process(data, static_cast<unsigned>(size));
+
+            // Big files show progress while they are being written
+            if(progress != nullptr)
+                progress->Add(0, size);
+
+            return writer.Write(data, size);
+        });
+
+        if(!streamed || !writer.Close()) {
+            std::lock_guard<std::mutex> lock(OutputLock);
+            std::cout << "ERROR: reading or writing failed for file: " << targetFile << "\n";
+            return discard();
+        }
+
+        if(check) {
+            std::array<uint8_t, 16> hash;
+            hasher.finish(hash.data());
+
+            if(hash != entry->MD5) {
+                std::lock_guard<std::mutex> lock(OutputLock);
+                std::cout << "ERROR: decrypted file doesn't match its MD5 (wrong encryption "
+                             "key?): "
+                          << targetFile << "\n";
+                return discard();
+            }
+        }
+
+        if(progress != nullptr)
+            progress->Add(1, 0);
+
+        return true;
+    }
+
+    std::string data;
 
     try {
-        std::filesystem::remove(Path);
-    } catch(const std::filesystem::filesystem_error&) {
+        data = entry->GetData();
+    } catch(const std::exception& e) {
+        std::lock_guard<std::mutex> lock(OutputLock);
+        std::cout << "ERROR: reading data of " << entry->Path << " failed: " << e.what()
+                  << "\n";
+        return discard();
+    }
+
+    if(!writer.Write(data.data(), data.size()) || !writer.Close()) {
+        std::lock_guard<std::mutex> lock(OutputLock);
+        std::cout << "ERROR: writing failure to file: " << targetFile << "\n";
+        return discard();
+    }
+
+    if(progress != nullptr)
+        progress->Add(1, entry->Size);
+
+    return true;
+}
+
+//! \brief Waits until extracted files are on disk, with a single sync for all of them where
+//! the platform can do that
+static bool SyncExtracted(const std::vector<const ExtractPlanner::Item*>& items)
+{
+    if(items.empty())
+        return true;
+
+    if(WritableFile::CanSyncFilesystem()) {
+        WritableFile file;
+        return file.OpenForAppend(items.front()->Target.string()) && file.SyncFilesystem() &&
+               file.Close();
+    }
+
+    for(const auto* item : items) {
+        if(!SyncFile(item->Target.string()))
+            return false;
     }
 
-    std::filesystem::rename(tmpWrite, Path);
     return true;
 }
+
+bool PckFile::Extract(const std::string& outputPrefix, bool printExtracted,
+    ExtractJournal* journal, const std::function<bool(const ContainedFile&)>& selected)
+{
+    ExtractPlanner planner(outputPrefix);
+
+    for(const auto& [_, entry] : Contents) {
+        if(!selected || selected(entry))
+            planner.Add(entry);
+    }
+
+    if(!planner.CreateDirectories())
+        return false;
+
+    // Reading in the pck order avoids seeking back and forth
+    planner.SortByOffset();
+
+    std::vector<const ExtractPlanner::Item*> items;
+    items.reserve(planner.GetItems().size());
+
+    for(const auto& item : planner.GetItems()) {
+        if(journal != nullptr && journal->IsComplete(*item.Entry, item.Target))
+            continue;
+
+        items.push_back(&item);
+    }
+
+    if(journal != nullptr && items.size() < planner.GetItems().size()) {
+        std::cout << "Skipping " << planner.GetItems().size() - items.size()
+                  << " files completed by an earlier extraction\n";
+    }
+
+    if(DataReader)
+        DataReader->AdviseSequential();
+
+    if(Progress != nullptr) {
+        uint64_t totalSize = 0;
+
+        for(const auto* item : items)
+            totalSize += item->Entry->Size;
+
+        Progress->Begin("extract", items.size(), totalSize);
+    }
+
+    const ReadableFile* source = DataReader ? &*DataReader : nullptr;
+
+    // The journal relies on syncing the whole filesystem before it records files as complete,
+    // where that only syncs the journal itself each file is synced before it is recorded
+    const bool syncEachFile = journal != nullptr && !WritableFile::CanSyncFilesystem();
+
+    const auto extractItem = [&](const ExtractPlanner::Item& item) {
+        if(!ExtractItem(item, printExtracted, Buffers, source, Progress, DurabilityMode))
+            return false;
+
+        if(syncEachFile && !SyncFile(item.Target.string())) {
+            std::lock_guard<std::mutex> lock(OutputLock);
+            std::cout << "ERROR: flushing extracted file to disk failed: " << item.Target
+                      << "\n";
+            return false;
+        }
+
+        return journal == nullptr || journal->RecordComplete(*item.Entry);
+    };
+
+    bool success = true;
+
+    if(Pool != nullptr && Pool->GetThreadCount() > 1) {
+        std::atomic<bool> failed{false};
+
+        WorkerPool::TaskGroup group(*Pool);
+
+        for(const auto* item : items) {
+            group.Run([item, &failed, &extractItem]() {
+                if(failed)
+                    return;
+
+                if(!extractItem(*item))
+                    failed = true;
+            });
+        }
+
+        group.Wait();
+        success = !failed;
+    } else {
+        for(size_t i = 0; i < items.size(); ++i) {
+            // Let the OS start reading the next file while this one is written
+            if(DataReader && i + 1 < items.size()) {
+                const auto* next = items[i + 1]->Entry;
+                DataReader->AdviseWillNeed(next->Offset, next->Size);
+            }
+
+            if(!extractItem(*items[i])) {
+                success = false;
+                break;
+            }
+        }
+    }
+
+    if(Progress != nullptr)
+        Progress->End();
+
+    if(success && DurabilityMode == Durability::Safe && !SyncExtracted(items)) {
+        std::cout << "ERROR: flushing the extracted files to disk failed\n";
+        return false;
+    }
+
+    // Even after a failure the completed files are recorded so that a retry can skip them
+    if(journal != nullptr && !journal->Flush())
+        return false;
+
+    return success;
+}
+
 // ------------------------------------ //
-void PckFile::AddFile(ContainedFile&& file)
+PckFile::VerifyResult PckFile::Verify(
+    bool printVerified, const std::function<bool(const ContainedFile&)>& selected)
 {
-    if(IncludeFilter && !IncludeFilter(file))
-        return;
+    VerifyResult result;
+    std::mutex resultLock;
+
+    const auto checkHash = [&](const ContainedFile& entry,
+                               const std::array<uint8_t, 16>& hash) {
+        std::lock_guard<std::mutex> lock(resultLock);
+
+        if(hash != entry.MD5) {
+            result.Mismatched.push_back(entry.Path);
+        } else {
+            ++result.Verified;
+        }
+
+        if(printVerified) {
+            std::lock_guard<std::mutex> outputLock(OutputLock);
+            std::cout << (hash == entry.MD5 ? "OK " : "MISMATCH ") << entry.Path << "\n";
+        }
+    };
+
+    // Data that can't be read (like encrypted data with a wrong key) can't match its hash
+    const auto readFailed = [&](const ContainedFile& entry, const std::string& error) {
+        std::lock_guard<std::mutex> lock(resultLock);
+        result.Mismatched.push_back(entry.Path);
+
+        std::lock_guard<std::mutex> outputLock(OutputLock);
+        std::cout << "ERROR: reading data of " << entry.Path << " failed: " << error << "\n";
+
+        if(printVerified)
+            std::cout << "MISMATCH " << entry.Path << "\n";
+    };
+
+    HashContents("verify", checkHash, [&](const ContainedFile& entry) {
+        if(selected && !selected(entry))
+            return false;
+
+        // Files without a hash can't be checked
+        if(std::all_of(
+               entry.MD5.begin(), entry.MD5.end(), [](uint8_t value) { return value == 0; })) {
+            ++result.Unhashed;
+            return false;
+        }
+
+        return true;
+    }, readFailed);
+
+    std::sort(result.Mismatched.begin(), result.Mismatched.end());
+    return result;
+}
+
+void PckFile::HashContents(const char* operation, const HashCallback& hashed,
+    const std::function<bool(const ContainedFile&)>& selected, const FailureCallback& failed)
+{
+    const auto addResult = [&](const ContainedFile& entry, const std::array<uint8_t, 16>& hash,
+                               bool streamed) {
+        if(Progress != nullptr)
+            Progress->Add(1, streamed ? 0 : entry.Size);
+
+        hashed(entry, hash);
+    };
+
+    const auto addFailure = [&](const ContainedFile& entry, const std::string& error) {
+        if(Progress != nullptr)
+            Progress->Add(1, 0);
+
+        failed(entry, error);
+    };
+
+    const auto hashStreamed = [&](const ContainedFile& entry) {
+        md5::md5_t hasher;
+
+        const bool streamed = StreamData(entry, *Buffers, [&](char* data, size_t size) {
+            hasher.process(data, static_cast<unsigned>(size));
+
+            if(Progress != nullptr)
+                Progress->Add(0, size);
+
+            return true;
+        });
+
+        if(!streamed) {
+            if(!failed)
+                throw std::runtime_error("reading file data failed: " + entry.Path);
+
+            addFailure(entry, "reading file data failed");
+            return;
+        }
+
+        std::array<uint8_t, 16> hash;
+        static_assert(sizeof(hash) == MD5_SIZE);
+        hasher.finish(hash.data());
+
+        addResult(entry, hash, true);
+    };
+
+    const MD5Engine hashEngine;
+
+    const auto hashBatch = [&](const std::vector<const ContainedFile*>& batch) {
+        std::vector<std::string> data;
+        std::vector<std::array<uint8_t, 16>> hashes(batch.size());
+        std::vector<bool> read(batch.size(), false);
+        std::vector<MD5Engine::Job> jobs;
+
+        data.reserve(batch.size());
+        jobs.reserve(batch.size());
+
+        for(size_t i = 0; i < batch.size(); ++i) {
+            try {
+                data.push_back(batch[i]->GetData());
+            } catch(const std::exception& e) {
+                if(!failed)
+                    throw;
+
+                data.emplace_back();
+                addFailure(*batch[i], e.what());
+                continue;
+            }
+
+            read[i] = true;
+            jobs.push_back({data.back().data(), data.back().size(), hashes[i].data()});
+        }
+
+        hashEngine.Hash(jobs.data(), jobs.size());
+
+        for(size_t i = 0; i < batch.size(); ++i) {
+            if(read[i])
+                addResult(*batch[i], hashes[i], false);
+        }
+    };
+
+    // Files are read whole in batches so that the MD5s of many files can be calculated at
+    // once, unless the data needs to be streamed because of the memory limit
+    std::vector<const ContainedFile*> streamed;
+    std::vector<std::vector<const ContainedFile*>> batches;
+    uint64_t batchSize = 0;
+
+    for(const auto& [_, entry] : Contents) {
+        if(selected && !selected(entry))
+            continue;
+
+        if(Buffers != nullptr && entry.ReadRange) {
+            streamed.push_back(&entry);
+            continue;
+        }
+
+        if(batches.empty() || batches.back().size() >= HASH_BATCH_FILES ||
+            batchSize + entry.Size > HASH_BATCH_SIZE) {
+            batches.emplace_back();
+            batchSize = 0;
+        }
+
+        batches.back().push_back(&entry);
+        batchSize += entry.Size;
+    }
+
+    if(Progress != nullptr) {
+        size_t totalFiles = streamed.size();
+        uint64_t totalSize = 0;
+
+        for(const auto* entry : streamed)
+            totalSize += entry->Size;
+
+        for(const auto& batch : batches) {
+            totalFiles += batch.size();
+
+            for(const auto* entry : batch)
+                totalSize += entry->Size;
+        }
+
+        Progress->Begin(operation, totalFiles, totalSize);
+    }
+
+    if(Pool != nullptr && Pool->GetThreadCount() > 1) {
+        WorkerPool::TaskGroup group(*Pool);
+
+        for(const auto* entry : streamed) {
+            group.Run([&hashStreamed, entry]() { hashStreamed(*entry); });
+        }
+
+        for(const auto& batch : batches) {
+            group.Run([&hashBatch, &batch]() { hashBatch(batch); });
+        }
+
+        group.Wait();
+    } else {
+        for(const auto* entry : streamed)
+            hashStreamed(*entry);
+
+        for(const auto& batch : batches)
+            hashBatch(batch);
+    }
+
+    if(Progress != nullptr)
+        Progress->End();
+}
+// ------------------------------------ //
+void PckFile::PrintFileList(bool printHashes, bool includeSize /*= true*/)
+{
+    OutputBuffer output(std::cout);
+
+    for(const auto& [path, entry] : Contents) {
+        output.Append(path);
+
+        if(includeSize) {
+            output.Append(" size: ");
+            output.AppendNumber(entry.Size);
+        }
+
+        if(printHashes) {
+            output.Append(" md5: ");
+            output.AppendHex(entry.MD5.data(), entry.MD5.size());
+        }
+
+        output.Append('\n');
+        output.EndRecord();
+    }
+}
+
+void PckFile::WriteFileList(std::ostream& stream, ListFormat format)
+{
+    OutputBuffer output(stream);
+
+    if(format == ListFormat::CSV)
+        output.Append("path,offset,size,flags,md5\n");
+
+    for(const auto& [path, entry] : Contents) {
+        if(format == ListFormat::NDJSON) {
+            output.Append("{\"path\":");
+            output.AppendJSONString(path);
+            output.Append(",\"offset\":");
+            output.AppendNumber(entry.Offset);
+            output.Append(",\"size\":");
+            output.AppendNumber(entry.Size);
+            output.Append(",\"flags\":");
+            output.AppendNumber(entry.Flags);
+            output.Append(",\"md5\":\"");
+            output.AppendHex(entry.MD5.data(), entry.MD5.size());
+            output.Append("\"}\n");
+        } else {
+            output.AppendCSVField(path);
+            output.Append(',');
+            output.AppendNumber(entry.Offset);
+            output.Append(',');
+            output.AppendNumber(entry.Size);
+            output.Append(',');
+            output.AppendNumber(entry.Flags);
+            output.Append(',');
+            output.AppendHex(entry.MD5.data(), entry.MD5.size());
+            output.Append('\n');
+        }
 
-    Contents[file.Path] = std::move(file);
+        output.EndRecord();
+    }
 }
 // ------------------------------------ //
-bool PckFile::AddFilesFromFilesystem(
-    const std::string& path, const std::string& stripPrefix, bool printAddedFiles /*= false*/)
+std::string PckFile::ReadContainedFileContents(uint64_t offset, uint64_t size)
 {
-    if(!std::filesystem::exists(path)) {
-        return false;
-    }
-
-    if(!std::filesystem::is_directory(path)) {
-        // Just a single file
-        AddSingleFile(path, PreparePckPath(path, stripPrefix), printAddedFiles);
-        return true;
+    if(!DataReader) {
+        throw std::runtime_error("Data reader is no longer open to read file contents");
     }
 
-    for(const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
-        if(entry.is_directory())
-            continue;
-
-        const std::string entryPath = entry.path().string();
+    std::string result;
+    result.resize(size);
 
-        AddSingleFile(entryPath, PreparePckPath(entryPath, stripPrefix), printAddedFiles);
+    if(!DataReader->ReadAt(offset, result.data(), size)) {
+        throw std::runtime_error("reading file entry content failed (specified offset or data "
+                                 "length is too large, pck may be corrupt or malformed)");
     }
 
-    return true;
+    return result;
 }
 
-void PckFile::AddSingleFile(const std::string& filesystemPath, const std::string& pckPath,
-    bool printAddedFile /*= false*/)
+std::string PckFile::ReadEncryptedContents(uint64_t offset, uint64_t size)
 {
-    if(pckPath.empty())
-        throw std::runtime_error("path inside pck is empty to add file to");
+    if(!DataReader) {
+        throw std::runtime_error("Data reader is no longer open to read file contents");
+    }
 
-    ContainedFile file;
+    if(!Cipher)
+        throw std::runtime_error("file is encrypted, but no encryption key is set");
 
-    const auto size = std::filesystem::file_size(filesystemPath);
+    uint8_t header[ENCRYPTED_HEADER_SIZE];
 
-    file.Path = pckPath;
-    file.Offset = -1;
-    file.Size = size;
+    if(!DataReader->ReadAt(offset, reinterpret_cast<char*>(header), sizeof(header)))
+        throw std::runtime_error("reading encrypted file header failed");
 
-    // Seems like Godot pcks don't currently use hashes, so we don't need to do this
-    // file.MD5 = {0};
+    std::array<uint8_t, 16> expectedHash;
+    uint64_t length;
+    AESCipher::IV iv;
 
-    file.GetData = [filesystemPath, size]() {
-        std::ifstream reader(filesystemPath, std::ios::in | std::ios::binary);
+    std::memcpy(expectedHash.data(), header, expectedHash.size());
+    std::memcpy(&length, header + 16, sizeof(length));
+    std::memcpy(iv.data(), header + 24, iv.size());
 
-        if(!reader.good()) {
-            std::cout << "ERROR: opening for reading: " << filesystemPath << "\n";
-            throw std::runtime_error("can't read source file");
-        }
+    if(length != size)
+        throw std::runtime_error("encrypted file length doesn't match the pck directory");
 
-        std::string data;
-        data.resize(size);
+    const auto paddedSize = GetEncryptedSize(size) - ENCRYPTED_HEADER_SIZE;
 
-        reader.read(data.data(), size);
+    std::string result;
+    result.resize(paddedSize);
 
-        return data;
-    };
+    auto* data = result.data();
 
-    // TODO: might be nice to add an option to print out rejected files
-    if(IncludeFilter && !IncludeFilter(file))
-        return;
+    // Decrypting and hashing each chunk right after reading it keeps the data in the cache
+    md5::md5_t hasher;
 
-    if(printAddedFile)
-        std::cout << "Adding " << filesystemPath << " as " << pckPath << "\n";
+    for(uint64_t position = 0; position < paddedSize; position += ENCRYPTION_CHUNK_SIZE) {
+        const auto amount = std::min<uint64_t>(ENCRYPTION_CHUNK_SIZE, paddedSize - position);
 
-    Contents[pckPath] = file;
-}
+        if(!DataReader->ReadAt(offset + ENCRYPTED_HEADER_SIZE + position, data + position,
+               amount)) {
+            throw std::runtime_error("reading encrypted file content failed (pck may be "
+                                     "corrupt or malformed)");
+        }
 
-std::string PckFile::PreparePckPath(std::string path, const std::string& stripPrefix)
-{
-    if(stripPrefix.size() > 0 && path.find(stripPrefix) == 0) {
-        path = path.substr(stripPrefix.size());
-    }
+        Cipher->DecryptCFB(reinterpret_cast<uint8_t*>(data + position), amount, iv);
 
-    // Fix Windows paths to make this work on Windows
-    for(size_t i = 0; i < path.size(); ++i) {
-        if(path[i] == '\\')
-            path[i] = '/';
+        // The padding is not part of the hash
+        if(position < size)
+            hasher.process(data + position, std::min<uint64_t>(amount, size - position));
     }
 
-    while(path.size() > 0 && path.front() == '/') {
-        path.erase(path.begin());
-    }
+    std::array<uint8_t, 16> hash;
+    hasher.finish(hash.data());
 
-    if(NoResPrefix)
-        return path;
+    if(hash != expectedHash) {
+        throw std::runtime_error("decrypted file doesn't match its MD5, the file is corrupt "
+                                 "or the encryption key is wrong");
+    }
 
-    return GODOT_RES_PATH + path;
+    result.resize(size);
+    return result;
 }
-// ------------------------------------ //
-void PckFile::ChangePath(const std::string& path)
-{
-    File.reset();
-    // Actually needed for reading previous data
-    // DataReader.reset();
 
-    Path = path;
-}
-// ------------------------------------ //
-bool PckFile::Extract(const std::string& outputPrefix, bool printExtracted)
+bool PckFile::ReadEncryptedRange(
+    uint64_t offset, uint64_t size, uint64_t start, char* buffer, size_t length)
 {
-    const auto outputBase = std::filesystem::path(outputPrefix);
-
-    for(const auto& [path, entry] : Contents) {
-        std::string processedPath = path.find(GODOT_RES_PATH) == 0 ?
-                                        path.substr(std::string_view(GODOT_RES_PATH).size()) :
-                                        path;
-
-        // Remove any starting slashes
-        while(processedPath.size() > 0 && processedPath.front() == '/')
-            processedPath.erase(processedPath.begin());
-
-        const auto fsPath = std::filesystem::path(processedPath);
+    if(!DataReader || !Cipher || start + length > size)
+        return false;
 
-        const auto filename = fsPath.filename();
-        const auto baseFolder = fsPath.parent_path();
+    const auto dataStart = offset + ENCRYPTED_HEADER_SIZE;
 
-        const auto targetFolder = outputBase / baseFolder;
-        const auto targetFile = targetFolder / filename;
+    // Decryption starts from the block containing the start, its bytes before the start are
+    // decrypted and thrown away
+    auto position = start / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+    const auto skip = static_cast<size_t>(start - position);
 
-        if(printExtracted)
-            std::cout << "Extracting " << path << " to " << targetFile << "\n";
+    // CFB feeds back the previous ciphertext block, so decryption can start at any block
+    AESCipher::IV iv;
 
-        if(!targetFolder.empty()) {
-            try {
-                std::filesystem::create_directories(targetFolder);
-            } catch(const std::filesystem::filesystem_error& e) {
-                std::cout << "ERROR: creating target directory (" << targetFolder
-                          << "): " << e.what() << "\n";
-                return false;
-            }
+    if(position == 0) {
+        if(!DataReader->ReadAt(offset + 24, reinterpret_cast<char*>(iv.data()), iv.size()))
+            return false;
+    } else {
+        if(!DataReader->ReadAt(dataStart + position - AES_BLOCK_SIZE,
+               reinterpret_cast<char*>(iv.data()), iv.size())) {
+            return false;
         }
-        std::ofstream writer(
-            targetFile.string(), std::ios::trunc | std::ios::out | std::ios::binary);
+    }
 
-        if(!writer.good()) {
-            std::cout << "ERROR: opening file for writing: " << targetFile << "\n";
+    // Blocks only partially in the range (the first and the last) are decrypted separately,
+    // the last one including its padding
+    const auto readPartialBlock = [&](size_t from, size_t amount) {
+        uint8_t block[AES_BLOCK_SIZE];
+
+        if(!DataReader->ReadAt(
+               dataStart + position, reinterpret_cast<char*>(block), sizeof(block))) {
             return false;
         }
 
-        const auto data = entry.GetData();
+        Cipher->DecryptCFB(block, sizeof(block), iv);
+        std::memcpy(buffer, block + from, amount);
 
-        writer.write(data.data(), data.size());
+        position += AES_BLOCK_SIZE;
+        buffer += amount;
+        length -= amount;
+        return true;
+    };
 
-        if(!writer.good()) {
-            std::cout << "ERROR: writing failure to file\n";
-            return false;
-        }
+    if(skip > 0 && length > 0 &&
+        !readPartialBlock(skip, std::min(length, AES_BLOCK_SIZE - skip))) {
+        return false;
     }
 
-    return true;
-}
-// ------------------------------------ //
-void PckFile::PrintFileList(bool printHashes, bool includeSize /*= true*/)
-{
-    char signatureTempBuffer[MD5_STRING_SIZE];
-
-    for(const auto& [path, entry] : Contents) {
-        std::cout << path;
-        if(includeSize)
-            std::cout << " size: " << entry.Size;
+    const auto fullBlocks = length / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
 
-        // TODO: flag to also verify the hashes?
-        if(printHashes) {
-            static_assert(sizeof(entry.MD5) == MD5_SIZE);
-            md5::sig_to_string(entry.MD5.data(), signatureTempBuffer, MD5_STRING_SIZE);
+    if(fullBlocks > 0) {
+        if(!DataReader->ReadAt(dataStart + position, buffer, fullBlocks))
+            return false;
 
-            std::cout << " md5: "
-                      << std::string_view(
-                             signatureTempBuffer, std::strlen(signatureTempBuffer));
-        }
+        Cipher->DecryptCFB(reinterpret_cast<uint8_t*>(buffer), fullBlocks, iv);
 
-        std::cout << "\n";
+        position += fullBlocks;
+        buffer += fullBlocks;
+        length -= fullBlocks;
     }
+
+    if(length > 0 && !readPartialBlock(0, length))
+        return false;
+
+    return true;
 }
-// ------------------------------------ //
-std::string PckFile::ReadContainedFileContents(uint64_t offset, uint64_t size)
+
+void PckFile::SetDataSource(ContainedFile& entry)
 {
-    if(!DataReader) {
-        throw std::runtime_error("Data reader is no longer open to read file contents");
-    }
+    entry.StoredInPck = true;
 
-    std::string result;
-    result.resize(size);
+    if(entry.Flags & PCK_FILE_ENCRYPTED) {
+        entry.GetData = [offset = entry.Offset, size = entry.Size, this]() {
+            return ReadEncryptedContents(offset, size);
+        };
+
+        entry.ReadRange = [offset = entry.Offset, size = entry.Size, this](
+                              uint64_t start, char* buffer, size_t length) {
+            return ReadEncryptedRange(offset, size, start, buffer, length);
+        };
+    } else {
+        entry.GetData = [offset = entry.Offset, size = entry.Size, this]() {
+            return ReadContainedFileContents(offset, size);
+        };
 
-    DataReader->seekg(offset);
-    DataReader->read(result.data(), size);
+        entry.ReadRange = [offset = entry.Offset, size = entry.Size, this](
+                              uint64_t start, char* buffer, size_t length) {
+            if(!DataReader || start + length > size)
+                return false;
 
-    if(!DataReader->good()) {
-        throw std::runtime_error("reading file entry content failed (specified offset or data "
-                                 "length is too large, pck may be corrupt or malformed)");
+            return DataReader->ReadAt(offset + start, buffer, length);
+        };
     }
-
-    return result;
 }
 // ------------------------------------ //
 void PckFile::SetGodotVersion(uint32_t major, uint32_t minor, uint32_t patch)
@@ -595,6 +2169,36 @@ void PckFile::SetNoResPrefix(bool noResPrefix)
 {
     NoResPrefix = noResPrefix;
 }
+
+void PckFile::SetEncryptDirectory(bool encrypt)
+{
+    if(encrypt) {
+        Flags |= PACK_DIR_ENCRYPTED;
+    } else {
+        Flags &= ~PACK_DIR_ENCRYPTED;
+    }
+}
+
+size_t PckFile::SetEncryptedFiles(const std::function<bool(const ContainedFile&)>& predicate)
+{
+    size_t matched = 0;
+
+    // The data source is not changed, so the data is still read the way it was loaded
+    for(auto& [_, entry] : Contents) {
+        if(!predicate(entry))
+            continue;
+
+        // Data stored unencrypted needs to be written again
+        if(!(entry.Flags & PCK_FILE_ENCRYPTED)) {
+            entry.Flags |= PCK_FILE_ENCRYPTED;
+            entry.StoredInPck = false;
+        }
+
+        ++matched;
+    }
+
+    return matched;
+}
 // ------------------------------------ //
 uint32_t PckFile::Read32()
 {
@@ -622,16 +2226,224 @@ void PckFile::Write64(uint64_t value)
     File->write(reinterpret_cast<char*>(&value), sizeof(value));
 }
 
-void PckFile::PadToAlignment()
+uint32_t PckFile::Read32(std::istream& stream)
 {
-    if(Alignment <= 0)
-        return;
+    uint32_t value;
+
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+uint64_t PckFile::Read64(std::istream& stream)
+{
+    uint64_t value;
+
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+void PckFile::Write32(std::ostream& stream, uint32_t value)
+{
+    stream.write(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+void PckFile::Write64(std::ostream& stream, uint64_t value)
+{
+    stream.write(reinterpret_cast<char*>(&value), sizeof(value));
+}
+// ------------------------------------ //
+bool PckFile::ReadEncryptedBlock(std::string& output)
+{
+    std::array<uint8_t, 16> expectedHash;
+    AESCipher::IV iv;
+
+    File->read(reinterpret_cast<char*>(expectedHash.data()), expectedHash.size());
+    const auto length = Read64();
+    File->read(reinterpret_cast<char*>(iv.data()), iv.size());
+
+    // Sanity check to not allocate a huge buffer if the length is garbage
+    if(length > std::filesystem::file_size(Path)) {
+        std::cout << "ERROR: encrypted block length is larger than the pck\n";
+        return false;
+    }
+
+    output.resize(GetEncryptedSize(length) - ENCRYPTED_HEADER_SIZE);
+    File->read(output.data(), static_cast<std::streamsize>(output.size()));
+
+    auto* data = reinterpret_cast<uint8_t*>(output.data());
+    Cipher->DecryptCFB(data, output.size(), iv);
+
+    output.resize(length);
+
+    std::array<uint8_t, 16> hash;
+    md5::md5_t(output.data(), output.size(), hash.data());
+
+    if(hash != expectedHash) {
+        std::cout << "ERROR: decrypted data doesn't match its MD5, the encryption key is "
+                     "probably wrong\n";
+        return false;
+    }
+
+    return true;
+}
+
+void PckFile::WriteEncrypted(const std::string& data, const std::array<uint8_t, 16>& hash)
+{
+    auto iv = GenerateIV();
+
+    File->write(reinterpret_cast<const char*>(hash.data()), hash.size());
+    Write64(data.size());
+    File->write(reinterpret_cast<const char*>(iv.data()), iv.size());
+
+    std::vector<uint8_t> buffer(std::min<size_t>(
+        ENCRYPTION_CHUNK_SIZE, GetEncryptedSize(data.size()) - ENCRYPTED_HEADER_SIZE));
+
+    for(size_t position = 0; position < data.size(); position += buffer.size()) {
+        const auto amount = std::min(buffer.size(), data.size() - position);
+
+        std::memcpy(buffer.data(), data.data() + position, amount);
+
+        // The last block is padded with zeros
+        const auto padded = (amount + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+        std::memset(buffer.data() + amount, 0, padded - amount);
+
+        Cipher->EncryptCFB(buffer.data(), padded, iv);
+
+        File->write(reinterpret_cast<const char*>(buffer.data()),
+            static_cast<std::streamsize>(padded));
+    }
+}
+
+bool PckFile::WriteStreamedData(ContainedFile& entry)
+{
+    const bool encrypt = entry.Flags & PCK_FILE_ENCRYPTED;
+    const auto headerPosition = File->tellg();
+
+    AESCipher::IV iv;
+
+    if(encrypt) {
+        iv = GenerateIV();
+
+        // The MD5 is filled in once all the data has been hashed
+        WriteZeros(16);
+        Write64(entry.Size);
+        File->write(reinterpret_cast<const char*>(iv.data()), iv.size());
+    }
+
+    // Data decrypted with a wrong key is only noticed by its hash, which must match the one
+    // stored with the encrypted data
+    const bool check = encrypt && entry.StoredInPck &&
+                       std::any_of(entry.MD5.begin(), entry.MD5.end(),
+                           [](uint8_t value) { return value != 0; });
+
+    md5::md5_t hasher;
+
+    const bool streamed = StreamData(entry, *Buffers, [&](char* data, size_t size) {
+        hasher.process(data, static_cast<unsigned>(size));
+
+        if(Progress != nullptr)
+            Progress->Add(0, size);
+
+        if(!encrypt) {
+            File->write(data, static_cast<std::streamsize>(size));
+            return true;
+        }
+
+        // Buffer sizes are a multiple of the AES block so the padding fits
+        const auto padded = (size + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+        std::memset(data + size, 0, padded - size);
+
+        Cipher->EncryptCFB(reinterpret_cast<uint8_t*>(data), padded, iv);
+        File->write(data, static_cast<std::streamsize>(padded));
+        return true;
+    });
+
+    if(!streamed) {
+        std::cout << "ERROR: reading data of file failed: " << entry.Path << "\n";
+        return false;
+    }
+
+    std::array<uint8_t, 16> hash;
+    hasher.finish(hash.data());
+
+    if(check && hash != entry.MD5) {
+        std::cout << "ERROR: decrypted file doesn't match its MD5 (wrong encryption key?): "
+                  << entry.Path << "\n";
+        return false;
+    }
+
+    entry.MD5 = hash;
+
+    if(encrypt) {
+        const auto end = File->tellg();
+
+        File->seekg(headerPosition);
+        File->write(reinterpret_cast<const char*>(entry.MD5.data()), entry.MD5.size());
+        File->seekg(end);
+    }
+
+    return true;
+}
+
+void PckFile::WriteDirectoryEntries(std::ostream& stream)
+{
+    static const std::array<char, 16> nulls = {0};
+
+    for(const auto& [_, entry] : Contents) {
+        const size_t padding = GetPathPadding(entry.Path.size());
+        const size_t pathToWriteSize = entry.Path.size() + padding;
+
+        Write32(stream, pathToWriteSize);
+        stream.write(entry.Path.data(), entry.Path.size());
+
+        // Padding null bytes
+        for(size_t left = padding; left > 0;) {
+            const auto amount = std::min(left, nulls.size());
+            stream.write(nulls.data(), static_cast<std::streamsize>(amount));
+            left -= amount;
+        }
+
+        // Offsets are relative to the files block in newer formats
+        Write64(stream, entry.Offset - FileOffsetBase);
+        Write64(stream, entry.Size);
+
+        stream.write(reinterpret_cast<const char*>(entry.MD5.data()), sizeof(entry.MD5));
+
+        if(FormatVersion >= 2) {
+            Write32(stream, entry.Flags);
+        }
+    }
+}
+
+uint64_t PckFile::PadToAlignment()
+{
+    return PadTo(Alignment);
+}
+
+uint64_t PckFile::PadTo(uint64_t alignment)
+{
+    if(alignment <= 1)
+        return 0;
+
+    const auto remainder = static_cast<uint64_t>(File->tellg()) % alignment;
+
+    if(remainder == 0)
+        return 0;
+
+    const auto padding = alignment - remainder;
+
+    WriteZeros(padding);
+    return padding;
+}
+
+void PckFile::WriteZeros(uint64_t count)
+{
+    // Written as bulk runs of zeros
+    static const std::array<char, 4096> zeros = {0};
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "LoopDoesntUseConditionVariableInspection"
-    while((File->tellg() % Alignment) != 0) {
-        uint8_t null = 0;
-        File->write(reinterpret_cast<const char*>(&null), sizeof(null));
+    for(uint64_t left = count; left > 0;) {
+        const auto amount = std::min<uint64_t>(left, zeros.size());
+        File->write(zeros.data(), static_cast<std::streamsize>(amount));
+        left -= amount;
     }
-#pragma clang diagnostic pop
 }
@@ -2,16 +2,31 @@
 
 #include "Define.h"
 
+#include "Encryption.h"
+#include "PlatformFile.h"
+
 #include <array>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <ostream>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 namespace pcktool {
 
+class AlignmentPolicy;
+class BufferPool;
+class ExtractJournal;
+class PckIndex;
+class ProgressReporter;
+class WorkerPool;
+
 // Pck magic
 constexpr uint32_t PCK_HEADER_MAGIC = 0x43504447;
 constexpr uint32_t PACK_DIR_ENCRYPTED = 1 << 0;
@@ -30,6 +45,26 @@ constexpr int GODOT_4_PCK_VERSION = 2;
 constexpr int GODOT_4_5_PCK_VERSION = 3;
 constexpr int GODOT_4_7_PCK_VERSION = 4;
 
+//! \brief Machine readable formats for listing pck contents
+enum class ListFormat {
+    //! One JSON object per line
+    NDJSON,
+    //! Comma separated values with a header line
+    CSV
+};
+
+//! \brief How much saving and extracting does to make sure that written data survives a crash
+//! or power loss
+enum class Durability {
+    //! Nothing is synced, the OS writes the data to disk when it wants to
+    Normal,
+    //! Like Normal but with bigger write buffers and fewer filesystem operations
+    Fast,
+    //! A saved pck is synced before it atomically replaces the old file and the rename is
+    //! synced, extracted files are synced together once all are written
+    Safe
+};
+
 //! \brief A single pck file object. Handles reading and writing
 //!
 //! Probably only works on little endian systems
@@ -44,6 +79,99 @@ public:
         std::string Salt;
 
         std::function<std::string()> GetData;
+
+        //! \brief Reads a part of the (decrypted) data, used to stream large files without
+        //! reading them whole into memory. Not set if only GetData is available.
+        std::function<bool(uint64_t offset, char* buffer, size_t size)> ReadRange;
+
+        //! \brief True when the data is stored at Offset in the loaded pck file (encrypted if
+        //! the flags say so). False for data that still needs to be written to the pck.
+        bool StoredInPck = false;
+
+        //! \brief Size of the data in the pck file, encrypted data has a header and padding
+        [[nodiscard]] uint64_t GetStoredSize() const
+        {
+            return (Flags & PCK_FILE_ENCRYPTED) ? GetEncryptedSize(Size) : Size;
+        }
+    };
+
+    //! \brief Checks done on the raw directory data while loading, before an entry is created
+    //!
+    //! This must only reject entries that the include filter would also reject. It makes
+    //! loading a small part of a big pck cheap as the filter runs only on the candidates.
+    struct EntryPrefilter {
+        struct PathLiteral {
+            std::string Text;
+
+            //! When true the path must start with Text, otherwise contain it
+            bool Anchored = false;
+        };
+
+        //! A path must match one of these, empty accepts all paths
+        std::vector<PathLiteral> PathLiterals;
+
+        uint64_t MinSize = 0;
+        uint64_t MaxSize = std::numeric_limits<uint64_t>::max();
+
+        [[nodiscard]] bool Accepts(std::string_view path, uint64_t size) const
+        {
+            if(size < MinSize || size > MaxSize)
+                return false;
+
+            if(PathLiterals.empty())
+                return true;
+
+            for(const auto& literal : PathLiterals) {
+                if(literal.Anchored ? path.substr(0, literal.Text.size()) == literal.Text :
+                                      path.find(literal.Text) != std::string_view::npos) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    };
+
+    struct VerifyResult {
+        size_t Verified = 0;
+
+        //! Files with no stored hash that couldn't be checked
+        size_t Unhashed = 0;
+
+        std::vector<std::string> Mismatched;
+    };
+
+    using HashCallback =
+        std::function<void(const ContainedFile& file, const std::array<uint8_t, 16>& hash)>;
+
+    using FailureCallback =
+        std::function<void(const ContainedFile& file, const std::string& error)>;
+
+    //! \brief Info about how much alignment padding was written by the last save
+    struct PaddingReport {
+        //! Padding written before files matching each alignment policy rule
+        std::vector<uint64_t> RulePadding;
+        std::vector<size_t> RuleFiles;
+
+        //! Padding before files using the default alignment
+        uint64_t DefaultPadding = 0;
+        size_t DefaultFiles = 0;
+
+        //! Padding between the directory and the first file
+        uint64_t DirectoryPadding = 0;
+
+        //! Total size of the file data (without padding)
+        uint64_t DataSize = 0;
+
+        [[nodiscard]] uint64_t GetTotalPadding() const
+        {
+            uint64_t total = DefaultPadding + DirectoryPadding;
+
+            for(const auto padding : RulePadding)
+                total += padding;
+
+            return total;
+        }
     };
 
 public:
@@ -56,22 +184,89 @@ public:
 
     bool Load();
 
+    //! \brief Loads the pck info and directory from an already opened sidecar index
+    bool LoadFromIndex(const PckIndex& index);
+
+    //! \brief Loads a pck from memory instead of the Path file
+    //!
+    //! The data is kept by this object and file data is read straight from it. Path is then
+    //! only used in messages and by Save. The sidecar index is not used.
+    bool LoadFromMemory(std::string data);
+
     //! \brief Saves the entire pack over the Path file
     bool Save();
 
+    //! \brief Saves the entire pack into memory, without any files
+    //!
+    //! Space for the output is reserved up front from the layout. Like after Save the entries
+    //! then have their offsets in the written pck, but their data is still read from where it
+    //! was loaded from, so this can be called again.
+    bool SaveToMemory(std::string& output);
+
+    //! \returns True if UpdateInPlace can be used. That needs a loaded pck in a format with
+    //! a directory offset in the header (Godot 4.5 and newer) that is not embedded.
+    [[nodiscard]] bool CanUpdateInPlace() const;
+
+    //! \brief Saves changes by appending the new file data and a new directory to the loaded
+    //! pck file, which is much faster than Save for small changes to a big pck
+    //!
+    //! The replaced file data and the old directory are left in the file as unused space. The
+    //! header is switched to the new directory only after everything else is on disk, so an
+    //! interrupted update leaves the pck as it was. Layout and alignment options only apply to
+    //! the newly written data.
+    bool UpdateInPlace();
+
+    //! \brief Moves the file data in place over the unused space left by UpdateInPlace and
+    //! truncates the file, which doesn't need disk space for a second copy like Save does
+    //!
+    //! Has the same requirements as UpdateInPlace and there can't be unsaved changes. An
+    //! interrupted compaction leaves the pck broken.
+    //! \param reclaimed Set to the number of bytes the file shrank by
+    bool Compact(uint64_t& reclaimed);
+
+    //! \returns True if some entries have data that is not written to the pck file yet
+    [[nodiscard]] bool HasUnwrittenData() const;
+
     //! \brief Extracts the read contents to the outputPrefix
-    bool Extract(const std::string& outputPrefix, bool printExtracted);
+    //! \param journal If set, files completed by an earlier run are skipped and completed
+    //! files are recorded in it
+    //! \param selected If set, only the entries it returns true for are extracted
+    bool Extract(const std::string& outputPrefix, bool printExtracted,
+        ExtractJournal* journal = nullptr,
+        const std::function<bool(const ContainedFile&)>& selected = nullptr);
+
+    //! \brief Checks the contained file data against the hashes in the directory
+    //! \param selected If set, only the entries it returns true for are checked
+    VerifyResult Verify(bool printVerified,
+        const std::function<bool(const ContainedFile&)>& selected = nullptr);
+
+    //! \brief Calculates the MD5 of the data of the contained files, in parallel when there is
+    //! a worker pool
+    //! \param operation Name of the operation for the progress reporter
+    //! \param hashed Called with each file and the hash of its data, from multiple threads
+    //! \param selected If set, only the entries it returns true for are hashed
+    //! \param failed If set, called (instead of throwing) for files whose data can't be read
+    void HashContents(const char* operation, const HashCallback& hashed,
+        const std::function<bool(const ContainedFile&)>& selected = nullptr,
+        const FailureCallback& failed = nullptr);
 
     void PrintFileList(bool printHashes, bool includeSize = true);
 
+    //! \brief Writes the file list with the path, offset, size, flags and MD5 of each file
+    void WriteFileList(std::ostream& stream, ListFormat format);
+
     void AddFile(ContainedFile&& file);
 
+    //! \brief Removes an entry, the change is written by the next save
+    //! \returns False if there is no entry with the path
+    bool RemoveFile(const std::string& path);
+
     //! \brief Adds recursively files from path to this pck
     bool AddFilesFromFilesystem(
         const std::string& path, const std::string& stripPrefix, bool printAddedFiles = false);
 
-    void AddSingleFile(const std::string& filesystemPath, const std::string& pckPath,
-        bool printAddedFile = false);
+    void AddSingleFile(
+        std::string filesystemPath, std::string pckPath, bool printAddedFile = false);
 
     //! \note Automatically converts \'s in the path to /'s
     std::string PreparePckPath(std::string path, const std::string& stripPrefix);
@@ -87,19 +282,122 @@ public:
     void SetGodotVersion(uint32_t major, uint32_t minor, uint32_t patch);
     void SetNoResPrefix(bool noResPrefix);
 
+    //! \brief Sets the order file data is written in when saving
+    //!
+    //! Files in the list are placed contiguously in the given order before all other files,
+    //! for example to match the order a game reads resources in when it starts. Paths not in
+    //! the pck are ignored. The directory is always kept in path order.
+    //! \returns The number of paths that match a file in this pck currently
+    size_t SetLayoutOrder(std::vector<std::string> paths);
+
+    //! \brief Sets per file alignment rules to use when saving, files not matching any rule
+    //! use the default alignment
+    void SetAlignmentPolicy(std::shared_ptr<const AlignmentPolicy> policy)
+    {
+        AlignmentRules = std::move(policy);
+    }
+
+    [[nodiscard]] const PaddingReport& GetLastPaddingReport() const
+    {
+        return LastPaddingReport;
+    }
+
+    //! \brief Sets a thread pool to run extract and verify in parallel
+    //!
+    //! The pool is not owned by this object and must stay alive while it is used here.
+    void SetWorkerPool(WorkerPool* pool)
+    {
+        Pool = pool;
+    }
+
+    //! \brief Sets the key used to read and write the encrypted directory and file data
+    //!
+    //! Must be set before loading a pck with an encrypted directory
+    void SetEncryptionKey(const EncryptionKey& key)
+    {
+        Cipher.emplace(key);
+    }
+
+    //! \brief Sets whether the directory is encrypted when saving
+    void SetEncryptDirectory(bool encrypt);
+
+    //! \brief Marks the files matching the predicate to be encrypted when saving
+    //! \returns The number of matched files
+    size_t SetEncryptedFiles(const std::function<bool(const ContainedFile&)>& predicate);
+
+    [[nodiscard]] bool IsDirectoryEncrypted() const
+    {
+        return Flags & PACK_DIR_ENCRYPTED;
+    }
+
+    //! \brief Sets a pool of buffers to read file data through when saving, extracting and
+    //! verifying, to limit memory use
+    //!
+    //! The pool is not owned by this object. Without a pool each file is read whole into
+    //! memory.
+    void SetBufferPool(BufferPool* pool)
+    {
+        Buffers = pool;
+    }
+
+    //! \brief Sets where the progress of saving, extracting, verifying and compacting is
+    //! reported, not owned by this object
+    void SetProgressReporter(ProgressReporter* progress)
+    {
+        Progress = progress;
+    }
+
     //! \brief Sets a filter for entries to be added to this object
     //!
     //! This must be set before loading the data. The Save method doesn't apply the filter.
     void SetIncludeFilter(std::function<bool(const ContainedFile&)> callback)
+    {
+        SetIncludeFilter(std::move(callback), EntryPrefilter());
+    }
+
+    //! \param prefilter Cheap checks implied by the callback, applied to directory entries
+    //! before the callback
+    void SetIncludeFilter(
+        std::function<bool(const ContainedFile&)> callback, EntryPrefilter prefilter)
     {
         IncludeFilter = std::move(callback);
+        Prefilter = std::move(prefilter);
+    }
+
+    //! \returns True if a file passes the include filter
+    [[nodiscard]] bool IsIncluded(const ContainedFile& file) const
+    {
+        return !IncludeFilter || IncludeFilter(file);
     }
 
-    inline const auto& GetPath()
+    void SetDurability(Durability durability)
+    {
+        DurabilityMode = durability;
+    }
+
+    //! \brief When enabled a .pck.idx sidecar index is used to load the directory if it is up
+    //! to date, and it is written again when saving or when it was found to be out of date
+    void SetUseSidecarIndex(bool useIndex)
+    {
+        UseSidecarIndex = useIndex;
+    }
+
+    inline const auto& GetPath() const
     {
         return Path;
     }
 
+    inline const auto& GetContents() const
+    {
+        return Contents;
+    }
+
+    //! \returns True if the include filter has dropped entries while loading
+    inline bool HasExcludedEntries() const
+    {
+        return ExcludedEntries > 0;
+    }
+
     inline const std::string& GetSalt() const
     {
         return Salt;
@@ -115,6 +413,66 @@ public:
         return FormatVersion;
     }
 
+    uint32_t GetMajorGodotVersion() const
+    {
+        return MajorGodotVersion;
+    }
+
+    uint32_t GetMinorGodotVersion() const
+    {
+        return MinorGodotVersion;
+    }
+
+    uint32_t GetPatchGodotVersion() const
+    {
+        return PatchGodotVersion;
+    }
+
+    uint32_t GetFlags() const
+    {
+        return Flags;
+    }
+
+    uint64_t GetFileOffsetBase() const
+    {
+        return FileOffsetBase;
+    }
+
+    //! \brief Position of the pck header in the file, non-zero when the pck is embedded in
+    //! an executable
+    uint64_t GetPckStart() const
+    {
+        return PckStart;
+    }
+
+    bool IsEmbedded() const
+    {
+        return PckStart > 0;
+    }
+
+    //! \brief Size of the header (including its reserved part) of the loaded format version
+    uint64_t GetHeaderSize() const;
+
+    //! \brief Start of the directory (the file count) in the pck file
+    uint64_t GetDirectoryStart() const
+    {
+        return DirectoryStart;
+    }
+
+    //! \brief Position of the first byte after the last directory entry
+    uint64_t GetDirectoryEnd() const
+    {
+        return DirectoryEnd;
+    }
+
+    //! \returns The number of NULs written after a path of this length in the directory
+    size_t GetPathPadding(size_t pathLength) const
+    {
+        // When the path is exactly the right size, this results in 4 extra NULLs but that
+        // seems to be what Godot itself also does
+        return PadPathsToMultipleWithNULLS - (pathLength % PadPathsToMultipleWithNULLS);
+    }
+
     std::string GetGodotVersion() const
     {
         return std::to_string(MajorGodotVersion) + "." + std::to_string(MinorGodotVersion) +
@@ -128,12 +486,97 @@ private:
     void Write32(uint32_t value);
     void Write64(uint64_t value);
 
-    void PadToAlignment();
+    static uint32_t Read32(std::istream& stream);
+    static uint64_t Read64(std::istream& stream);
+    static void Write32(std::ostream& stream, uint32_t value);
+    static void Write64(std::ostream& stream, uint64_t value);
+
+    //! \brief Sets GetData of a loaded entry to read (and decrypt if needed) from this pck
+    void SetDataSource(ContainedFile& entry);
+
+    //! \brief Reads the header and directory from File and DataReader, closes File after
+    bool ReadHeaderAndDirectory();
+
+    //! \brief Checks that the pck can be saved and gets the order to write the data in
+    bool PrepareSave(std::vector<ContainedFile*>& writeOrder);
+
+    //! \brief Writes the whole pck to File
+    bool WritePck(const std::vector<ContainedFile*>& writeOrder);
+
+    //! \returns The most bytes WritePck can write, the padding is not known exactly before
+    //! the data is placed
+    [[nodiscard]] uint64_t GetSaveSizeLimit(
+        const std::vector<ContainedFile*>& writeOrder) const;
+
+    //! \brief Closes File, with a file a failure to write out the data throws
+    void CloseFile();
+
+    std::string ReadEncryptedContents(uint64_t offset, uint64_t size);
+
+    //! \brief Reads and decrypts a part of an encrypted file
+    //! \param start Position in the decrypted data, reading is fastest when it is a multiple of
+    //! AES_BLOCK_SIZE
+    bool ReadEncryptedRange(
+        uint64_t offset, uint64_t size, uint64_t start, char* buffer, size_t length);
+
+    //! \brief Writes the file count and entries at the current position of File and sets
+    //! DirectoryStart and DirectoryEnd
+    void WriteDirectory();
+
+    //! \brief Closes File and points the header to the directory written by WriteDirectory
+    //! once everything is on disk
+    bool SwitchToDirectory();
+
+    //! \brief Writes the data of entries to File in order, padded to their alignment, and
+    //! updates their offsets and MD5s
+    bool WriteEntryData(const std::vector<ContainedFile*>& entries);
+
+    //! \brief Writes the data of an entry through a buffer from Buffers
+    bool WriteStreamedData(ContainedFile& entry);
+
+    //! \returns False if encrypted data needs to be written without a key (prints an error)
+    bool CheckEncryptionKey(const std::vector<ContainedFile*>& entries) const;
+
+    //! \brief Clears the padding report and sets it up for the alignment rules
+    void ResetPaddingReport();
+
+    //! \brief Reads and decrypts a block in the Godot encrypted file format from File
+    bool ReadEncryptedBlock(std::string& output);
+
+    //! \brief Writes data in the Godot encrypted file format to File
+    void WriteEncrypted(const std::string& data, const std::array<uint8_t, 16>& hash);
+
+    //! \brief Writes the directory entries (everything after the file count)
+    void WriteDirectoryEntries(std::ostream& stream);
+
+    void WriteZeros(uint64_t count);
+
+    //! \brief Finds the pck header, either at the start of the file or through the trailer
+    //! Godot writes after a pck embedded in an executable
+    //! \returns False if the file doesn't contain a pck
+    bool FindPckStart();
+
+    //! \brief Copies the executable a pck is embedded in to File
+    bool CopyEmbeddingExecutable();
+
+    //! \returns The number of padding bytes written
+    uint64_t PadToAlignment();
+    uint64_t PadTo(uint64_t alignment);
+
+    std::vector<ContainedFile*> GetDataWriteOrder();
 
 private:
     std::string Path;
-    std::optional<std::fstream> File;
-    std::optional<std::ifstream> DataReader;
+
+    //! Buffer of File in the fast durability mode, must outlive File
+    std::vector<char> WriteBuffer;
+
+    //! The pck file being read or written, or a MemoryStream in place of it
+    std::unique_ptr<std::iostream> File;
+    std::optional<ReadableFile> DataReader;
+
+    //! Pck loaded by LoadFromMemory, DataReader reads from this
+    std::string MemoryData;
 
     //! \brief PCK Format version number
     //!
@@ -156,6 +599,13 @@ private:
 
     uint64_t DirectoryOffset = 0;
 
+    //! Start of the pck inside the file, the file data before it is kept when saving
+    uint64_t PckStart = 0;
+
+    // Absolute directory location, recorded when loading and saving
+    uint64_t DirectoryStart = 0;
+    uint64_t DirectoryEnd = 0;
+
     int Alignment = 0;
 
     //! Add trailing null bytes to the length of a path until it is a multiple of this size
@@ -164,8 +614,29 @@ private:
     std::map<std::string, ContainedFile> Contents;
     bool NoResPrefix = false;
 
+    bool UseSidecarIndex = false;
+
+    WorkerPool* Pool = nullptr;
+    BufferPool* Buffers = nullptr;
+    ProgressReporter* Progress = nullptr;
+
+    std::optional<AESCipher> Cipher;
+
+    std::shared_ptr<const AlignmentPolicy> AlignmentRules;
+    PaddingReport LastPaddingReport;
+
+    //! Order to write file data in, see SetLayoutOrder
+    std::vector<std::string> LayoutOrder;
+
+    size_t ExcludedEntries = 0;
+
     //! Used in a bunch of operations to check if a file entry should be included or ignored
     std::function<bool(const ContainedFile&)> IncludeFilter;
+
+    //! Applied while loading before IncludeFilter
+    EntryPrefilter Prefilter;
+
+    Durability DurabilityMode = Durability::Normal;
 };
 
 } // namespace pcktool
@@ -0,0 +1,592 @@
+// ------------------------------------ //
+#include "PckIndex.h"
+
+#include "PckFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace pcktool;
+
+namespace {
+
+// The index is written in the native (little endian) byte order like the pck data is
+
+struct IndexHeader {
+    uint32_t Magic;
+    uint32_t Version;
+
+    // Values used to detect the pck changing
+    uint64_t PckSize;
+    int64_t PckModified;
+    uint64_t DirectoryHash;
+    uint64_t DirectoryStart;
+    uint64_t DirectoryEnd;
+
+    // Pck header info to not need to read the pck header
+    uint32_t FormatVersion;
+    uint32_t MajorGodotVersion;
+    uint32_t MinorGodotVersion;
+    uint32_t PatchGodotVersion;
+    uint32_t PckFlags;
+    uint32_t EntryCount;
+    uint64_t FileOffsetBase;
+
+    //! Start of the pck header, non-zero for a pck embedded in an executable
+    uint64_t PckStart;
+
+    //! Hash table size, always a power of two
+    uint32_t SlotCount;
+    uint32_t Reserved;
+
+    uint64_t EntriesOffset;
+    uint64_t SlotsOffset;
+    uint64_t StringsOffset;
+    uint64_t StringsSize;
+};
+
+struct IndexEntry {
+    uint64_t PathHash;
+    uint64_t PathOffset;
+    uint32_t PathLength;
+    uint32_t Flags;
+    uint64_t Offset;
+    uint64_t Size;
+    uint8_t MD5[16];
+};
+
+static_assert(sizeof(IndexHeader) == 128, "index header has unexpected padding");
+static_assert(sizeof(IndexEntry) == 56, "index entry has unexpected padding");
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+//! Slots store entry index + 1, so 0 can be used as the empty value
+constexpr uint32_t EMPTY_SLOT = 0;
+
+IndexHeader ReadHeader(const uint8_t* data)
+{
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return header;
+}
+
+int64_t GetModificationTime(const std::string& path)
+{
+    return static_cast<int64_t>(
+        std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+//! \brief Checks that the header of the pck still has the values the index was made with
+//!
+//! Reading the header is a single small read, so this catches a pck that was replaced with one
+//! of the same size and modification time without reading the directory.
+bool CheckPckHeader(const std::string& pckPath, const IndexHeader& header)
+{
+    std::ifstream reader(pckPath, std::ios::in | std::ios::binary);
+
+    if(!reader.good())
+        return false;
+
+    reader.seekg(static_cast<std::streamoff>(header.PckStart));
+
+    // Magic, versions, flags, file base and directory offset
+    char data[40] = {};
+    reader.read(data, sizeof(data));
+
+    const auto read = static_cast<size_t>(reader.gcount());
+
+    uint32_t values[5];
+
+    if(read < sizeof(values))
+        return false;
+
+    std::memcpy(values, data, sizeof(values));
+
+    if(values[0] != PCK_HEADER_MAGIC || values[1] != header.FormatVersion ||
+        values[2] != header.MajorGodotVersion || values[3] != header.MinorGodotVersion ||
+        values[4] != header.PatchGodotVersion)
+        return false;
+
+    if(header.FormatVersion < 2)
+        return true;
+
+    if(read < 32)
+        return false;
+
+    uint32_t flags;
+    uint64_t fileOffsetBase;
+    std::memcpy(&flags, data + 20, sizeof(flags));
+    std::memcpy(&fileOffsetBase, data + 24, sizeof(fileOffsetBase));
+
+    // Saving always writes the base as relative, which the loaded flags don't need to say
+    if((flags & ~PCK_FILE_RELATIVE_BASE) != (header.PckFlags & ~PCK_FILE_RELATIVE_BASE))
+        return false;
+
+    if(header.FormatVersion >= 3 || (flags & PCK_FILE_RELATIVE_BASE))
+        fileOffsetBase += header.PckStart;
+
+    if(fileOffsetBase != header.FileOffsetBase)
+        return false;
+
+    if(header.FormatVersion < 3)
+        return true;
+
+    if(read < sizeof(data))
+        return false;
+
+    uint64_t directoryOffset;
+    std::memcpy(&directoryOffset, data + 32, sizeof(directoryOffset));
+
+    return header.PckStart + directoryOffset == header.DirectoryStart;
+}
+
+bool HashDirectory(
+    const std::string& pckPath, uint64_t start, uint64_t end, uint64_t& resultHash)
+{
+    std::ifstream reader(pckPath, std::ios::in | std::ios::binary);
+
+    if(!reader.good() || end < start)
+        return false;
+
+    reader.seekg(static_cast<std::streamoff>(start));
+
+    std::vector<char> buffer(1024 * 1024);
+    uint64_t left = end - start;
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    while(left > 0) {
+        const auto toRead = static_cast<size_t>(std::min<uint64_t>(left, buffer.size()));
+
+        reader.read(buffer.data(), static_cast<std::streamsize>(toRead));
+
+        if(!reader.good())
+            return false;
+
+        hash = PckIndex::HashBytes(buffer.data(), toRead, hash);
+        left -= toRead;
+    }
+
+    resultHash = hash;
+    return true;
+}
+
+} // namespace
+
+// ------------------------------------ //
+PckIndex::~PckIndex()
+{
+    Unmap();
+}
+// ------------------------------------ //
+bool PckIndex::Open(const std::string& indexPath, const std::string& pckPath,
+    bool verifyDirectory)
+{
+    Unmap();
+
+    std::error_code error;
+
+    if(!std::filesystem::exists(indexPath, error))
+        return false;
+
+    if(!Map(indexPath))
+        return false;
+
+    if(!CheckLayout()) {
+        std::cout << "WARNING: ignoring corrupt pck index: " << indexPath << "\n";
+        Unmap();
+        return false;
+    }
+
+    const auto header = ReadHeader(Data);
+
+    try {
+        if(std::filesystem::file_size(pckPath) != header.PckSize ||
+            GetModificationTime(pckPath) != header.PckModified) {
+            Unmap();
+            return false;
+        }
+    } catch(const std::filesystem::filesystem_error&) {
+        Unmap();
+        return false;
+    }
+
+    if(!CheckPckHeader(pckPath, header)) {
+        Unmap();
+        return false;
+    }
+
+    if(verifyDirectory) {
+        uint64_t hash = 0;
+
+        if(!HashDirectory(pckPath, header.DirectoryStart, header.DirectoryEnd, hash) ||
+            hash != header.DirectoryHash) {
+            Unmap();
+            return false;
+        }
+    }
+
+    return true;
+}
+// ------------------------------------ //
+bool PckIndex::Write(const PckFile& pck, const std::string& indexPath)
+{
+    if(pck.HasExcludedEntries()) {
+        std::cout << "ERROR: can't write a pck index when filters have excluded entries\n";
+        return false;
+    }
+
+    if(pck.IsDirectoryEncrypted()) {
+        std::cout << "ERROR: can't write a pck index for an encrypted directory as the index "
+                     "is not encrypted\n";
+        return false;
+    }
+
+    const auto& contents = pck.GetContents();
+
+    // Slot table size needs to stay representable
+    if(contents.size() > std::numeric_limits<uint32_t>::max() / 4) {
+        std::cout << "ERROR: too many entries for a pck index\n";
+        return false;
+    }
+
+    IndexHeader header{};
+    header.Magic = PCK_INDEX_MAGIC;
+    header.Version = PCK_INDEX_VERSION;
+    header.FormatVersion = pck.GetFormatVersion();
+    header.MajorGodotVersion = pck.GetMajorGodotVersion();
+    header.MinorGodotVersion = pck.GetMinorGodotVersion();
+    header.PatchGodotVersion = pck.GetPatchGodotVersion();
+    header.PckFlags = pck.GetFlags();
+    header.FileOffsetBase = pck.GetFileOffsetBase();
+    header.PckStart = pck.GetPckStart();
+    header.DirectoryStart = pck.GetDirectoryStart();
+    header.DirectoryEnd = pck.GetDirectoryEnd();
+    header.EntryCount = static_cast<uint32_t>(contents.size());
+
+    try {
+        header.PckSize = std::filesystem::file_size(pck.GetPath());
+        header.PckModified = GetModificationTime(pck.GetPath());
+    } catch(const std::filesystem::filesystem_error& e) {
+        std::cout << "ERROR: can't read pck file info for index: " << e.what() << "\n";
+        return false;
+    }
+
+    if(!HashDirectory(
+           pck.GetPath(), header.DirectoryStart, header.DirectoryEnd, header.DirectoryHash)) {
+        std::cout << "ERROR: can't read pck directory for index: " << pck.GetPath() << "\n";
+        return false;
+    }
+
+    // Keep the table at most half full so that probe sequences stay short
+    uint32_t slotCount = 16;
+    while(slotCount < contents.size() * 2)
+        slotCount *= 2;
+
+    header.SlotCount = slotCount;
+
+    std::vector<IndexEntry> entries;
+    entries.reserve(contents.size());
+
+    std::vector<uint32_t> slots(slotCount, EMPTY_SLOT);
+
+    std::string strings;
+
+    for(const auto& [path, file] : contents) {
+        IndexEntry entry{};
+        entry.PathHash = HashPath(path);
+        entry.PathOffset = strings.size();
+        entry.PathLength = static_cast<uint32_t>(path.size());
+        entry.Flags = file.Flags;
+        entry.Offset = file.Offset;
+        entry.Size = file.Size;
+        std::memcpy(entry.MD5, file.MD5.data(), sizeof(entry.MD5));
+
+        strings.append(path);
+
+        auto slot = static_cast<uint32_t>(entry.PathHash & (slotCount - 1));
+        while(slots[slot] != EMPTY_SLOT)
+            slot = (slot + 1) & (slotCount - 1);
+
+        entries.push_back(entry);
+        slots[slot] = static_cast<uint32_t>(entries.size());
+    }
+
+    header.EntriesOffset = sizeof(IndexHeader);
+    header.SlotsOffset = header.EntriesOffset + entries.size() * sizeof(IndexEntry);
+    header.StringsOffset = header.SlotsOffset + slots.size() * sizeof(uint32_t);
+    header.StringsSize = strings.size();
+
+    const auto tmpWrite = indexPath + ".write";
+
+    {
+        std::ofstream writer(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+        if(!writer.good()) {
+            std::cout << "ERROR: index file is unwritable: " << tmpWrite << "\n";
+            return false;
+        }
+
+        writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writer.write(reinterpret_cast<const char*>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(IndexEntry)));
+        writer.write(reinterpret_cast<const char*>(slots.data()),
+            static_cast<std::streamsize>(slots.size() * sizeof(uint32_t)));
+        writer.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+        if(!writer.good()) {
+            std::cout << "ERROR: writing index file failed: " << tmpWrite << "\n";
+            return false;
+        }
+    }
+
+    try {
+        std::filesystem::remove(indexPath);
+    } catch(const std::filesystem::filesystem_error&) {
+    }
+
+    std::filesystem::rename(tmpWrite, indexPath);
+    return true;
+}
+// ------------------------------------ //
+std::optional<PckIndex::Entry> PckIndex::Find(std::string_view path) const
+{
+    if(Data == nullptr)
+        return std::nullopt;
+
+    const auto header = ReadHeader(Data);
+    const auto hash = HashPath(path);
+    const auto* slots = Data + header.SlotsOffset;
+
+    auto slot = static_cast<uint32_t>(hash & (header.SlotCount - 1));
+
+    // The table is never full, so this always finds an empty slot eventually
+    while(true) {
+        uint32_t value;
+        std::memcpy(&value, slots + static_cast<size_t>(slot) * sizeof(uint32_t), sizeof(value));
+
+        if(value == EMPTY_SLOT)
+            return std::nullopt;
+
+        IndexEntry raw;
+        std::memcpy(&raw, Data + header.EntriesOffset + (value - 1) * sizeof(IndexEntry),
+            sizeof(raw));
+
+        if(raw.PathHash == hash && raw.PathLength == path.size()) {
+            const auto entry = GetEntry(value - 1);
+
+            if(entry.Path == path)
+                return entry;
+        }
+
+        slot = (slot + 1) & (header.SlotCount - 1);
+    }
+}
+
+PckIndex::Entry PckIndex::GetEntry(uint32_t index) const
+{
+    const auto header = ReadHeader(Data);
+
+    IndexEntry raw;
+    std::memcpy(&raw, Data + header.EntriesOffset + index * sizeof(IndexEntry), sizeof(raw));
+
+    Entry entry{};
+
+    // Corrupt string references result in an empty path which won't match any lookup
+    if(raw.PathOffset + raw.PathLength <= header.StringsSize) {
+        entry.Path = std::string_view(
+            reinterpret_cast<const char*>(Data + header.StringsOffset + raw.PathOffset),
+            raw.PathLength);
+    }
+
+    entry.Offset = raw.Offset;
+    entry.Size = raw.Size;
+    entry.Flags = raw.Flags;
+    std::memcpy(entry.MD5.data(), raw.MD5, sizeof(raw.MD5));
+
+    return entry;
+}
+
+uint32_t PckIndex::GetEntryCount() const
+{
+    if(Data == nullptr)
+        return 0;
+
+    return ReadHeader(Data).EntryCount;
+}
+// ------------------------------------ //
+uint64_t PckIndex::HashPath(std::string_view path)
+{
+    return HashBytes(path.data(), path.size(), FNV_OFFSET_BASIS);
+}
+
+uint64_t PckIndex::HashBytes(const char* data, size_t length, uint64_t hash)
+{
+    for(size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+// ------------------------------------ //
+uint32_t PckIndex::GetFormatVersion() const
+{
+    return ReadHeader(Data).FormatVersion;
+}
+
+uint32_t PckIndex::GetMajorGodotVersion() const
+{
+    return ReadHeader(Data).MajorGodotVersion;
+}
+
+uint32_t PckIndex::GetMinorGodotVersion() const
+{
+    return ReadHeader(Data).MinorGodotVersion;
+}
+
+uint32_t PckIndex::GetPatchGodotVersion() const
+{
+    return ReadHeader(Data).PatchGodotVersion;
+}
+
+uint32_t PckIndex::GetPckFlags() const
+{
+    return ReadHeader(Data).PckFlags;
+}
+
+uint64_t PckIndex::GetFileOffsetBase() const
+{
+    return ReadHeader(Data).FileOffsetBase;
+}
+
+uint64_t PckIndex::GetPckStart() const
+{
+    return ReadHeader(Data).PckStart;
+}
+
+uint64_t PckIndex::GetDirectoryStart() const
+{
+    return ReadHeader(Data).DirectoryStart;
+}
+
+uint64_t PckIndex::GetDirectoryEnd() const
+{
+    return ReadHeader(Data).DirectoryEnd;
+}
+// ------------------------------------ //
+bool PckIndex::Map(const std::string& indexPath)
+{
+#ifndef _WIN32
+    const int fd = ::open(indexPath.c_str(), O_RDONLY);
+
+    if(fd < 0)
+        return false;
+
+    struct stat info {};
+
+    if(::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(IndexHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped =
+        ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+
+    if(mapped == MAP_FAILED)
+        return false;
+
+    Data = static_cast<const uint8_t*>(mapped);
+    DataSize = static_cast<size_t>(info.st_size);
+    return true;
+#else
+    std::ifstream reader(indexPath, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if(!reader.good())
+        return false;
+
+    const auto size = static_cast<size_t>(reader.tellg());
+
+    if(size < sizeof(IndexHeader))
+        return false;
+
+    FallbackBuffer.resize(size);
+    reader.seekg(0);
+    reader.read(reinterpret_cast<char*>(FallbackBuffer.data()), size);
+
+    if(!reader.good())
+        return false;
+
+    Data = FallbackBuffer.data();
+    DataSize = size;
+    return true;
+#endif
+}
+
+void PckIndex::Unmap()
+{
+    if(Data == nullptr)
+        return;
+
+#ifndef _WIN32
+    ::munmap(const_cast<uint8_t*>(Data), DataSize);
+#else
+    FallbackBuffer.clear();
+    FallbackBuffer.shrink_to_fit();
+#endif
+
+    Data = nullptr;
+    DataSize = 0;
+}
+
+bool PckIndex::CheckLayout() const
+{
+    const auto header = ReadHeader(Data);
+
+    if(header.Magic != PCK_INDEX_MAGIC || header.Version != PCK_INDEX_VERSION)
+        return false;
+
+    if(header.SlotCount == 0 || (header.SlotCount & (header.SlotCount - 1)) != 0 ||
+        header.SlotCount <= header.EntryCount)
+        return false;
+
+    // All the tables must be inside the file
+    if(header.EntriesOffset != sizeof(IndexHeader) ||
+        header.SlotsOffset !=
+            header.EntriesOffset + static_cast<uint64_t>(header.EntryCount) * sizeof(IndexEntry) ||
+        header.StringsOffset !=
+            header.SlotsOffset + static_cast<uint64_t>(header.SlotCount) * sizeof(uint32_t) ||
+        header.StringsOffset + header.StringsSize != DataSize)
+        return false;
+
+    // Lookups use the slot values as entry indices without checking them, and stop at an
+    // empty slot, which must exist when no more slots are used than there are entries
+    const auto* slots = Data + header.SlotsOffset;
+    uint32_t used = 0;
+
+    for(uint32_t slot = 0; slot < header.SlotCount; ++slot) {
+        uint32_t value;
+        std::memcpy(&value, slots + static_cast<size_t>(slot) * sizeof(uint32_t), sizeof(value));
+
+        if(value == EMPTY_SLOT)
+            continue;
+
+        if(value > header.EntryCount || ++used > header.EntryCount)
+            return false;
+    }
+
+    return true;
+}
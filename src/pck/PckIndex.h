@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Define.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pcktool {
+
+class PckFile;
+
+constexpr uint32_t PCK_INDEX_MAGIC = 0x58495047;
+constexpr uint32_t PCK_INDEX_VERSION = 2;
+
+constexpr auto PCK_INDEX_EXTENSION = ".idx";
+
+//! \brief Sidecar lookup index (.pck.idx) for a pck file
+//!
+//! Contains a precomputed hash table of the pck directory so that loading and single file
+//! lookups don't need to parse the directory of the pck. The index is tied to the size,
+//! modification time and directory contents of the pck it was generated from, so a modified
+//! pck is detected and the index is then ignored.
+class PckIndex {
+public:
+    struct Entry {
+        std::string_view Path;
+
+        //! Absolute offset in the pck file
+        uint64_t Offset;
+        uint64_t Size;
+        std::array<uint8_t, 16> MD5;
+        uint32_t Flags;
+    };
+
+public:
+    PckIndex() = default;
+    ~PckIndex();
+
+    PckIndex(PckIndex&& other) = delete;
+    PckIndex(const PckIndex& other) = delete;
+
+    PckIndex& operator=(PckIndex&& other) = delete;
+    PckIndex& operator=(const PckIndex& other) = delete;
+
+    //! \brief Opens an index and checks that it matches the pck file
+    //!
+    //! The size and modification time of the pck and the values in its header are always
+    //! checked, which doesn't need the directory to be read.
+    //! \param verifyDirectory When true the pck directory bytes are also read and compared
+    //! against the stored hash, which costs about as much as parsing the directory
+    //! \returns False if the index is missing, corrupt or out of date
+    bool Open(const std::string& indexPath, const std::string& pckPath, bool verifyDirectory);
+
+    //! \brief Writes an index for a loaded (or just saved) pck
+    //!
+    //! The pck needs to have been loaded without filters, otherwise the index would be
+    //! missing entries
+    static bool Write(const PckFile& pck, const std::string& indexPath);
+
+    [[nodiscard]] std::optional<Entry> Find(std::string_view path) const;
+
+    [[nodiscard]] Entry GetEntry(uint32_t index) const;
+
+    [[nodiscard]] uint32_t GetEntryCount() const;
+
+    static std::string IndexPathFor(const std::string& pckPath)
+    {
+        return pckPath + PCK_INDEX_EXTENSION;
+    }
+
+    //! \brief Hash used for the paths in the index (64-bit FNV-1a)
+    static uint64_t HashPath(std::string_view path);
+
+    //! \brief Hash used to detect directory changes (64-bit FNV-1a)
+    static uint64_t HashBytes(const char* data, size_t length, uint64_t hash);
+
+    // Pck header values stored in the index
+    [[nodiscard]] uint32_t GetFormatVersion() const;
+    [[nodiscard]] uint32_t GetMajorGodotVersion() const;
+    [[nodiscard]] uint32_t GetMinorGodotVersion() const;
+    [[nodiscard]] uint32_t GetPatchGodotVersion() const;
+    [[nodiscard]] uint32_t GetPckFlags() const;
+    [[nodiscard]] uint64_t GetFileOffsetBase() const;
+    [[nodiscard]] uint64_t GetPckStart() const;
+    [[nodiscard]] uint64_t GetDirectoryStart() const;
+    [[nodiscard]] uint64_t GetDirectoryEnd() const;
+
+private:
+    bool Map(const std::string& indexPath);
+    void Unmap();
+
+    //! \brief Checks that the tables are inside the file and the slots refer to entries
+    [[nodiscard]] bool CheckLayout() const;
+
+private:
+    const uint8_t* Data = nullptr;
+    size_t DataSize = 0;
+
+    //! Used instead of a memory mapping on platforms without mmap
+    std::vector<uint8_t> FallbackBuffer;
+};
+
+} // namespace pcktool
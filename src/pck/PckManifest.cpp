@@ -0,0 +1,237 @@
+// ------------------------------------ //
+#include "PckManifest.h"
+
+#include "PckFile.h"
+#include "PckIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+using namespace pcktool;
+
+namespace {
+
+// Written in the native (little endian) byte order like the pck data is
+
+struct ManifestHeader {
+    uint32_t Magic;
+    uint32_t Version;
+
+    //! Size of the pck the manifest was made from, a different size means a different build
+    uint64_t PckSize;
+    uint32_t EntryCount;
+    uint32_t GroupCount;
+    uint64_t EntriesOffset;
+    uint64_t GroupsOffset;
+};
+
+struct ManifestEntry {
+    uint64_t PathHash;
+    uint64_t Offset;
+    uint64_t Length;
+    uint64_t Size;
+    uint8_t MD5[16];
+    uint32_t Flags;
+    uint32_t Group;
+};
+
+struct ManifestGroup {
+    uint64_t Offset;
+    uint64_t Length;
+    uint32_t Entries;
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(ManifestHeader) == 40, "manifest header has unexpected padding");
+static_assert(sizeof(ManifestEntry) == 56, "manifest entry has unexpected padding");
+static_assert(sizeof(ManifestGroup) == 24, "manifest group has unexpected padding");
+
+} // namespace
+// ------------------------------------ //
+bool PckManifest::Build(const PckFile& pck, uint64_t coalesceLimit)
+{
+    Entries.clear();
+    Groups.clear();
+
+    std::error_code error;
+    PckSize = std::filesystem::file_size(pck.GetPath(), error);
+
+    if(error) {
+        std::cout << "ERROR: can't read pck file size: " << pck.GetPath() << "\n";
+        return false;
+    }
+
+    const auto& contents = pck.GetContents();
+
+    if(contents.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cout << "ERROR: too many entries for a manifest\n";
+        return false;
+    }
+
+    Entries.reserve(contents.size());
+
+    for(const auto& [path, file] : contents) {
+        if(!file.StoredInPck) {
+            std::cout << "ERROR: file is not stored in the pck: " << path << "\n";
+            return false;
+        }
+
+        Entry entry{path, PckIndex::HashPath(path), file.Offset, file.GetStoredSize(),
+            file.Size, file.MD5, file.Flags, 0};
+
+        if(entry.Offset + entry.Length > PckSize) {
+            std::cout << "ERROR: file data is past the end of the pck: " << path << "\n";
+            return false;
+        }
+
+        Entries.push_back(std::move(entry));
+    }
+
+    // Groups are formed walking the data in file order
+    std::vector<Entry*> byOffset;
+    byOffset.reserve(Entries.size());
+
+    for(auto& entry : Entries)
+        byOffset.push_back(&entry);
+
+    std::sort(byOffset.begin(), byOffset.end(), [](const Entry* first, const Entry* second) {
+        return first->Offset != second->Offset ? first->Offset < second->Offset :
+                                                 first->Length < second->Length;
+    });
+
+    const Entry* previous = nullptr;
+
+    // Only groups of small files take more files
+    bool coalescable = false;
+
+    for(auto* entry : byOffset) {
+        const auto end = entry->Offset + entry->Length;
+        const bool small = coalesceLimit > 0 && entry->Length < coalesceLimit;
+
+        bool join = false;
+
+        if(previous != nullptr) {
+            const auto& group = Groups.back();
+            const auto groupEnd = group.Offset + group.Length;
+
+            if(entry->Offset == previous->Offset && entry->Length == previous->Length) {
+                // Files sharing their data always need the same range
+                join = true;
+            } else if(small && coalescable &&
+                entry->Offset <= groupEnd + PCK_MANIFEST_MAX_COALESCE_GAP &&
+                std::max(end, groupEnd) - group.Offset <= coalesceLimit) {
+                join = true;
+            }
+        }
+
+        if(!join) {
+            Groups.push_back({entry->Offset, 0, 0});
+            coalescable = small;
+        }
+
+        auto& group = Groups.back();
+        group.Length = std::max(end, group.Offset + group.Length) - group.Offset;
+        ++group.Entries;
+
+        entry->Group = static_cast<uint32_t>(Groups.size() - 1);
+        previous = entry;
+    }
+
+    std::sort(Entries.begin(), Entries.end(), [](const Entry& first, const Entry& second) {
+        return first.PathHash != second.PathHash ? first.PathHash < second.PathHash :
+                                                   first.Path < second.Path;
+    });
+
+    // The binary manifest has only the hashes, so they must tell the files apart
+    for(size_t i = 1; i < Entries.size(); ++i) {
+        if(Entries[i].PathHash == Entries[i - 1].PathHash) {
+            std::cout << "ERROR: paths have the same hash, can't make a manifest: "
+                      << Entries[i - 1].Path << " and " << Entries[i].Path << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PckManifest::Write(const std::string& manifestPath) const
+{
+    ManifestHeader header{};
+    header.Magic = PCK_MANIFEST_MAGIC;
+    header.Version = PCK_MANIFEST_VERSION;
+    header.PckSize = PckSize;
+    header.EntryCount = static_cast<uint32_t>(Entries.size());
+    header.GroupCount = static_cast<uint32_t>(Groups.size());
+    header.EntriesOffset = sizeof(ManifestHeader);
+    header.GroupsOffset = header.EntriesOffset + Entries.size() * sizeof(ManifestEntry);
+
+    std::vector<ManifestEntry> entries;
+    entries.reserve(Entries.size());
+
+    for(const auto& entry : Entries) {
+        ManifestEntry written{};
+        written.PathHash = entry.PathHash;
+        written.Offset = entry.Offset;
+        written.Length = entry.Length;
+        written.Size = entry.Size;
+        std::memcpy(written.MD5, entry.MD5.data(), sizeof(written.MD5));
+        written.Flags = entry.Flags;
+        written.Group = entry.Group;
+
+        entries.push_back(written);
+    }
+
+    std::vector<ManifestGroup> groups;
+    groups.reserve(Groups.size());
+
+    for(const auto& group : Groups)
+        groups.push_back({group.Offset, group.Length, group.Entries, 0});
+
+    const auto tmpWrite = manifestPath + ".write";
+
+    {
+        std::ofstream writer(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+        if(!writer.good()) {
+            std::cout << "ERROR: manifest file is unwritable: " << tmpWrite << "\n";
+            return false;
+        }
+
+        writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writer.write(reinterpret_cast<const char*>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(ManifestEntry)));
+        writer.write(reinterpret_cast<const char*>(groups.data()),
+            static_cast<std::streamsize>(groups.size() * sizeof(ManifestGroup)));
+
+        if(!writer.good()) {
+            std::cout << "ERROR: writing manifest file failed: " << tmpWrite << "\n";
+            return false;
+        }
+    }
+
+    // Renaming over the old manifest keeps it intact if the new one can't be put in place
+    std::error_code error;
+    std::filesystem::rename(tmpWrite, manifestPath, error);
+
+    if(error) {
+        std::cout << "ERROR: replacing manifest file failed: " << manifestPath << "\n";
+        std::filesystem::remove(tmpWrite, error);
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+uint64_t PckManifest::GetFetchedSize() const
+{
+    uint64_t size = 0;
+
+    for(const auto& group : Groups)
+        size += group.Length;
+
+    return size;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Define.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+class PckFile;
+
+constexpr uint32_t PCK_MANIFEST_MAGIC = 0x4D504347;
+constexpr uint32_t PCK_MANIFEST_VERSION = 1;
+
+constexpr auto PCK_MANIFEST_EXTENSION = ".manifest";
+
+//! Largest gap (normally alignment padding) between files that are coalesced into one group
+constexpr uint64_t PCK_MANIFEST_MAX_COALESCE_GAP = 4096;
+
+//! \brief Table of the absolute byte ranges of the files in a pck, for fetching single files
+//! out of a hosted pck with HTTP range requests
+//!
+//! The binary form (.pck.manifest) has no paths, only their 64-bit FNV-1a hashes (the same
+//! as PckIndex::HashPath) with the entries sorted by the hash for a binary search. Each entry
+//! belongs to a range group, which is the range to request. Without coalescing the groups
+//! are the ranges of single files (files sharing the same data share a group), with it small
+//! files next to each other are fetched with one request.
+class PckManifest {
+public:
+    struct Entry {
+        std::string Path;
+        uint64_t PathHash;
+
+        //! Absolute offset of the data in the pck file
+        uint64_t Offset;
+
+        //! Bytes of the pck the data takes, more than Size for encrypted files
+        uint64_t Length;
+        uint64_t Size;
+        std::array<uint8_t, 16> MD5;
+        uint32_t Flags;
+        uint32_t Group;
+    };
+
+    struct Group {
+        uint64_t Offset;
+
+        //! Groups of only empty files have a length of 0 and don't need to be fetched
+        uint64_t Length;
+        uint32_t Entries;
+    };
+
+public:
+    //! \brief Builds the manifest of the files in a loaded pck (the filters can be used to
+    //! only include some files)
+    //! \param coalesceLimit If not 0, files smaller than this that are at most
+    //! PCK_MANIFEST_MAX_COALESCE_GAP bytes apart are grouped into ranges up to this long
+    bool Build(const PckFile& pck, uint64_t coalesceLimit);
+
+    bool Write(const std::string& manifestPath) const;
+
+    [[nodiscard]] const std::vector<Entry>& GetEntries() const
+    {
+        return Entries;
+    }
+
+    [[nodiscard]] const std::vector<Group>& GetGroups() const
+    {
+        return Groups;
+    }
+
+    [[nodiscard]] uint64_t GetPckSize() const
+    {
+        return PckSize;
+    }
+
+    //! \returns Bytes of the pck covered by the groups
+    [[nodiscard]] uint64_t GetFetchedSize() const;
+
+    static std::string ManifestPathFor(const std::string& pckPath)
+    {
+        return pckPath + PCK_MANIFEST_EXTENSION;
+    }
+
+private:
+    uint64_t PckSize = 0;
+
+    //! Sorted by the path hash
+    std::vector<Entry> Entries;
+
+    //! Sorted by offset
+    std::vector<Group> Groups;
+};
+
+} // namespace pcktool
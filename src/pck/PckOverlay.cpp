@@ -0,0 +1,141 @@
+// ------------------------------------ //
+#include "PckOverlay.h"
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <utility>
+
+using namespace pcktool;
+// ------------------------------------ //
+PckOverlay::PckOverlay(std::function<void(PckFile&)> configure) :
+    Configure(std::move(configure))
+{
+}
+// ------------------------------------ //
+bool PckOverlay::Load(const std::vector<std::string>& paths)
+{
+    Layers.clear();
+    Entries.clear();
+    Deleted = 0;
+
+    for(const auto& path : paths) {
+        Layers.push_back(std::make_unique<PckFile>(path));
+
+        if(Configure)
+            Configure(*Layers.back());
+    }
+
+    // Only the directories are read so loading many packs is mostly waiting for the disk
+    std::vector<char> loaded(Layers.size(), false);
+
+    if(Pool != nullptr && Pool->GetThreadCount() > 1 && Layers.size() > 1) {
+        WorkerPool::TaskGroup group(*Pool);
+
+        for(size_t i = 0; i < Layers.size(); ++i) {
+            group.Run([this, i, &loaded]() { loaded[i] = Layers[i]->Load(); });
+        }
+
+        group.Wait();
+    } else {
+        for(size_t i = 0; i < Layers.size(); ++i)
+            loaded[i] = Layers[i]->Load();
+    }
+
+    bool success = true;
+
+    for(size_t i = 0; i < Layers.size(); ++i) {
+        if(!loaded[i]) {
+            std::cout << "ERROR: couldn't load pck file: " << Layers[i]->GetPath() << "\n";
+            success = false;
+        }
+    }
+
+    if(!success)
+        return false;
+
+    // Later packs win
+    for(size_t layer = 0; layer < Layers.size(); ++layer) {
+        for(const auto& [path, file] : Layers[layer]->GetContents()) {
+            auto existing = Entries.find(path);
+
+            if(file.Flags & PCK_FILE_DELETED) {
+                if(existing != Entries.end()) {
+                    Entries.erase(existing);
+                    ++Deleted;
+                }
+
+                continue;
+            }
+
+            if(existing == Entries.end()) {
+                Entries.emplace(path, Entry{&file, layer, 0});
+            } else {
+                existing->second.File = &file;
+                existing->second.Layer = layer;
+                ++existing->second.Overrides;
+            }
+        }
+    }
+
+    if(IncludeFilter) {
+        for(auto iter = Entries.begin(); iter != Entries.end();) {
+            if(IncludeFilter(*iter->second.File)) {
+                ++iter;
+            } else {
+                iter = Entries.erase(iter);
+            }
+        }
+    }
+
+    return true;
+}
+// ------------------------------------ //
+const PckOverlay::Entry* PckOverlay::Find(const std::string& path) const
+{
+    const auto found = Entries.find(path);
+
+    if(found == Entries.end())
+        return nullptr;
+
+    return &found->second;
+}
+// ------------------------------------ //
+bool PckOverlay::Extract(const std::string& outputPrefix, bool printExtracted)
+{
+    for(size_t layer = 0; layer < Layers.size(); ++layer) {
+        if(!Layers[layer]->Extract(outputPrefix, printExtracted, nullptr, ProvidedBy(layer)))
+            return false;
+    }
+
+    return true;
+}
+
+PckFile::VerifyResult PckOverlay::Verify(bool printVerified)
+{
+    PckFile::VerifyResult result;
+
+    for(size_t layer = 0; layer < Layers.size(); ++layer) {
+        auto layerResult = Layers[layer]->Verify(printVerified, ProvidedBy(layer));
+
+        result.Verified += layerResult.Verified;
+        result.Unhashed += layerResult.Unhashed;
+
+        result.Mismatched.insert(result.Mismatched.end(),
+            std::make_move_iterator(layerResult.Mismatched.begin()),
+            std::make_move_iterator(layerResult.Mismatched.end()));
+    }
+
+    std::sort(result.Mismatched.begin(), result.Mismatched.end());
+    return result;
+}
+// ------------------------------------ //
+std::function<bool(const PckFile::ContainedFile&)> PckOverlay::ProvidedBy(size_t layer) const
+{
+    return [this, layer](const PckFile::ContainedFile& file) {
+        const auto* entry = Find(file.Path);
+        return entry != nullptr && entry->Layer == layer;
+    };
+}
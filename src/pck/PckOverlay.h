@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pcktool {
+
+class WorkerPool;
+
+//! \brief The effective set of files of a stack of packs mounted on top of each other
+//!
+//! Like Godot loading a base pck followed by patch and DLC packs, a file in a later pack
+//! replaces the file with the same path in the earlier packs and a later file marked as
+//! deleted hides it. Resolution only works on the loaded directories, the file data stays in
+//! the packs.
+class PckOverlay {
+public:
+    struct Entry {
+        //! The file that is used, owned by the pck in Layers
+        const PckFile::ContainedFile* File;
+
+        //! Index of the pck the file comes from
+        size_t Layer;
+
+        //! How many earlier packs have a file with the same path
+        size_t Overrides;
+    };
+
+public:
+    //! \param configure Called for each pck before it is loaded, to set the encryption key and
+    //! other options
+    explicit PckOverlay(std::function<void(PckFile&)> configure = nullptr);
+
+    //! \brief Sets a thread pool to load the packs in parallel, not owned by this object
+    void SetWorkerPool(WorkerPool* pool)
+    {
+        Pool = pool;
+    }
+
+    //! \brief Sets which resolved files are kept
+    //!
+    //! The packs must be loaded without filters as the filter only applies to the result, a
+    //! file hidden by a filtered out override or deletion marker must not come back.
+    void SetIncludeFilter(std::function<bool(const PckFile::ContainedFile&)> filter)
+    {
+        IncludeFilter = std::move(filter);
+    }
+
+    //! \brief Loads the packs, later ones override the earlier ones, and resolves the files
+    bool Load(const std::vector<std::string>& paths);
+
+    //! \returns The resolved entry or null if no pck provides the path
+    [[nodiscard]] const Entry* Find(const std::string& path) const;
+
+    //! \brief Extracts the resolved files, each pck extracting the files it provides
+    bool Extract(const std::string& outputPrefix, bool printExtracted);
+
+    //! \brief Checks the hashes of the resolved files
+    PckFile::VerifyResult Verify(bool printVerified);
+
+    [[nodiscard]] const std::map<std::string, Entry>& GetEntries() const
+    {
+        return Entries;
+    }
+
+    [[nodiscard]] const PckFile& GetLayer(size_t index) const
+    {
+        return *Layers[index];
+    }
+
+    [[nodiscard]] size_t GetLayerCount() const
+    {
+        return Layers.size();
+    }
+
+    //! \returns How many files were hidden by deleted markers in later packs
+    [[nodiscard]] size_t GetDeletedCount() const
+    {
+        return Deleted;
+    }
+
+private:
+    //! \returns A check for whether an entry of a layer is the resolved one
+    [[nodiscard]] std::function<bool(const PckFile::ContainedFile&)> ProvidedBy(
+        size_t layer) const;
+
+private:
+    std::function<void(PckFile&)> Configure;
+    std::function<bool(const PckFile::ContainedFile&)> IncludeFilter;
+    WorkerPool* Pool = nullptr;
+
+    std::vector<std::unique_ptr<PckFile>> Layers;
+
+    std::map<std::string, Entry> Entries;
+    size_t Deleted = 0;
+};
+
+} // namespace pcktool
@@ -0,0 +1,455 @@
+// ------------------------------------ //
+#include "PckSync.h"
+
+#include "MD5Engine.h"
+#include "PlatformFile.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <utility>
+
+#include "md5.h"
+
+using namespace pcktool;
+
+using FileTime = std::filesystem::file_time_type;
+
+//! Small files are read and hashed in batches of up to this many files and bytes, bigger files
+//! are read in chunks of SYNC_BATCH_SIZE
+constexpr size_t SYNC_BATCH_FILES = 256;
+constexpr uint64_t SYNC_BATCH_SIZE = 8 * 1024 * 1024;
+
+//! Modification times are only trusted if they are older than the previous sync by this much,
+//! which covers the timestamp resolution of common filesystems
+constexpr auto SYNC_TIME_MARGIN = std::chrono::seconds(2);
+
+constexpr auto SYNC_CACHE_HEADER = "# GodotPckTool sync cache 1 ";
+// ------------------------------------ //
+PckSync::PckSync(PckFile& pck, std::string cachePath) :
+    Pck(pck), CachePath(std::move(cachePath)),
+    StartTime(FileTime::clock::now().time_since_epoch().count())
+{
+    std::error_code error;
+    const auto canonical = std::filesystem::weakly_canonical(Pck.GetPath(), error);
+
+    OwnFilesFolder = canonical.parent_path();
+    OwnFilesName = canonical.filename().string();
+
+    LoadCache();
+}
+// ------------------------------------ //
+bool PckSync::AddSource(
+    const std::string& path, const std::string& stripPrefix, bool printChanges)
+{
+    std::error_code error;
+
+    if(!std::filesystem::exists(path, error)) {
+        std::cout << "ERROR: sync source doesn't exist: " << path << "\n";
+        return false;
+    }
+
+    if(!std::filesystem::is_directory(path, error))
+        return AddSourceFile(path, Pck.PreparePckPath(path, stripPrefix), printChanges);
+
+    std::vector<Source> sources;
+
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_directory())
+            continue;
+
+        auto sourcePath = entry.path().string();
+        auto pckPath = Pck.PreparePckPath(sourcePath, stripPrefix);
+
+        if(!AppendSource(std::move(sourcePath), std::move(pckPath), sources))
+            return false;
+    }
+
+    return ProcessSources(sources, printChanges);
+}
+
+bool PckSync::AddSourceFile(const std::string& path, std::string pckPath, bool printChanges)
+{
+    std::vector<Source> sources;
+
+    if(!AppendSource(path, std::move(pckPath), sources))
+        return false;
+
+    return ProcessSources(sources, printChanges);
+}
+
+bool PckSync::AddSourceFiles(
+    const std::vector<std::string>& paths, const std::string& stripPrefix, bool printChanges)
+{
+    std::vector<Source> sources;
+    sources.reserve(paths.size());
+
+    for(const auto& path : paths) {
+        if(!AppendSource(path, Pck.PreparePckPath(path, stripPrefix), sources))
+            return false;
+    }
+
+    return ProcessSources(sources, printChanges);
+}
+
+void PckSync::RemoveMissing(bool printChanges)
+{
+    std::vector<std::string> missing;
+
+    for(const auto& [path, _] : Pck.GetContents()) {
+        if(Seen.count(path) == 0)
+            missing.push_back(path);
+    }
+
+    for(const auto& path : missing) {
+        if(printChanges)
+            std::cout << "Removed: " << path << "\n";
+
+        Pck.RemoveFile(path);
+        ++Result.Removed;
+    }
+}
+
+void PckSync::RemoveSources(const std::vector<std::string>& pckPaths, bool printChanges)
+{
+    for(const auto& path : pckPaths) {
+        Seen.erase(path);
+
+        if(!Pck.RemoveFile(path))
+            continue;
+
+        if(printChanges)
+            std::cout << "Removed: " << path << "\n";
+
+        ++Result.Removed;
+    }
+}
+// ------------------------------------ //
+bool PckSync::ProcessSources(std::vector<Source>& sources, bool printChanges)
+{
+    std::vector<Source*> unknown;
+
+    for(auto& source : sources) {
+        const auto cached = Cache.find(source.PckPath);
+
+        if(cached != Cache.end() && cached->second.Size == source.Info.Size &&
+            cached->second.ModifiedTime == source.Info.ModifiedTime &&
+            source.Info.ModifiedTime < TrustedBefore) {
+            source.Info.MD5 = cached->second.MD5;
+        } else {
+            unknown.push_back(&source);
+        }
+    }
+
+    if(!HashSources(unknown))
+        return false;
+
+    Result.Hashed += unknown.size();
+
+    for(auto& source : sources) {
+        const auto& contents = Pck.GetContents();
+        const auto existing = contents.find(source.PckPath);
+
+        if(existing != contents.end() && existing->second.Size == source.Info.Size &&
+            existing->second.MD5 == source.Info.MD5) {
+            ++Result.Unchanged;
+        } else {
+            if(existing != contents.end()) {
+                ++Result.Changed;
+            } else {
+                ++Result.Added;
+            }
+
+            if(printChanges) {
+                std::cout << (existing != contents.end() ? "Changed: " : "Added: ")
+                          << source.Path << " as " << source.PckPath << "\n";
+            }
+
+            Pck.AddSingleFile(source.Path, source.PckPath);
+        }
+
+        Seen.insert_or_assign(std::move(source.PckPath), source.Info);
+    }
+
+    return true;
+}
+
+bool PckSync::HashSources(std::vector<Source*>& sources)
+{
+    std::atomic<bool> failed{false};
+    std::mutex outputLock;
+
+    const auto reportFailure = [&](const Source& source) {
+        std::lock_guard<std::mutex> lock(outputLock);
+        std::cout << "ERROR: reading sync source failed: " << source.Path << "\n";
+        failed = true;
+    };
+
+    const MD5Engine hashEngine;
+
+    // Small files are read whole and hashed together
+    const auto hashBatch = [&](Source* const* batch, size_t count) {
+        std::vector<std::string> data(count);
+        std::vector<MD5Engine::Job> jobs;
+        jobs.reserve(count);
+
+        ReadableFile reader;
+
+        for(size_t i = 0; i < count; ++i) {
+            data[i].resize(batch[i]->Info.Size);
+
+            if(!reader.Open(batch[i]->Path) ||
+                !reader.ReadAt(0, data[i].data(), data[i].size())) {
+                reportFailure(*batch[i]);
+                return;
+            }
+
+            jobs.push_back({data[i].data(), data[i].size(), batch[i]->Info.MD5.data()});
+        }
+
+        hashEngine.Hash(jobs.data(), jobs.size());
+    };
+
+    const auto hashLarge = [&](Source& source) {
+        ReadableFile reader;
+
+        if(!reader.Open(source.Path)) {
+            reportFailure(source);
+            return;
+        }
+
+        const auto buffer = std::make_unique<char[]>(SYNC_BATCH_SIZE);
+        md5::md5_t hasher;
+
+        for(uint64_t position = 0; position < source.Info.Size; position += SYNC_BATCH_SIZE) {
+            const auto amount = static_cast<size_t>(
+                std::min<uint64_t>(SYNC_BATCH_SIZE, source.Info.Size - position));
+
+            if(!reader.ReadAt(position, buffer.get(), amount)) {
+                reportFailure(source);
+                return;
+            }
+
+            hasher.process(buffer.get(), static_cast<unsigned>(amount));
+        }
+
+        hasher.finish(source.Info.MD5.data());
+    };
+
+    const bool parallel = Pool != nullptr && Pool->GetThreadCount() > 1;
+    std::optional<WorkerPool::TaskGroup> group;
+
+    if(parallel)
+        group.emplace(*Pool);
+
+    const auto run = [&](std::function<void()> task) {
+        if(parallel) {
+            group->Run(std::move(task));
+        } else {
+            task();
+        }
+    };
+
+    size_t batchStart = 0;
+    uint64_t batchSize = 0;
+
+    const auto flushBatch = [&](size_t end) {
+        if(end > batchStart) {
+            const auto* batch = sources.data() + batchStart;
+            const auto count = end - batchStart;
+            run([&hashBatch, batch, count]() { hashBatch(batch, count); });
+        }
+
+        batchStart = end;
+        batchSize = 0;
+    };
+
+    for(size_t i = 0; i < sources.size(); ++i) {
+        auto* source = sources[i];
+
+        if(source->Info.Size > SYNC_BATCH_SIZE) {
+            flushBatch(i);
+            run([&hashLarge, source]() { hashLarge(*source); });
+            batchStart = i + 1;
+            continue;
+        }
+
+        if(i - batchStart >= SYNC_BATCH_FILES ||
+            batchSize + source->Info.Size > SYNC_BATCH_SIZE)
+            flushBatch(i);
+
+        batchSize += source->Info.Size;
+    }
+
+    flushBatch(sources.size());
+
+    if(group)
+        group->Wait();
+
+    return !failed;
+}
+
+bool PckSync::AppendSource(
+    std::string path, std::string pckPath, std::vector<Source>& sources)
+{
+    if(IsOwnFile(path))
+        return true;
+
+    Source source;
+    source.Path = std::move(path);
+    source.PckPath = std::move(pckPath);
+
+    if(!ReadSourceInfo(source.Path, source))
+        return false;
+
+    PckFile::ContainedFile file;
+    file.Path = source.PckPath;
+    file.Size = source.Info.Size;
+
+    if(Pck.IsIncluded(file))
+        sources.push_back(std::move(source));
+
+    return true;
+}
+
+bool PckSync::IsOwnFile(const std::string& path) const
+{
+    // The name is checked first so that only the few candidates need the filesystem lookups
+    // of making the path canonical
+    const auto name = std::filesystem::path(path).filename().string();
+
+    if(name.compare(0, OwnFilesName.size(), OwnFilesName) != 0 ||
+        (name.size() > OwnFilesName.size() && name[OwnFilesName.size()] != '.'))
+        return false;
+
+    std::error_code error;
+    const auto canonical = std::filesystem::weakly_canonical(path, error);
+
+    return !error && canonical.parent_path() == OwnFilesFolder;
+}
+
+bool PckSync::ReadSourceInfo(const std::string& path, Source& source) const
+{
+    std::error_code error;
+
+    source.Info.Size = std::filesystem::file_size(path, error);
+
+    if(!error) {
+        source.Info.ModifiedTime =
+            std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+
+    if(error) {
+        std::cout << "ERROR: reading sync source info failed: " << path << ": "
+                  << error.message() << "\n";
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+void PckSync::LoadCache()
+{
+    // Nothing is trusted without a valid cache
+    TrustedBefore = std::numeric_limits<int64_t>::min();
+
+    std::ifstream reader(CachePath, std::ios::in | std::ios::binary);
+
+    if(!reader.good())
+        return;
+
+    std::string line;
+
+    if(!std::getline(reader, line) || line.rfind(SYNC_CACHE_HEADER, 0) != 0) {
+        std::cout << "WARNING: ignoring sync cache with an unknown format: " << CachePath
+                  << "\n";
+        return;
+    }
+
+    const auto margin =
+        std::chrono::duration_cast<FileTime::duration>(SYNC_TIME_MARGIN).count();
+
+    try {
+        TrustedBefore =
+            std::stoll(line.substr(std::char_traits<char>::length(SYNC_CACHE_HEADER))) -
+            margin;
+    } catch(const std::exception&) {
+        std::cout << "WARNING: ignoring sync cache with an invalid header: " << CachePath
+                  << "\n";
+        return;
+    }
+
+    while(std::getline(reader, line)) {
+        std::istringstream fields(line);
+
+        std::string hash;
+        CacheEntry entry;
+
+        fields >> hash >> entry.Size >> entry.ModifiedTime;
+
+        // The path is the rest of the line after one space
+        std::string path;
+
+        if(fields.get() == ' ')
+            std::getline(fields, path);
+
+        if(!fields || path.empty() || hash.size() != MD5_SIZE * 2 ||
+            hash.find_first_not_of("0123456789abcdef") != std::string::npos) {
+            // Without the entry the file is just hashed again
+            continue;
+        }
+
+        md5::sig_from_string(entry.MD5.data(), hash.c_str());
+        Cache.insert_or_assign(std::move(path), entry);
+    }
+}
+
+bool PckSync::SaveCache() const
+{
+    const auto tmpWrite = CachePath + ".write";
+
+    {
+        std::ofstream writer(tmpWrite, std::ios::trunc | std::ios::out | std::ios::binary);
+
+        writer << SYNC_CACHE_HEADER << StartTime << "\n";
+
+        char hash[MD5_STRING_SIZE];
+
+        for(const auto& [path, entry] : Seen) {
+            md5::sig_to_string(entry.MD5.data(), hash, MD5_STRING_SIZE);
+
+            writer << hash << ' ' << entry.Size << ' ' << entry.ModifiedTime << ' ' << path
+                   << "\n";
+        }
+
+        if(!writer.good()) {
+            std::cout << "ERROR: writing the sync cache failed: " << tmpWrite << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpWrite, CachePath, error);
+
+    if(error) {
+        std::cout << "ERROR: replacing the sync cache failed: " << CachePath << "\n";
+        return false;
+    }
+
+    return true;
+}
+// ------------------------------------ //
+std::string PckSync::CachePathFor(const std::string& pckPath)
+{
+    return pckPath + ".sync";
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Define.h"
+
+#include "PckFile.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pcktool {
+
+class WorkerPool;
+
+//! \brief Brings the contents of a pck up to date with files on disk while reading as little
+//! as possible
+//!
+//! The size, modification time and MD5 of the source files are kept in a sidecar cache. Files
+//! that still have the cached size and modification time are known to have the cached MD5,
+//! the rest are hashed. Files are then compared against the pck directory by size and MD5 and
+//! only new and changed files are added to the pck.
+class PckSync {
+public:
+    struct Stats {
+        size_t Unchanged = 0;
+        size_t Added = 0;
+        size_t Changed = 0;
+        size_t Removed = 0;
+
+        //! Source files that had to be read to check them
+        size_t Hashed = 0;
+    };
+
+public:
+    PckSync(PckFile& pck, std::string cachePath);
+
+    //! \brief Sets a thread pool to hash files in parallel, not owned by this object
+    void SetWorkerPool(WorkerPool* pool)
+    {
+        Pool = pool;
+    }
+
+    //! \brief Compares a file or a directory tree against the pck and adds the new and changed
+    //! files to the pck
+    bool AddSource(const std::string& path, const std::string& stripPrefix, bool printChanges);
+
+    //! \brief Same as AddSource but for a single file with a known pck path
+    bool AddSourceFile(const std::string& path, std::string pckPath, bool printChanges);
+
+    //! \brief Same as AddSource for a list of files, which are hashed together
+    bool AddSourceFiles(const std::vector<std::string>& paths, const std::string& stripPrefix,
+        bool printChanges);
+
+    //! \brief Removes pck entries that didn't match any of the source files
+    void RemoveMissing(bool printChanges);
+
+    //! \brief Removes pck entries whose source files are known to be gone
+    void RemoveSources(const std::vector<std::string>& pckPaths, bool printChanges);
+
+    //! \brief Starts counting the stats from zero, for syncing again with the same cache
+    void ResetStats()
+    {
+        Result = Stats();
+    }
+
+    [[nodiscard]] bool HasChanges() const
+    {
+        return Result.Added + Result.Changed + Result.Removed > 0;
+    }
+
+    [[nodiscard]] const Stats& GetStats() const
+    {
+        return Result;
+    }
+
+    //! \returns True for the pck and the files the tool writes next to it (sync cache,
+    //! index, temporary files), which are never sources even when they are in a source folder
+    [[nodiscard]] bool IsOwnFile(const std::string& path) const;
+
+    //! \brief Writes the cache with the info of the source files seen by this sync
+    bool SaveCache() const;
+
+    //! \returns The sync cache path used for a pck
+    static std::string CachePathFor(const std::string& pckPath);
+
+private:
+    struct CacheEntry {
+        uint64_t Size = 0;
+
+        //! Modification time in file clock ticks
+        int64_t ModifiedTime = 0;
+
+        std::array<uint8_t, 16> MD5 = {0};
+    };
+
+    struct Source {
+        std::string Path;
+        std::string PckPath;
+        CacheEntry Info;
+    };
+
+    void LoadCache();
+
+    //! \brief Checks the sources against the pck, hashing the ones not in the cache
+    bool ProcessSources(std::vector<Source>& sources, bool printChanges);
+
+    //! \brief Calculates the MD5 of the sources
+    bool HashSources(std::vector<Source*>& sources);
+
+    //! \brief Adds a source to the list if it is included by the pck filters
+    bool AppendSource(std::string path, std::string pckPath, std::vector<Source>& sources);
+
+    //! \returns False if the file info couldn't be read (prints an error)
+    bool ReadSourceInfo(const std::string& path, Source& source) const;
+
+private:
+    PckFile& Pck;
+    const std::string CachePath;
+
+    //! Canonical folder and file name of the pck, compared in canonical form as the pck and
+    //! the sources can be given as relative or absolute paths
+    std::filesystem::path OwnFilesFolder;
+    std::string OwnFilesName;
+
+    WorkerPool* Pool = nullptr;
+
+    //! The cache from the previous sync
+    std::unordered_map<std::string, CacheEntry> Cache;
+
+    //! Files modified after this time (in file clock ticks) are not trusted from the cache
+    //! because they might have been modified again within the timestamp resolution
+    int64_t TrustedBefore = 0;
+
+    //! Info of the sources seen in this sync, these are also the pck paths that are kept by
+    //! RemoveMissing
+    std::map<std::string, CacheEntry> Seen;
+
+    //! When this sync started, saved to the cache
+    int64_t StartTime = 0;
+
+    Stats Result;
+};
+
+} // namespace pcktool
@@ -0,0 +1,373 @@
+// ------------------------------------ //
+#include "PlatformFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+using namespace pcktool;
+// ------------------------------------ //
+// ReadableFile
+ReadableFile::~ReadableFile()
+{
+    Close();
+}
+
+bool ReadableFile::Open(const std::string& path)
+{
+    Close();
+
+#ifndef _WIN32
+    Descriptor = ::open(path.c_str(), O_RDONLY);
+    return Descriptor >= 0;
+#else
+    Handle = std::fopen(path.c_str(), "rb");
+    return Handle != nullptr;
+#endif
+}
+
+void ReadableFile::OpenMemory(const char* data, uint64_t size)
+{
+    Close();
+
+    Memory = data;
+    MemorySize = size;
+}
+
+void ReadableFile::Close()
+{
+    Memory = nullptr;
+    MemorySize = 0;
+
+#ifndef _WIN32
+    if(Descriptor >= 0) {
+        ::close(Descriptor);
+        Descriptor = -1;
+    }
+#else
+    if(Handle != nullptr) {
+        std::fclose(Handle);
+        Handle = nullptr;
+    }
+#endif
+}
+
+bool ReadableFile::IsOpen() const
+{
+    if(Memory != nullptr)
+        return true;
+
+#ifndef _WIN32
+    return Descriptor >= 0;
+#else
+    return Handle != nullptr;
+#endif
+}
+
+bool ReadableFile::ReadAt(uint64_t offset, char* buffer, size_t size)
+{
+    if(Memory != nullptr) {
+        if(offset > MemorySize || size > MemorySize - offset)
+            return false;
+
+        std::memcpy(buffer, Memory + offset, size);
+        return true;
+    }
+
+#ifndef _WIN32
+    while(size > 0) {
+        const auto result = ::pread(Descriptor, buffer, size, static_cast<off_t>(offset));
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        // Unexpected end of file
+        if(result == 0)
+            return false;
+
+        buffer += result;
+        offset += result;
+        size -= static_cast<size_t>(result);
+    }
+
+    return true;
+#else
+    std::lock_guard<std::mutex> lock(HandleLock);
+
+    if(_fseeki64(Handle, static_cast<__int64>(offset), SEEK_SET) != 0)
+        return false;
+
+    return std::fread(buffer, 1, size, Handle) == size;
+#endif
+}
+
+void ReadableFile::AdviseSequential()
+{
+#if defined(__linux__)
+    if(Memory != nullptr)
+        return;
+
+    ::posix_fadvise(Descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+void ReadableFile::AdviseWillNeed(uint64_t offset, uint64_t size)
+{
+#if defined(__linux__)
+    if(Memory != nullptr)
+        return;
+
+    ::posix_fadvise(
+        Descriptor, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+int ReadableFile::GetDescriptor() const
+{
+#ifndef _WIN32
+    return Descriptor;
+#else
+    return -1;
+#endif
+}
+// ------------------------------------ //
+// WritableFile
+WritableFile::~WritableFile()
+{
+    Close();
+}
+
+bool WritableFile::Create(const std::string& path)
+{
+    Close();
+
+#ifndef _WIN32
+    Descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return Descriptor >= 0;
+#else
+    Handle = std::fopen(path.c_str(), "wb");
+    return Handle != nullptr;
+#endif
+}
+
+bool WritableFile::OpenForAppend(const std::string& path)
+{
+    Close();
+
+#ifndef _WIN32
+    Descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    return Descriptor >= 0;
+#else
+    Handle = std::fopen(path.c_str(), "ab");
+    return Handle != nullptr;
+#endif
+}
+
+void WritableFile::Preallocate(uint64_t size)
+{
+#if defined(__linux__)
+    // Unlike posix_fallocate this doesn't fall back to slowly writing zeros on filesystems
+    // that don't support allocation
+    if(size > 0)
+        ::fallocate(Descriptor, 0, 0, static_cast<off_t>(size));
+#else
+    (void)size;
+#endif
+}
+
+bool WritableFile::Write(const char* data, size_t size)
+{
+#ifndef _WIN32
+    while(size > 0) {
+        const auto result = ::write(Descriptor, data, size);
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += result;
+        size -= static_cast<size_t>(result);
+    }
+
+    return true;
+#else
+    return std::fwrite(data, 1, size, Handle) == size;
+#endif
+}
+
+uint64_t WritableFile::CopyFrom(const ReadableFile& source, uint64_t offset, uint64_t size)
+{
+#if defined(__linux__)
+    // Limits each call to stay within what the kernel does in one go
+    constexpr uint64_t maxChunk = 1024 * 1024 * 1024;
+
+    const int sourceDescriptor = source.GetDescriptor();
+
+    if(sourceDescriptor < 0 || Descriptor < 0)
+        return 0;
+
+    auto position = static_cast<off_t>(offset);
+    uint64_t copied = 0;
+    bool useCopyRange = true;
+
+    while(copied < size) {
+        const auto amount = static_cast<size_t>(std::min(size - copied, maxChunk));
+
+        ssize_t result;
+
+        if(useCopyRange) {
+            result = ::copy_file_range(
+                sourceDescriptor, &position, Descriptor, nullptr, amount, 0);
+
+            // Not supported by the kernel or between these filesystems
+            if(result < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                                 errno == EOPNOTSUPP || errno == EBADF)) {
+                useCopyRange = false;
+                continue;
+            }
+        } else {
+            result = ::sendfile(Descriptor, sourceDescriptor, &position, amount);
+        }
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        // Unexpected end of the source file
+        if(result == 0)
+            break;
+
+        copied += static_cast<uint64_t>(result);
+    }
+
+    return copied;
+#else
+    (void)source;
+    (void)offset;
+    (void)size;
+    return 0;
+#endif
+}
+
+bool WritableFile::Sync()
+{
+#ifndef _WIN32
+    return ::fsync(Descriptor) == 0;
+#else
+    return std::fflush(Handle) == 0 && _commit(_fileno(Handle)) == 0;
+#endif
+}
+
+bool WritableFile::SyncFilesystem()
+{
+#if defined(__linux__)
+    return ::syncfs(Descriptor) == 0;
+#elif !defined(_WIN32)
+    ::sync();
+    return Sync();
+#else
+    return Sync();
+#endif
+}
+
+bool WritableFile::Close()
+{
+#ifndef _WIN32
+    if(Descriptor < 0)
+        return true;
+
+    const bool success = ::close(Descriptor) == 0;
+    Descriptor = -1;
+    return success;
+#else
+    if(Handle == nullptr)
+        return true;
+
+    const bool success = std::fclose(Handle) == 0;
+    Handle = nullptr;
+    return success;
+#endif
+}
+
+int WritableFile::GetDescriptor() const
+{
+#ifndef _WIN32
+    return Descriptor;
+#else
+    return -1;
+#endif
+}
+
+bool WritableFile::CanSyncFilesystem()
+{
+#ifndef _WIN32
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool WritableFile::SyncFilesystemOf(const std::string& path)
+{
+#if defined(__linux__)
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+
+    if(descriptor < 0)
+        return false;
+
+    const bool success = ::syncfs(descriptor) == 0;
+    ::close(descriptor);
+    return success;
+#elif !defined(_WIN32)
+    (void)path;
+    ::sync();
+    return true;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+bool WritableFile::SyncDirectory(const std::string& path)
+{
+#ifndef _WIN32
+    const int descriptor = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+
+    if(descriptor < 0)
+        return false;
+
+    // Some filesystems don't support syncing directories, their metadata is then already safe
+    const bool success = ::fsync(descriptor) == 0 || errno == EINVAL;
+    ::close(descriptor);
+    return success;
+#else
+    (void)path;
+    return true;
+#endif
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Define.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace pcktool {
+
+//! \brief Read only file that supports reading from an offset
+//!
+//! Reads don't share a file position so ReadAt can be used from multiple threads. On
+//! platforms without positional reads the reads are serialized with a lock. Can also read
+//! from a buffer in memory in place of a file.
+class ReadableFile {
+public:
+    ReadableFile() = default;
+    ~ReadableFile();
+
+    ReadableFile(ReadableFile&& other) = delete;
+    ReadableFile(const ReadableFile& other) = delete;
+
+    ReadableFile& operator=(ReadableFile&& other) = delete;
+    ReadableFile& operator=(const ReadableFile& other) = delete;
+
+    bool Open(const std::string& path);
+
+    //! \brief Reads from a buffer instead of a file, the data must stay alive and unchanged
+    //! while this is open
+    void OpenMemory(const char* data, uint64_t size);
+
+    void Close();
+
+    [[nodiscard]] bool IsOpen() const;
+
+    //! \returns True if reading from memory
+    [[nodiscard]] bool IsMemory() const
+    {
+        return Memory != nullptr;
+    }
+
+    //! \returns False if the full amount of data couldn't be read
+    bool ReadAt(uint64_t offset, char* buffer, size_t size);
+
+    //! \brief Hints that the file is going to be read mostly sequentially
+    void AdviseSequential();
+
+    //! \brief Hints that a range is going to be read soon so that the OS can start reading it
+    void AdviseWillNeed(uint64_t offset, uint64_t size);
+
+    //! \returns The OS file descriptor or -1 if not available on this platform
+    [[nodiscard]] int GetDescriptor() const;
+
+private:
+    const char* Memory = nullptr;
+    uint64_t MemorySize = 0;
+
+#ifndef _WIN32
+    int Descriptor = -1;
+#else
+    std::FILE* Handle = nullptr;
+    std::mutex HandleLock;
+#endif
+};
+
+//! \brief File for writing sequentially, with support for preallocating space
+class WritableFile {
+public:
+    WritableFile() = default;
+    ~WritableFile();
+
+    WritableFile(WritableFile&& other) = delete;
+    WritableFile(const WritableFile& other) = delete;
+
+    WritableFile& operator=(WritableFile&& other) = delete;
+    WritableFile& operator=(const WritableFile& other) = delete;
+
+    //! \brief Creates (or truncates) a file for writing
+    bool Create(const std::string& path);
+
+    //! \brief Opens a file for writing at its end, creating it if it doesn't exist
+    bool OpenForAppend(const std::string& path);
+
+    //! \brief Reserves disk space for the file to avoid fragmentation, failure is not an
+    //! error as not all filesystems support this
+    void Preallocate(uint64_t size);
+
+    bool Write(const char* data, size_t size);
+
+    //! \brief Appends a range of another file without copying the data through user space
+    //!
+    //! Uses copy_file_range (which lets filesystems with reflinks share the data) and falls
+    //! back to sendfile. Only available on Linux.
+    //! \returns The number of bytes copied, less than size if the OS can't copy (the rest)
+    //! this way and the caller has to copy the data itself
+    uint64_t CopyFrom(const ReadableFile& source, uint64_t offset, uint64_t size);
+
+    //! \brief Waits until the written data is on disk
+    bool Sync();
+
+    //! \brief Waits until all data written to the filesystem this file is on is on disk
+    //!
+    //! This is much faster than syncing many files one by one. Only Linux can limit this to
+    //! one filesystem, other platforms sync everything or only this file.
+    bool SyncFilesystem();
+
+    //! \returns False if there was a write error when closing
+    bool Close();
+
+    [[nodiscard]] int GetDescriptor() const;
+
+    //! \returns True if SyncFilesystem also waits for the data of other files, so that many
+    //! files can be synced with one call. On Windows it only syncs the file itself.
+    static bool CanSyncFilesystem();
+
+    //! \brief Same as SyncFilesystem for the filesystem a file or a directory is on
+    //!
+    //! Does nothing on Windows, where CanSyncFilesystem tells that the files need to be synced
+    //! one by one instead.
+    static bool SyncFilesystemOf(const std::string& path);
+
+    //! \brief Waits until changes to the entries of a directory (like a rename into it) are on
+    //! disk. Does nothing on Windows where this isn't possible or needed.
+    static bool SyncDirectory(const std::string& path);
+
+private:
+#ifndef _WIN32
+    int Descriptor = -1;
+#else
+    std::FILE* Handle = nullptr;
+#endif
+};
+
+} // namespace pcktool
@@ -0,0 +1,175 @@
+// ------------------------------------ //
+#include "ProgressReporter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace pcktool;
+
+//! The bar is redrawn often enough to look alive, JSON lines are kept less frequent to not
+//! flood logs
+constexpr auto BAR_INTERVAL = std::chrono::milliseconds(200);
+constexpr auto JSON_INTERVAL = std::chrono::milliseconds(1000);
+
+constexpr int BAR_WIDTH = 30;
+
+static std::string FormatBytes(double bytes)
+{
+    static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+
+    size_t unit = 0;
+
+    while(bytes >= 1024 && unit + 1 < std::size(units)) {
+        bytes /= 1024;
+        ++unit;
+    }
+
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << " "
+           << units[unit];
+    return stream.str();
+}
+// ------------------------------------ //
+ProgressReporter::ProgressReporter(Style style, std::ostream& output) :
+    OutputStyle(style), Output(output), Thread([this]() { Run(); })
+{
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    End();
+
+    {
+        std::lock_guard<std::mutex> lock(Lock);
+        Quit = true;
+    }
+
+    Wake.notify_all();
+    Thread.join();
+}
+// ------------------------------------ //
+void ProgressReporter::Begin(std::string operation, uint64_t totalFiles, uint64_t totalBytes)
+{
+    End();
+
+    std::lock_guard<std::mutex> lock(Lock);
+
+    Operation = std::move(operation);
+    TotalFiles = totalFiles;
+    TotalBytes = totalBytes;
+
+    FilesDone = 0;
+    BytesDone = 0;
+
+    Started = std::chrono::steady_clock::now();
+    LastReport = Started;
+    LastBytes = 0;
+    Rate = 0;
+
+    Active = true;
+}
+
+void ProgressReporter::End()
+{
+    std::lock_guard<std::mutex> lock(Lock);
+
+    if(!Active)
+        return;
+
+    Report(true);
+    Active = false;
+}
+// ------------------------------------ //
+ProgressReporter::Style ProgressReporter::DefaultStyleFor(bool terminal)
+{
+    return terminal ? Style::Bar : Style::JSON;
+}
+
+bool ProgressReporter::IsErrorTerminal()
+{
+#ifdef _WIN32
+    return _isatty(_fileno(stderr)) != 0;
+#else
+    return isatty(STDERR_FILENO) != 0;
+#endif
+}
+// ------------------------------------ //
+void ProgressReporter::Run()
+{
+    const auto interval = OutputStyle == Style::Bar ? BAR_INTERVAL : JSON_INTERVAL;
+
+    std::unique_lock<std::mutex> lock(Lock);
+
+    while(!Quit) {
+        Wake.wait_for(lock, interval);
+
+        if(Active && !Quit)
+            Report(false);
+    }
+}
+
+void ProgressReporter::Report(bool final)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto files = FilesDone.load(std::memory_order_relaxed);
+    const auto bytes = BytesDone.load(std::memory_order_relaxed);
+
+    const std::chrono::duration<double> elapsed = now - Started;
+    const std::chrono::duration<double> sinceLast = now - LastReport;
+
+    // The rate since the previous report follows changes in speed, the final report shows the
+    // average instead
+    if(final) {
+        Rate = elapsed.count() > 0 ? bytes / elapsed.count() : 0;
+    } else if(sinceLast.count() > 0) {
+        Rate = (bytes - LastBytes) / sinceLast.count();
+    }
+
+    LastReport = now;
+    LastBytes = bytes;
+
+    std::ostringstream line;
+
+    if(OutputStyle == Style::JSON) {
+        line << "{\"operation\":\"" << Operation << "\",\"files_done\":" << files
+             << ",\"files_total\":" << TotalFiles << ",\"bytes_done\":" << bytes
+             << ",\"bytes_total\":" << TotalBytes << ",\"bytes_per_second\":"
+             << static_cast<uint64_t>(Rate) << ",\"elapsed\":" << std::fixed
+             << std::setprecision(1) << elapsed.count()
+             << ",\"finished\":" << (final ? "true" : "false") << "}\n";
+    } else {
+        // Bytes show the progress better as files can have very different sizes
+        double fraction = 1;
+
+        if(TotalBytes > 0) {
+            fraction = static_cast<double>(bytes) / TotalBytes;
+        } else if(TotalFiles > 0) {
+            fraction = static_cast<double>(files) / TotalFiles;
+        }
+
+        fraction = std::clamp(fraction, 0.0, 1.0);
+        const auto filled = static_cast<int>(fraction * BAR_WIDTH);
+
+        // Padded with spaces so that a shorter line fully covers the previous one
+        line << "\r" << Operation << " [" << std::string(filled, '#')
+             << std::string(BAR_WIDTH - filled, '-') << "] " << std::setw(3)
+             << static_cast<int>(fraction * 100) << "% " << files << "/"
+             << TotalFiles << " files " << FormatBytes(static_cast<double>(bytes)) << " / "
+             << FormatBytes(static_cast<double>(TotalBytes)) << " "
+             << FormatBytes(Rate) << "/s   ";
+
+        if(final)
+            line << "\n";
+    }
+
+    Output << line.str() << std::flush;
+}
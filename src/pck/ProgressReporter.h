@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Define.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace pcktool {
+
+//! \brief Shows the progress of a long operation from a separate thread
+//!
+//! Workers only add to atomic counters, the output is written by a thread of this object at
+//! a fixed interval, so reporting never slows down or blocks the actual work.
+class ProgressReporter {
+public:
+    enum class Style {
+        //! A single line that is redrawn, for terminals
+        Bar,
+        //! One JSON object per line, for logs and other programs
+        JSON
+    };
+
+public:
+    //! \param output Where the progress is written, usually std::cerr
+    ProgressReporter(Style style, std::ostream& output);
+    ~ProgressReporter();
+
+    ProgressReporter(ProgressReporter&& other) = delete;
+    ProgressReporter(const ProgressReporter& other) = delete;
+
+    ProgressReporter& operator=(ProgressReporter&& other) = delete;
+    ProgressReporter& operator=(const ProgressReporter& other) = delete;
+
+    //! \brief Starts reporting a new operation, finishing the previous one
+    void Begin(std::string operation, uint64_t totalFiles, uint64_t totalBytes);
+
+    //! \brief Marks work as done, can be called from any thread
+    void Add(uint64_t files, uint64_t bytes)
+    {
+        FilesDone.fetch_add(files, std::memory_order_relaxed);
+        BytesDone.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    //! \brief Writes the final state of the current operation and stops reporting it
+    void End();
+
+    //! \brief Picks the bar for terminals and JSON lines otherwise
+    static Style DefaultStyleFor(bool terminal);
+
+    //! \returns True if standard error is a terminal
+    static bool IsErrorTerminal();
+
+private:
+    void Run();
+
+    //! \brief Writes the current state, the caller must hold Lock
+    void Report(bool final);
+
+private:
+    const Style OutputStyle;
+    std::ostream& Output;
+
+    std::atomic<uint64_t> FilesDone{0};
+    std::atomic<uint64_t> BytesDone{0};
+
+    //! The rest are protected by Lock
+    std::mutex Lock;
+    std::condition_variable Wake;
+
+    std::string Operation;
+    uint64_t TotalFiles = 0;
+    uint64_t TotalBytes = 0;
+    bool Active = false;
+    bool Quit = false;
+
+    std::chrono::steady_clock::time_point Started;
+
+    //! For calculating the current rate between reports
+    std::chrono::steady_clock::time_point LastReport;
+    uint64_t LastBytes = 0;
+    double Rate = 0;
+
+    std::thread Thread;
+};
+
+} // namespace pcktool
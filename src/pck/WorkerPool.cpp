@@ -0,0 +1,192 @@
+// ------------------------------------ //
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+using namespace pcktool;
+
+namespace {
+
+//! Pool and queue index of the current thread if it is a worker
+thread_local const WorkerPool* CurrentPool = nullptr;
+thread_local size_t CurrentQueue = 0;
+
+} // namespace
+
+// ------------------------------------ //
+// TaskGroup
+WorkerPool::TaskGroup::TaskGroup(WorkerPool& pool) : Pool(pool) {}
+
+WorkerPool::TaskGroup::~TaskGroup()
+{
+    // Tasks reference the group so they must all finish before it is destroyed
+    try {
+        Wait();
+    } catch(...) {
+    }
+}
+
+void WorkerPool::TaskGroup::Run(Task task)
+{
+    ++Pending;
+
+    Pool.Submit([this, task = std::move(task)]() {
+        try {
+            task();
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(Lock);
+
+            if(!FirstError)
+                FirstError = std::current_exception();
+        }
+
+        // Done under the lock so that Wait can't return (and the group be destroyed) before
+        // this is done with the group
+        std::lock_guard<std::mutex> lock(Lock);
+
+        if(--Pending == 0)
+            Finished.notify_all();
+    });
+}
+
+void WorkerPool::TaskGroup::Wait()
+{
+    while(Pending > 0) {
+        // Help with the work instead of just blocking
+        if(Pool.RunOneTask())
+            continue;
+
+        std::unique_lock<std::mutex> lock(Lock);
+        Finished.wait_for(lock, std::chrono::milliseconds(1), [this]() { return Pending == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(Lock);
+
+    if(FirstError) {
+        auto error = FirstError;
+        FirstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+// ------------------------------------ //
+// WorkerPool
+WorkerPool::WorkerPool(unsigned threads)
+{
+    threads = ResolveThreadCount(threads);
+
+    for(unsigned i = 0; i < threads; ++i)
+        Queues.push_back(std::make_unique<Queue>());
+
+    for(unsigned i = 0; i < threads; ++i)
+        Threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(SleepLock);
+        Stop = true;
+    }
+
+    WakeUp.notify_all();
+
+    for(auto& thread : Threads)
+        thread.join();
+}
+
+unsigned WorkerPool::ResolveThreadCount(unsigned threads)
+{
+    if(threads > 0)
+        return threads;
+
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+// ------------------------------------ //
+void WorkerPool::Submit(Task task)
+{
+    // Workers push to their own queue, other threads spread the tasks out
+    const size_t index =
+        CurrentPool == this ? CurrentQueue : NextQueue.fetch_add(1) % Queues.size();
+
+    // Counted before adding so that the count is never lower than the real amount
+    ++QueuedTasks;
+
+    {
+        std::lock_guard<std::mutex> lock(Queues[index]->Lock);
+        Queues[index]->Tasks.push_back(std::move(task));
+    }
+
+    {
+        // Lock to not miss a worker that is just about to start waiting
+        std::lock_guard<std::mutex> lock(SleepLock);
+    }
+
+    WakeUp.notify_one();
+}
+
+bool WorkerPool::RunOneTask()
+{
+    Task task;
+
+    if(!PopTask(task))
+        return false;
+
+    task();
+    return true;
+}
+
+bool WorkerPool::PopTask(Task& task)
+{
+    if(QueuedTasks == 0)
+        return false;
+
+    const size_t own = CurrentPool == this ? CurrentQueue : 0;
+
+    // The newest own task is the most likely to have its data in cache
+    if(CurrentPool == this) {
+        auto& queue = *Queues[own];
+        std::lock_guard<std::mutex> lock(queue.Lock);
+
+        if(!queue.Tasks.empty()) {
+            task = std::move(queue.Tasks.back());
+            queue.Tasks.pop_back();
+            --QueuedTasks;
+            return true;
+        }
+    }
+
+    // Steal the oldest task from another queue
+    for(size_t i = 0; i < Queues.size(); ++i) {
+        auto& queue = *Queues[(own + i) % Queues.size()];
+        std::lock_guard<std::mutex> lock(queue.Lock);
+
+        if(!queue.Tasks.empty()) {
+            task = std::move(queue.Tasks.front());
+            queue.Tasks.pop_front();
+            --QueuedTasks;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::WorkerLoop(size_t index)
+{
+    CurrentPool = this;
+    CurrentQueue = index;
+
+    while(true) {
+        if(RunOneTask())
+            continue;
+
+        std::unique_lock<std::mutex> lock(SleepLock);
+
+        WakeUp.wait(lock, [this]() { return Stop || QueuedTasks > 0; });
+
+        if(Stop && QueuedTasks == 0)
+            return;
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Define.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pcktool {
+
+//! \brief Work stealing thread pool
+//!
+//! Each worker has its own task queue. Tasks queued from a worker go to its own queue and
+//! idle workers steal tasks from the other queues, so nested work (for example files of a pck
+//! inside a task processing the whole pck) spreads over all threads.
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    //! \brief A set of tasks that can be waited for
+    //!
+    //! Waiting runs queued tasks on the waiting thread, so waiting from inside a task doesn't
+    //! block a worker.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(WorkerPool& pool);
+        ~TaskGroup();
+
+        TaskGroup(TaskGroup&& other) = delete;
+        TaskGroup(const TaskGroup& other) = delete;
+
+        TaskGroup& operator=(TaskGroup&& other) = delete;
+        TaskGroup& operator=(const TaskGroup& other) = delete;
+
+        void Run(Task task);
+
+        //! \brief Waits for all tasks in this group to finish
+        //! \exception Rethrows the first exception thrown by a task
+        void Wait();
+
+    private:
+        WorkerPool& Pool;
+
+        std::atomic<size_t> Pending{0};
+
+        std::mutex Lock;
+        std::condition_variable Finished;
+        std::exception_ptr FirstError;
+    };
+
+public:
+    //! \param threads Number of worker threads, 0 uses the number of CPU cores
+    explicit WorkerPool(unsigned threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool&& other) = delete;
+    WorkerPool(const WorkerPool& other) = delete;
+
+    WorkerPool& operator=(WorkerPool&& other) = delete;
+    WorkerPool& operator=(const WorkerPool& other) = delete;
+
+    [[nodiscard]] unsigned GetThreadCount() const
+    {
+        return static_cast<unsigned>(Threads.size());
+    }
+
+    //! \brief Resolves a thread count option where 0 means all CPU cores
+    static unsigned ResolveThreadCount(unsigned threads);
+
+private:
+    struct Queue {
+        std::mutex Lock;
+        std::deque<Task> Tasks;
+    };
+
+    void Submit(Task task);
+
+    //! \brief Runs one queued task, own queue first and then stealing from others
+    //! \returns False if there were no tasks
+    bool RunOneTask();
+
+    bool PopTask(Task& task);
+
+    void WorkerLoop(size_t index);
+
+private:
+    std::vector<std::unique_ptr<Queue>> Queues;
+    std::vector<std::thread> Threads;
+
+    std::atomic<size_t> QueuedTasks{0};
+    std::atomic<size_t> NextQueue{0};
+
+    std::mutex SleepLock;
+    std::condition_variable WakeUp;
+    bool Stop = false;
+};
+
+} // namespace pcktool
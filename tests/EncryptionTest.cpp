@@ -0,0 +1,185 @@
+// Checks the AES-256 CFB implementations against the known answers from FIPS-197 and
+// NIST SP 800-38A, and that the AES-NI and software implementations give the same results
+//
+// Usage: encryptiontest
+#include "pck/Encryption.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pcktool;
+
+static std::vector<uint8_t> FromHex(const std::string& hex)
+{
+    std::vector<uint8_t> result;
+
+    for(size_t i = 0; i + 1 < hex.size(); i += 2)
+        result.push_back(static_cast<uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+
+    return result;
+}
+
+static EncryptionKey KeyFromHex(const std::string& hex)
+{
+    EncryptionKey key{};
+
+    if(!ParseEncryptionKey(hex, key))
+        std::cout << "ERROR: invalid test key: " << hex << "\n";
+
+    return key;
+}
+
+static AESCipher::IV IVFromHex(const std::string& hex)
+{
+    AESCipher::IV iv{};
+    const auto bytes = FromHex(hex);
+    std::copy(bytes.begin(), bytes.end(), iv.begin());
+    return iv;
+}
+
+//! \brief Encrypts and decrypts the plaintext, both at once and one block per call
+static bool CheckKnownAnswer(const char* name, const AESCipher& cipher,
+    const std::string& ivHex, const std::string& plainHex, const std::string& cipherHex)
+{
+    const auto plainText = FromHex(plainHex);
+    const auto expected = FromHex(cipherHex);
+
+    for(const size_t chunk : {plainText.size(), AES_BLOCK_SIZE}) {
+        auto data = plainText;
+        auto iv = IVFromHex(ivHex);
+
+        for(size_t offset = 0; offset < data.size(); offset += chunk)
+            cipher.EncryptCFB(data.data() + offset, chunk, iv);
+
+        if(data != expected) {
+            std::cout << "ERROR: " << name << ": wrong ciphertext with " << chunk
+                      << " byte chunks\n";
+            return false;
+        }
+
+        iv = IVFromHex(ivHex);
+
+        for(size_t offset = 0; offset < data.size(); offset += chunk)
+            cipher.DecryptCFB(data.data() + offset, chunk, iv);
+
+        if(data != plainText) {
+            std::cout << "ERROR: " << name << ": wrong plaintext with " << chunk
+                      << " byte chunks\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool CheckImplementation(bool hardware)
+{
+    const char* name = hardware ? "AES-NI" : "software";
+    bool success = true;
+
+    // FIPS-197 appendix C.3. With zero data CFB outputs the encrypted IV, so this checks a
+    // single block encryption
+    const AESCipher fipsCipher(
+        KeyFromHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"),
+        hardware);
+
+    if(fipsCipher.UsesHardware() != hardware) {
+        std::cout << "ERROR: " << name << ": the wrong implementation was used\n";
+        return false;
+    }
+
+    success &= CheckKnownAnswer(name, fipsCipher, "00112233445566778899aabbccddeeff",
+        "00000000000000000000000000000000", "8ea2b7ca516745bfeafc49904b496089");
+
+    // SP 800-38A F.3.17 (CFB128-AES256.Encrypt) and F.3.18 (decrypt)
+    const AESCipher cfbCipher(
+        KeyFromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4"),
+        hardware);
+
+    success &= CheckKnownAnswer(name, cfbCipher, "000102030405060708090a0b0c0d0e0f",
+        "6bc1bee22e409f96e93d7e117393172a"
+        "ae2d8a571e03ac9c9eb76fac45af8e51"
+        "30c81c46a35ce411e5fbc1191a0a52ef"
+        "f69f2445df4f9b17ad2b417be66c3710",
+        "dc7e84bfda79164b7ecd8486985d3860"
+        "39ffed143b28b1c832113c6331e5407b"
+        "df10132415e54b92a13ed0a8267ae2f9"
+        "75a385741ab9cef82031623d55b1e471");
+
+    if(success)
+        std::cout << name << ": known answers OK\n";
+
+    return success;
+}
+
+//! \brief Decryption with AES-NI processes multiple blocks at once, this checks all the
+//! remainders against the software implementation
+static bool CheckImplementationsMatch()
+{
+    std::mt19937 random(4);
+
+    EncryptionKey key;
+    AESCipher::IV startIV;
+
+    for(auto& byte : key)
+        byte = static_cast<uint8_t>(random());
+
+    for(auto& byte : startIV)
+        byte = static_cast<uint8_t>(random());
+
+    const AESCipher hardware(key, true);
+    const AESCipher software(key, false);
+
+    for(size_t blocks = 0; blocks <= 40; ++blocks) {
+        std::vector<uint8_t> plainText(blocks * AES_BLOCK_SIZE);
+
+        for(auto& byte : plainText)
+            byte = static_cast<uint8_t>(random());
+
+        auto hardwareData = plainText;
+        auto softwareData = plainText;
+        auto hardwareIV = startIV;
+        auto softwareIV = startIV;
+
+        hardware.EncryptCFB(hardwareData.data(), hardwareData.size(), hardwareIV);
+        software.EncryptCFB(softwareData.data(), softwareData.size(), softwareIV);
+
+        if(hardwareData != softwareData || hardwareIV != softwareIV) {
+            std::cout << "ERROR: encrypting " << blocks << " blocks gives different results\n";
+            return false;
+        }
+
+        hardwareIV = startIV;
+        softwareIV = startIV;
+
+        hardware.DecryptCFB(hardwareData.data(), hardwareData.size(), hardwareIV);
+        software.DecryptCFB(softwareData.data(), softwareData.size(), softwareIV);
+
+        if(hardwareData != plainText || softwareData != plainText ||
+            hardwareIV != softwareIV) {
+            std::cout << "ERROR: decrypting " << blocks << " blocks gives different results\n";
+            return false;
+        }
+    }
+
+    std::cout << "AES-NI and software results match\n";
+    return true;
+}
+
+int main()
+{
+    bool success = CheckImplementation(false);
+
+    if(AESCipher::HasHardwareSupport()) {
+        success &= CheckImplementation(true);
+        success &= CheckImplementationsMatch();
+    } else {
+        std::cout << "The CPU doesn't support AES-NI, only the software implementation is "
+                     "checked\n";
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Checks that an encrypted pck made by the tool extracts back to its files.
+
+Makes a pck with the files and directory encrypted, checks that none of the
+file contents are stored as plaintext, that it can't be read with the wrong
+key and that verifying and extracting it with the right key gives back the
+original files. The extraction is also done with a small memory limit so that
+the data is decrypted in chunks.
+
+Usage: encryption_roundtrip_test.py <godotpcktool> <work folder>
+"""
+
+import filecmp
+import os
+import random
+import shutil
+import subprocess
+import sys
+
+ENCRYPTION_KEY = "cd" * 32
+WRONG_KEY = "ce" * 32
+
+
+def run_tool(tool, *args, expect_success=True):
+    result = subprocess.run([tool, *args], stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+
+    if (result.returncode == 0) != expect_success:
+        raise AssertionError("tool {} ({}): {}\n{}".format(
+            "failed" if expect_success else "didn't fail", result.returncode,
+            " ".join(args), result.stdout))
+
+
+def make_source_files(folder):
+    """Sizes around the AES block size and larger than the streaming chunks"""
+    generator = random.Random(33)
+
+    sizes = [0, 1, 15, 16, 17, 31, 32, 33, 1000, 65536, 3 * 1024 * 1024 + 5]
+    paths = []
+
+    for index, size in enumerate(sizes):
+        path = os.path.join(folder, "dir{}".format(index % 3),
+                            "file{}.bin".format(index))
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+
+        with open(path, "wb") as file:
+            file.write(bytes(generator.getrandbits(8) for _ in range(size)))
+
+        paths.append(path)
+
+    return paths
+
+
+def compare_folders(expected, actual):
+    comparison = filecmp.dircmp(expected, actual)
+    assert not comparison.left_only and not comparison.right_only, \
+        "extracted files differ: {} {}".format(comparison.left_only, comparison.right_only)
+
+    for name in comparison.common_files:
+        assert filecmp.cmp(os.path.join(expected, name), os.path.join(actual, name),
+                           shallow=False), "extracted data differs: " + name
+
+    for name in comparison.common_dirs:
+        compare_folders(os.path.join(expected, name), os.path.join(actual, name))
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+
+    tool = os.path.abspath(sys.argv[1])
+    work = os.path.abspath(sys.argv[2])
+
+    shutil.rmtree(work, ignore_errors=True)
+    source = os.path.join(work, "source")
+    os.makedirs(source)
+
+    paths = make_source_files(source)
+
+    pck = os.path.join(work, "test.pck")
+    run_tool(tool, pck, "-a", "add", source, "--remove-prefix", source,
+             "--set-godot-version", "4.3.0", "--encryption-key", ENCRYPTION_KEY,
+             "--encrypt-files", ".*", "--encrypt-directory")
+
+    with open(pck, "rb") as file:
+        data = file.read()
+
+    for path in paths:
+        with open(path, "rb") as file:
+            contents = file.read()
+
+        if len(contents) >= 16:
+            assert contents[:16] not in data, "plaintext found in pck: " + path
+
+    run_tool(tool, pck, "-a", "list", expect_success=False)
+    run_tool(tool, pck, "-a", "list", "--encryption-key", WRONG_KEY, expect_success=False)
+
+    run_tool(tool, pck, "-a", "verify", "--encryption-key", ENCRYPTION_KEY)
+
+    for options in ([], ["--max-memory", "1M"]):
+        output = os.path.join(work, "output")
+        shutil.rmtree(output, ignore_errors=True)
+
+        run_tool(tool, pck, "-a", "extract", "-o", output, "--encryption-key",
+                 ENCRYPTION_KEY, *options)
+        compare_folders(source, output)
+
+    print("Encrypted and extracted {} files".format(len(paths)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""Checks the range manifests of a pck by fetching the ranges over HTTP.
+
+Makes a pck with the tool, writes its manifests (binary and JSON, with and
+without coalescing) and serves the pck with a local HTTP server that handles
+range requests, like a web server hosting it would. Each range group is
+fetched and the data of each file in it is compared with its MD5 in the
+manifest.
+
+Usage: manifest_ranges_test.py <godotpcktool> <work folder>
+"""
+
+import hashlib
+import http.server
+import json
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import threading
+import urllib.request
+
+MANIFEST_MAGIC = 0x4D504347
+MANIFEST_VERSION = 1
+
+HEADER_FORMAT = "<IIQIIQQ"
+ENTRY_FORMAT = "<QQQQ16sII"
+GROUP_FORMAT = "<QQII"
+
+PCK_FILE_ENCRYPTED = 1
+
+ENCRYPTION_KEY = "ab" * 32
+
+
+class RangeHandler(http.server.BaseHTTPRequestHandler):
+    """Serves single byte ranges of the files in a folder"""
+
+    root = ""
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        path = os.path.join(self.root, os.path.basename(self.path))
+        requested = self.headers.get("Range", "")
+
+        if not requested.startswith("bytes=") or not os.path.isfile(path):
+            self.send_error(400)
+            return
+
+        first, last = (int(value) for value in requested[6:].split("-"))
+
+        with open(path, "rb") as file:
+            file.seek(first)
+            data = file.read(last - first + 1)
+
+        self.send_response(206)
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header(
+            "Content-Range",
+            "bytes {}-{}/{}".format(first, last, os.path.getsize(path)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def path_hash(path):
+    """64-bit FNV-1a, the same as the tool uses"""
+    value = 0xCBF29CE484222325
+
+    for byte in path.encode():
+        value = ((value ^ byte) * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+
+    return value
+
+
+def run_tool(tool, *args):
+    result = subprocess.run([tool, *args], stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+
+    if result.returncode != 0:
+        raise AssertionError("tool failed ({}): {}\n{}".format(
+            result.returncode, " ".join(args), result.stdout))
+
+
+def make_source_files(folder):
+    """Files of many sizes, including empty and duplicate files"""
+    generator = random.Random(4)
+
+    sizes = [0, 0, 1, 15, 16, 17, 100, 4095, 4096, 4097, 70000, 300000]
+    sizes += [generator.randrange(1, 3000) for _ in range(60)]
+
+    for index, size in enumerate(sizes):
+        path = os.path.join(folder, "dir{}".format(index % 4),
+                            "file{}.bin".format(index))
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+
+        with open(path, "wb") as file:
+            file.write(bytes(generator.getrandbits(8) for _ in range(size)))
+
+    shutil.copy(os.path.join(folder, "dir2", "file6.bin"),
+                os.path.join(folder, "copy.bin"))
+
+    os.makedirs(os.path.join(folder, "secret"))
+
+    with open(os.path.join(folder, "secret", "data.bin"), "wb") as file:
+        file.write(bytes(generator.getrandbits(8) for _ in range(5000)))
+
+
+def read_binary_manifest(path):
+    with open(path, "rb") as file:
+        data = file.read()
+
+    magic, version, pck_size, entry_count, group_count, entries_offset, \
+        groups_offset = struct.unpack_from(HEADER_FORMAT, data, 0)
+
+    assert magic == MANIFEST_MAGIC, "wrong manifest magic"
+    assert version == MANIFEST_VERSION, "wrong manifest version"
+
+    entry_size = struct.calcsize(ENTRY_FORMAT)
+    group_size = struct.calcsize(GROUP_FORMAT)
+
+    entries = [struct.unpack_from(ENTRY_FORMAT, data, entries_offset + i * entry_size)
+               for i in range(entry_count)]
+    groups = [struct.unpack_from(GROUP_FORMAT, data, groups_offset + i * group_size)
+              for i in range(group_count)]
+
+    assert groups_offset + group_count * group_size == len(data), \
+        "manifest has extra data"
+
+    return pck_size, entries, groups
+
+
+def fetch(url, offset, length):
+    request = urllib.request.Request(
+        url, headers={"Range": "bytes={}-{}".format(offset, offset + length - 1)})
+
+    with urllib.request.urlopen(request) as response:
+        assert response.status == 206, "server didn't return a range"
+        return response.read()
+
+
+def check_manifests(pck, binary_path, json_path, url, expected_files):
+    pck_size, entries, groups = read_binary_manifest(binary_path)
+
+    with open(json_path) as file:
+        document = json.load(file)
+
+    assert pck_size == os.path.getsize(pck), "wrong pck size in manifest"
+    assert document["pckSize"] == pck_size, "JSON and binary pck sizes differ"
+    assert len(entries) == expected_files, "wrong number of files in manifest"
+    assert len(document["files"]) == len(entries), "JSON has a different file count"
+    assert len(document["groups"]) == len(groups), "JSON has a different group count"
+
+    hashes = [entry[0] for entry in entries]
+    assert hashes == sorted(hashes), "entries are not sorted by path hash"
+
+    for group, json_group in zip(groups, document["groups"]):
+        assert (group[0], group[1], group[2]) == (
+            json_group["offset"], json_group["length"], json_group["files"])
+
+    # Every group is one request
+    fetched = {}
+
+    for index, (offset, length, _, _) in enumerate(groups):
+        assert offset + length <= pck_size, "group is past the end of the pck"
+
+        if length > 0:
+            fetched[index] = fetch(url, offset, length)
+            assert len(fetched[index]) == length, "server returned a short range"
+
+    files_in_group = [0] * len(groups)
+    by_hash = {int(file["pathHash"], 16): file for file in document["files"]}
+
+    for path_hash_value, offset, length, size, md5, flags, group in entries:
+        file = by_hash[path_hash_value]
+
+        assert path_hash(file["path"]) == path_hash_value, "wrong path hash"
+        assert (file["offset"], file["length"], file["size"], file["flags"],
+                file["group"]) == (offset, length, size, flags, group)
+        assert file["md5"] == md5.hex(), "JSON and binary MD5s differ"
+
+        files_in_group[group] += 1
+        group_offset, group_length = groups[group][0], groups[group][1]
+
+        assert group_offset <= offset and offset + length <= group_offset + group_length, \
+            "file is outside its group: " + file["path"]
+
+        if length == 0:
+            assert md5 == hashlib.md5(b"").digest(), "wrong MD5 of empty file"
+            continue
+
+        data = fetched[group][offset - group_offset:offset - group_offset + length]
+
+        if flags & PCK_FILE_ENCRYPTED:
+            # Encrypted data has a header (MD5, size and IV) and is padded
+            assert data[:16] == md5, "encrypted header MD5 differs: " + file["path"]
+            assert struct.unpack_from("<Q", data, 16)[0] == size
+            assert length == 40 + (size + 15) // 16 * 16
+            continue
+
+        assert length == size, "wrong length: " + file["path"]
+        assert hashlib.md5(data).digest() == md5, "MD5 mismatch: " + file["path"]
+
+    assert files_in_group == [group[2] for group in groups], "wrong group file counts"
+
+    return len(groups)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+
+    tool = os.path.abspath(sys.argv[1])
+    work = os.path.abspath(sys.argv[2])
+
+    shutil.rmtree(work, ignore_errors=True)
+    source = os.path.join(work, "source")
+    os.makedirs(source)
+
+    make_source_files(source)
+    expected_files = sum(len(files) for _, _, files in os.walk(source))
+
+    pck = os.path.join(work, "test.pck")
+    run_tool(tool, pck, "-a", "add", source, "--remove-prefix", source,
+             "--set-godot-version", "4.3.0", "--encryption-key", ENCRYPTION_KEY,
+             "--encrypt-files", "secret/")
+
+    RangeHandler.root = work
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), RangeHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    url = "http://127.0.0.1:{}/test.pck".format(server.server_address[1])
+
+    try:
+        ranges = []
+
+        for coalesce in (None, "64K"):
+            options = ["--coalesce", coalesce] if coalesce else []
+            binary_path = pck + ".manifest"
+            json_path = pck + ".manifest.json"
+
+            run_tool(tool, pck, "-a", "manifest", *options)
+            run_tool(tool, pck, "-a", "manifest", "--format", "json", *options)
+
+            ranges.append(check_manifests(pck, binary_path, json_path, url,
+                                          expected_files))
+
+        assert ranges[1] < ranges[0], "coalescing didn't reduce the number of ranges"
+    finally:
+        server.shutdown()
+
+    print("Checked {} files, {} ranges without and {} with coalescing".format(
+        expected_files, ranges[0], ranges[1]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())